@@ -8,6 +8,7 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <limits>
 
 #include "BOSSAssert.h"
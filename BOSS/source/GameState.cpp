@@ -15,7 +15,7 @@ GameState::GameState(const RaceID r)
 }
 
 #ifdef _MSC_VER
-GameState::GameState(BWAPI::GameWrapper & game, BWAPI::PlayerInterface * self, const std::vector<BWAPI::UnitType> & buildingsQueued)
+GameState::GameState(BWAPI::GameWrapper & game, BWAPI::PlayerInterface * self, const std::vector<BWAPI::UnitType> & buildingsQueued, const TrainingMap * training)
     : _race                 (Races::GetRaceID(self->getRace()))
     , _currentFrame         (game->getFrameCount())
     , _lastActionFrame      (0)
@@ -86,6 +86,27 @@ GameState::GameState(BWAPI::GameWrapper & game, BWAPI::PlayerInterface * self, c
                     constructing = ActionType(unit->getAddon()->getType());
                 } 
                 // if it's a non-hatchery currently training something, add it
+                // the caller knows what it ordered, so look it up
+                else if (!isHatchery && unit->getRemainingTrainTime() > 0 && training)
+                {
+                    auto it = training->find(unit);
+                    if (it != training->end())
+                    {
+                        constructing = ActionType(it->second.first);
+
+                        // if the unit doesn't exist yet, it won't be detected below as an actual unit in progress
+                        if (!it->second.second)
+                        {
+                            _units.addActionInProgress(it->second.first, game->getFrameCount() + unit->getRemainingTrainTime(), false);
+                        }
+                    }
+                    else
+                    {
+                        // we don't know what it is training, so treat it as if it were idle
+                        trainTime = 0;
+                    }
+                }
+                // otherwise we have to guess what it is training
                 else if (!isHatchery && unit->getRemainingTrainTime() > 0)
                 {
                     // find the unit we have that has the same construction time remaining
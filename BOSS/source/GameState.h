@@ -68,7 +68,11 @@ public:
 // constructor based on BWAPI::Game only makes sense if using VS
 // we won't be using this if we're compiling to emscripten or linux
 #ifdef _MSC_VER
-    GameState(BWAPI::GameWrapper & game, BWAPI::PlayerInterface * player, const std::vector<BWAPI::UnitType> & buildingsQueued);
+    // What each production building is training, for callers that keep track of their own orders.
+    // The flag tells whether the unit being trained exists yet.
+    typedef std::map<BWAPI::UnitInterface *, std::pair<BWAPI::UnitType, bool> > TrainingMap;
+
+    GameState(BWAPI::GameWrapper & game, BWAPI::PlayerInterface * player, const std::vector<BWAPI::UnitType> & buildingsQueued, const TrainingMap * training = nullptr);
 #endif
 
 	std::vector<ActionType>     doAction(const ActionType & action);
@@ -1,3 +1,5 @@
+#include <climits>
+
 #include "Common.h"
 #include "BOSSManager.h"
 #include "UnitUtil.h"
@@ -17,6 +19,8 @@ BOSSManager::BOSSManager()
     , _previousSearchFinishFrame(0)
     , _searchInProgress(false)
     , _previousStatus("No Searches")
+    , _mirrorDirty(true)
+    , _mirrorDirtyUntil(0)
 {
 	
 }
@@ -54,7 +58,7 @@ void BOSSManager::startNewSearch(const std::vector<MetaPair> & goalUnits)
     {
         BOSS::BuildOrderSearchGoal goal = GetGoal(goalUnits);
 
-        BOSS::GameState initialState(BWAPI::Broodwar, BWAPI::Broodwar->self(), BuildingManager::Instance().buildingsQueued());
+        BOSS::GameState initialState(getCurrentState());
 
         _smartSearch = SearchPtr(new BOSS::DFBB_BuildOrderSmartSearch(initialState.getRace()));
         _smartSearch->setGoal(GetGoal(goalUnits));
@@ -113,7 +117,7 @@ void BOSSManager::drawStateInformation(int x, int y)
         return;
     }
 
-    BOSS::GameState currentState(BWAPI::Broodwar, BWAPI::Broodwar->self(), BuildingManager::Instance().buildingsQueued());
+    BOSS::GameState currentState(getCurrentState());
     BWAPI::Broodwar->drawTextScreen(BWAPI::Position(x-100, y+30), "\x04%s", currentState.getBuildingData().toString().c_str());
     BWAPI::Broodwar->drawTextScreen(BWAPI::Position(x+150, y), "\x04%s", currentState.toString().c_str());
     
@@ -257,6 +261,115 @@ BOSS::BuildOrderSearchGoal BOSSManager::GetGoal(const std::vector<MetaPair> & go
 	return goal;
 }
 
+// The state of the live game, for the root of a search.
+// It is rebuilt from BWAPI only when one of our units or orders or queued buildings has changed.
+// Otherwise the saved state is carried forward to the current frame, and the resources are set.
+BOSS::GameState BOSSManager::getCurrentState()
+{
+	const int now = BWAPI::Broodwar->getFrameCount();
+	const std::vector<BWAPI::UnitType> buildingsQueued = BuildingManager::Instance().buildingsQueued();
+
+	if (_mirrorDirty || now <= _mirrorDirtyUntil || buildingsQueued != _mirrorBuildingsQueued)
+	{
+		BOSS::GameState::TrainingMap training;
+		for (const auto & kv : _training)
+		{
+			training[kv.first] = std::make_pair(kv.second.first, kv.second.second != nullptr);
+		}
+
+		_mirror = BOSS::GameState(BWAPI::Broodwar, BWAPI::Broodwar->self(), buildingsQueued, &training);
+		_mirrorBuildingsQueued = buildingsQueued;
+		_mirrorDirty = false;
+	}
+
+	BOSS::GameState state(_mirror);
+	if (state.getCurrentFrame() < now)
+	{
+		state.fastForward(now);
+	}
+	state.setMinerals(BWAPI::Broodwar->self()->minerals());
+	state.setGas(BWAPI::Broodwar->self()->gas());
+	return state;
+}
+
+// ProductionManager gave an order. Remember what a building was told to train.
+void BOSSManager::onProduce(BWAPI::Unit producer, const MacroAct & act)
+{
+	if (act.isUnit() && !act.getUnitType().isBuilding() && act.getUnitType().getRace() != BWAPI::Races::Zerg)
+	{
+		_training[producer] = std::make_pair(act.getUnitType(), (BWAPI::Unit) nullptr);
+	}
+
+	_mirrorDirty = true;
+	_mirrorDirtyUntil = BWAPI::Broodwar->getFrameCount() + BWAPI::Broodwar->getLatencyFrames() + 1;
+}
+
+// A unit we are training has appeared. Match it to the nearest building that was told to train it.
+void BOSSManager::onUnitCreate(BWAPI::Unit unit)
+{
+	if (unit->getPlayer() != BWAPI::Broodwar->self())
+	{
+		return;
+	}
+
+	_mirrorDirty = true;
+
+	BWAPI::Unit producer = nullptr;
+	int bestDist = INT_MAX;
+	for (const auto & kv : _training)
+	{
+		if (kv.second.first == unit->getType() && !kv.second.second && kv.first->getDistance(unit) < bestDist)
+		{
+			producer = kv.first;
+			bestDist = kv.first->getDistance(unit);
+		}
+	}
+	if (producer)
+	{
+		_training[producer].second = unit;
+	}
+}
+
+// A unit finished training, or a producer or trainee is gone. Forget its training.
+void BOSSManager::onUnitComplete(BWAPI::Unit unit)
+{
+	onUnitDestroy(unit);
+}
+
+void BOSSManager::onUnitDestroy(BWAPI::Unit unit)
+{
+	for (auto it = _training.begin(); it != _training.end(); )
+	{
+		if (it->first == unit || it->second.second == unit)
+		{
+			it = _training.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	onUnitChange(unit);
+}
+
+// Something about one of our units changed (it morphed, or it is gone).
+// Other players' units are not in the mirror.
+void BOSSManager::onUnitChange(BWAPI::Unit unit)
+{
+	if (unit->getPlayer() == BWAPI::Broodwar->self())
+	{
+		_mirrorDirty = true;
+	}
+}
+
+// A unit changed sides. By now it may belong to someone else, so we can't tell
+// whether it was ours. It's rare; rebuild the mirror anyway.
+void BOSSManager::onUnitRenegade(BWAPI::Unit unit)
+{
+	_mirrorDirty = true;
+}
+
 // gets the StarcraftState corresponding to the beginning of a Melee game
 BOSS::GameState BOSSManager::getStartState()
 {
@@ -27,6 +27,15 @@ class BOSSManager
     BOSS::DFBB_BuildOrderSearchResults      _savedSearchResults;
     BOSS::BuildOrder                        _previousBuildOrder;
 
+    // What each of our production buildings was last ordered to train, and the unit once it appears.
+    std::map<BWAPI::Unit, std::pair<BWAPI::UnitType, BWAPI::Unit>>  _training;
+
+    // The state of the live game, rebuilt only after our units or orders change.
+    BOSS::GameState                         _mirror;
+    bool                                    _mirrorDirty;
+    int                                     _mirrorDirtyUntil;      // orders take effect after latency
+    std::vector<BWAPI::UnitType>            _mirrorBuildingsQueued;
+
 	BOSS::GameState				            getCurrentState();
 	BOSS::GameState				            getStartState();
 	
@@ -53,6 +62,13 @@ public:
     bool                        isSearchInProgress();
 
     void                        startNewSearch(const std::vector<MetaPair> & goalUnits);
+
+    void                        onProduce(BWAPI::Unit producer, const MacroAct & act);
+    void                        onUnitCreate(BWAPI::Unit unit);
+    void                        onUnitComplete(BWAPI::Unit unit);
+    void                        onUnitDestroy(BWAPI::Unit unit);
+    void                        onUnitChange(BWAPI::Unit unit);
+    void                        onUnitRenegade(BWAPI::Unit unit);
     
 	void						drawSearchInformation(int x, int y);
     void						drawStateInformation(int x, int y);
@@ -29,6 +29,9 @@ public:
 	int						startFrame;			// when this building record was first created
 	int						buildersSent;		// count workers lost in construction
 
+	int						id;					// set by BuildingManager
+	int						nextUpdateFrame;	// when BuildingManager looks at it next, -1 if not set
+
 	Building() 
 		: macroLocation		(MacroLocation::Anywhere)
 		, desiredPosition	(0, 0)
@@ -42,6 +45,8 @@ public:
         , isGasSteal        (false)
 		, startFrame		(BWAPI::Broodwar->getFrameCount())
 		, buildersSent		(0)
+		, id				(-1)
+		, nextUpdateFrame	(-1)
     {} 
 
 	// constructor we use most often
@@ -58,6 +63,8 @@ public:
         , isGasSteal        (false)
 		, startFrame		(BWAPI::Broodwar->getFrameCount())
 		, buildersSent		(0)
+		, id				(-1)
+		, nextUpdateFrame	(-1)
 	{}
 
 	bool operator==(const Building & b) 
@@ -1,287 +1,397 @@
 #include "Common.h"
 #include "BuildingManager.h"
+#include "LayoutPlanner.h"
 #include "Micro.h"
 #include "ScoutManager.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
 
+// How often to look at a building in each state. Between times, only events wake it.
+const int RetryFrames = 4;				// unassigned: no location or no worker yet
+const int ConstructCheckFrames = 8;		// assigned: is the worker still on its way to build?
+const int BuilderRetryFrames = 24;		// terran under construction: no replacement worker yet
+const int GiveUpFrames = 60 * 24;		// after this long, give up on the building
+const int StartedCheckFrames = 24;		// look for assigned buildings that started without an event
+
 BuildingManager::BuildingManager()
-    : _reservedMinerals(0)
+    : _nextBuildingID(0)
+    , _lastStartedCheck(0)
+    , _reservedMinerals(0)
     , _reservedGas(0)
 {
 }
 
 // Called every frame from GameCommander.
+// Look only at the buildings whose timers have gone off. Events set the timers of buildings
+// whose state may have changed, so most frames touch no buildings at all.
 void BuildingManager::update()
 {
-    validateWorkersAndBuildings();          // check to see if assigned workers have died en route or while constructing
-    assignWorkersToUnassignedBuildings();   // assign workers to the unassigned buildings and label them 'planned'    
-    constructAssignedBuildings();           // for each planned building, if the worker isn't constructing, send the command    
-    checkForStartedConstruction();          // check to see if any buildings have started construction and update data structures    
-    checkForDeadTerranBuilders();           // if we are terran and a building is under construction without a worker, assign a new one    
-    checkForCompletedBuildings();           // check to see if any buildings have completed and update data structures
+	const int now = BWAPI::Broodwar->getFrameCount();
+
+	if (now - _lastStartedCheck >= StartedCheckFrames)
+	{
+		_lastStartedCheck = now;
+		checkStarted();
+	}
+
+	while (!_wakeups.empty() && _wakeups.begin()->first <= now)
+	{
+		const int frame = _wakeups.begin()->first;
+		const int id = _wakeups.begin()->second;
+		_wakeups.erase(_wakeups.begin());
+
+		// Skip timers that were reset or belong to buildings which are gone.
+		auto it = _buildings.find(id);
+		if (it != _buildings.end() && it->second.nextUpdateFrame == frame)
+		{
+			it->second.nextUpdateFrame = -1;
+			updateBuilding(it->second);
+		}
+	}
 }
 
-// STEP 1: DO BOOK KEEPING ON BUILDINGS WHICH MAY HAVE DIED
-void BuildingManager::validateWorkersAndBuildings()
+// In case an onUnitCreate() or onUnitMorph() was missed, match assigned buildings against
+// our buildings under construction. Otherwise a started building could stay assigned, with
+// its resources reserved, until it is given up on.
+void BuildingManager::checkStarted()
 {
-    std::vector<Building> toRemove;
-    
-    // find any buildings which have become obsolete
-    for (auto & b : _buildings)
-    {
-		if (BWAPI::Broodwar->getFrameCount() - b.startFrame > 60 * 24 ||
-			b.buildersSent > 3)
+	bool anyAssigned = false;
+	for (const auto & kv : _buildings)
+	{
+		if (kv.second.status == BuildingStatus::Assigned)
 		{
-			// Too much time or too many attempts. Give up.
-			toRemove.push_back(b);
+			anyAssigned = true;
+			break;
 		}
-		else if (b.status == BuildingStatus::UnderConstruction)
+	}
+	if (!anyAssigned)
+	{
+		return;
+	}
+
+	for (const auto unit : BWAPI::Broodwar->self()->getUnits())
+	{
+		if (unit->getType().isBuilding() && unit->isBeingConstructed())
 		{
-			if (!b.buildingUnit ||
-				!b.buildingUnit->exists() ||
-				b.buildingUnit->getHitPoints() <= 0 ||
-				!b.buildingUnit->getType().isBuilding())
-			{
-				toRemove.push_back(b);
-			}
+			startBuilding(unit);
 		}
-    }
-
-    undoBuildings(toRemove);
+	}
 }
 
-// STEP 2: ASSIGN WORKERS TO BUILDINGS WITHOUT THEM
-// Also places the building.
-void BuildingManager::assignWorkersToUnassignedBuildings()
+// Look at the building no later than the given frame.
+void BuildingManager::wakeAt(Building & b, int frame)
 {
-    // for each building that doesn't have a builder, assign one
-    for (Building & b : _buildings)
-    {
-        if (b.status != BuildingStatus::Unassigned)
-        {
-            continue;
-        }
+	frame = std::min(frame, b.startFrame + GiveUpFrames + 1);
 
-		// BWAPI::Broodwar->printf("Assigning Worker To: %s", b.type.getName().c_str());
+	if (b.nextUpdateFrame >= 0 && b.nextUpdateFrame <= frame)
+	{
+		return;
+	}
 
-        BWAPI::TilePosition testLocation = getBuildingLocation(b);
-        if (!testLocation.isValid())
-        {
-			continue;
-        }
+	b.nextUpdateFrame = frame;
+	_wakeups.insert(std::pair<int, int>(frame, b.id));
+}
 
-		b.finalPosition = testLocation;
+// The building's timer went off. Move it along, and set its next timer.
+void BuildingManager::updateBuilding(Building & b)
+{
+	const int now = BWAPI::Broodwar->getFrameCount();
 
-		// grab the worker unit from WorkerManager which is closest to this final position
-		b.builderUnit = WorkerManager::Instance().getBuilder(b);
-		if (!b.builderUnit || !b.builderUnit->exists())
+	if (now - b.startFrame > GiveUpFrames ||
+		b.buildersSent > 3)
+	{
+		// Too much time or too many attempts. Give up.
+		undoBuilding(b.id);
+		return;
+	}
+
+	if (b.status == BuildingStatus::Unassigned)
+	{
+		assignWorker(b);
+	}
+	else if (b.status == BuildingStatus::Assigned)
+	{
+		construct(b);
+	}
+	else if (b.status == BuildingStatus::UnderConstruction)
+	{
+		// Normally the building's events take care of it. This catches anything they missed.
+		if (!b.buildingUnit ||
+			!b.buildingUnit->exists() ||
+			b.buildingUnit->getHitPoints() <= 0 ||
+			!b.buildingUnit->getType().isBuilding())
 		{
-			continue;
+			undoBuilding(b.id);
+		}
+		else if (b.buildingUnit->isCompleted())
+		{
+			completeBuilding(b);
+		}
+		else
+		{
+			replaceDeadTerranBuilder(b);
 		}
+	}
+}
 
-		++b.buildersSent;    // count workers ever assigned to build it
+// Unassigned: Place the building and assign a worker to it.
+void BuildingManager::assignWorker(Building & b)
+{
+	// BWAPI::Broodwar->printf("Assigning Worker To: %s", b.type.getName().c_str());
 
-        // reserve this building's space
-        BuildingPlacer::Instance().reserveTiles(b.finalPosition,b.type.tileWidth(),b.type.tileHeight());
+	const int now = BWAPI::Broodwar->getFrameCount();
 
-        b.status = BuildingStatus::Assigned;
-		// BWAPI::Broodwar->printf("assigned and placed building %s", b.type.getName().c_str());
+	BWAPI::TilePosition testLocation = getBuildingLocation(b);
+	if (!testLocation.isValid())
+	{
+		wakeAt(b, now + RetryFrames);
+		return;
 	}
+
+	b.finalPosition = testLocation;
+
+	// grab the worker unit from WorkerManager which is closest to this final position
+	b.builderUnit = WorkerManager::Instance().getBuilder(b);
+	if (!b.builderUnit || !b.builderUnit->exists())
+	{
+		wakeAt(b, now + RetryFrames);
+		return;
+	}
+
+	++b.buildersSent;    // count workers ever assigned to build it
+
+	// reserve this building's space
+	BuildingPlacer::Instance().reserveTiles(b.finalPosition,b.type.tileWidth(),b.type.tileHeight());
+
+	b.status = BuildingStatus::Assigned;
+	// BWAPI::Broodwar->printf("assigned and placed building %s", b.type.getName().c_str());
+
+	construct(b);
 }
 
-// STEP 3: ISSUE CONSTRUCTION ORDERS TO ASSIGNED BUILDINGS AS NEEDED
-void BuildingManager::constructAssignedBuildings()
+// Assigned: Issue the construction order when the worker can see the spot, then watch that
+// it keeps at it. Starting construction is noticed by onUnitCreate() or onUnitMorph().
+void BuildingManager::construct(Building & b)
 {
-    for (auto & b : _buildings)
-    {
-        if (b.status != BuildingStatus::Assigned)
-        {
-            continue;
-        }
+	UAB_ASSERT(b.builderUnit, "bad builder unit");
 
-		UAB_ASSERT(b.builderUnit, "bad builder unit");
+	const int now = BWAPI::Broodwar->getFrameCount();
 
-		/* this seems to cause errors?
-		if (!b.builderUnit->exists())
+	// A zerg drone that became the building no longer exists as a drone. Make sure that is
+	// not what happened before deciding that the builder is lost.
+	if (!b.builderUnit->exists())
+	{
+		checkStarted();
+		if (b.status != BuildingStatus::Assigned)
 		{
-			// The builder unit no longer exists() and must be replaced.
-
-			BWAPI::Broodwar->printf("b.builderUnit gone, b.type = %s", b.type.getName().c_str());
-
-			WorkerManager::Instance().finishedWithWorker(b.builderUnit);    // better still do this
-			b.builderUnit = nullptr;
-			b.buildCommandGiven = false;
-			b.status = BuildingStatus::Unassigned;
-			BuildingPlacer::Instance().freeTiles(b.finalPosition, b.type.tileWidth(), b.type.tileHeight());
+			return;
 		}
-        else */
-		if (!b.builderUnit->isConstructing())
-        {
-			if (!isBuildingPositionExplored(b))
-            {
-				// We haven't explored the build position. Go there.
-				Micro::SmartMove(b.builderUnit, BWAPI::Position(b.finalPosition));
-            }
-            // if this is not the first time we've sent this guy to build this
-            // it must be the case that something was in the way
-			else if (b.buildCommandGiven)
-            {
-                // tell worker manager the unit we had is not needed now, since we might not be able
-                // to get a valid location soon enough
-                WorkerManager::Instance().finishedWithWorker(b.builderUnit);
+	}
 
-                b.builderUnit = nullptr;
-                b.buildCommandGiven = false;
-                b.status = BuildingStatus::Unassigned;
+	// If the worker died, there is nobody to give orders to. Release the spot and find another.
+	// If this is not the first time we've sent this guy to build this,
+	// it must be the case that something was in the way.
+	const bool builderLost = !b.builderUnit->exists();
+	const bool blocked = !builderLost && b.buildCommandGiven && !b.builderUnit->isConstructing() && isBuildingPositionExplored(b);
 
-				// Unreserve the building location. The building will mark its own location.
-				BuildingPlacer::Instance().freeTiles(b.finalPosition, b.type.tileWidth(), b.type.tileHeight());
-			}
-            else
-            {
-				// Issue the build order and record whether it succeeded.
-				// If the builderUnit is zerg, it changes to !exists() when it builds.
-				b.buildCommandGiven = b.builderUnit->build(b.type, b.finalPosition);
-           }
-        }
-    }
-}
+	if (builderLost || blocked)
+	{
+		// tell worker manager the unit we had is not needed now, since we might not be able
+		// to get a valid location soon enough
+		WorkerManager::Instance().finishedWithWorker(b.builderUnit);
 
-// STEP 4: UPDATE DATA STRUCTURES FOR BUILDINGS STARTING CONSTRUCTION
-void BuildingManager::checkForStartedConstruction()
-{
-    // for each building unit which is being constructed
-    for (const auto buildingStarted : BWAPI::Broodwar->self()->getUnits())
-    {
-        // filter out units which aren't buildings under construction
-        if (!buildingStarted->getType().isBuilding() || !buildingStarted->isBeingConstructed())
-        {
-            continue;
-        }
+		b.builderUnit = nullptr;
+		b.buildCommandGiven = false;
+		b.status = BuildingStatus::Unassigned;
 
-        // check all our building status objects to see if we have a match and if we do, update it
-        for (auto & b : _buildings)
-        {
-            if (b.status != BuildingStatus::Assigned)
-            {
-                continue;
-            }
-        
-            // check if the positions match
-            if (b.finalPosition == buildingStarted->getTilePosition())
-            {
-                // the resources should now be spent, so unreserve them
-                _reservedMinerals -= buildingStarted->getType().mineralPrice();
-                _reservedGas      -= buildingStarted->getType().gasPrice();
-
-                // flag it as started and set the buildingUnit
-                b.underConstruction = true;
-                b.buildingUnit = buildingStarted;
-
-                if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Zerg)
-                {
-					// if we are zerg, the builderUnit now becomes nullptr since it's destroyed
-					b.builderUnit = nullptr;
-                }
-                else if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Protoss)
-                {
-					// if we are protoss, give the worker back to worker manager
-					// if this was the gas steal unit then it's the scout worker so give it back to the scout manager
-                    if (b.isGasSteal)
-                    {
-                        ScoutManager::Instance().setWorkerScout(b.builderUnit);
-                    }
-                    // otherwise tell the worker manager we're finished with this unit
-                    else
-                    {
-                        WorkerManager::Instance().finishedWithWorker(b.builderUnit);
-                    }
-
-                    b.builderUnit = nullptr;
-                }
-
-                b.status = BuildingStatus::UnderConstruction;
-
-                BuildingPlacer::Instance().freeTiles(b.finalPosition,b.type.tileWidth(),b.type.tileHeight());
-
-                // only one building will match
-                break;
-            }
-        }
-    }
+		// Unreserve the building location. The building will mark its own location.
+		BuildingPlacer::Instance().freeTiles(b.finalPosition, b.type.tileWidth(), b.type.tileHeight());
+
+		wakeAt(b, now + 1);
+	}
+	else if (b.builderUnit->isConstructing())
+	{
+		wakeAt(b, now + ConstructCheckFrames);
+	}
+	else if (!isBuildingPositionExplored(b))
+	{
+		// We haven't explored the build position. Go there.
+		Micro::SmartMove(b.builderUnit, BWAPI::Position(b.finalPosition));
+		wakeAt(b, now + ConstructCheckFrames);
+	}
+	else
+	{
+		// Issue the build order and record whether it succeeded.
+		// If the builderUnit is zerg, it changes to !exists() when it builds.
+		b.buildCommandGiven = b.builderUnit->build(b.type, b.finalPosition);
+		wakeAt(b, b.buildCommandGiven ? now + ConstructCheckFrames : now + 1);
+	}
 }
 
-// STEP 5: IF THE SCV DIED DURING CONSTRUCTION, ASSIGN A NEW ONE
-void BuildingManager::checkForDeadTerranBuilders()
+// A building of ours has appeared: a protoss or terran building started, a drone morphed into
+// a building, or a geyser became a refinery. If it is one of ours, it is now under construction.
+void BuildingManager::startBuilding(BWAPI::Unit buildingStarted)
 {
-	if (BWAPI::Broodwar->self()->getRace() != BWAPI::Races::Terran)
+	if (buildingStarted->getPlayer() != BWAPI::Broodwar->self() ||
+		!buildingStarted->getType().isBuilding() ||
+		!buildingStarted->isBeingConstructed())
 	{
 		return;
 	}
 
-	for (auto & b : _buildings)
+	for (auto & kv : _buildings)
 	{
-		if (b.status != BuildingStatus::UnderConstruction)
+		Building & b = kv.second;
+
+		if (b.status != BuildingStatus::Assigned)
 		{
 			continue;
 		}
 
-		UAB_ASSERT(b.buildingUnit, "null buildingUnit");
-
-		if (!UnitUtil::IsValidUnit(b.builderUnit))
+		// check if the positions match
+		if (b.finalPosition == buildingStarted->getTilePosition())
 		{
-			b.builderUnit = WorkerManager::Instance().getBuilder(b);
-			if (b.builderUnit && b.builderUnit->exists())
+			// the resources should now be spent, so unreserve them
+			_reservedMinerals -= buildingStarted->getType().mineralPrice();
+			_reservedGas      -= buildingStarted->getType().gasPrice();
+
+			// flag it as started and set the buildingUnit
+			b.underConstruction = true;
+			b.buildingUnit = buildingStarted;
+
+			if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Zerg)
 			{
-				b.builderUnit->rightClick(b.buildingUnit);
+				// if we are zerg, the builderUnit now becomes nullptr since it's destroyed
+				b.builderUnit = nullptr;
 			}
+			else if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Protoss)
+			{
+				// if we are protoss, give the worker back to worker manager
+				// if this was the gas steal unit then it's the scout worker so give it back to the scout manager
+				if (b.isGasSteal)
+				{
+					ScoutManager::Instance().setWorkerScout(b.builderUnit);
+				}
+				// otherwise tell the worker manager we're finished with this unit
+				else
+				{
+					WorkerManager::Instance().finishedWithWorker(b.builderUnit);
+				}
+
+				b.builderUnit = nullptr;
+			}
+
+			b.status = BuildingStatus::UnderConstruction;
+
+			BuildingPlacer::Instance().freeTiles(b.finalPosition,b.type.tileWidth(),b.type.tileHeight());
+
+			// From now on, only events and the give-up time wake it.
+			wakeAt(b, b.startFrame + GiveUpFrames + 1);
+
+			// only one building will match
+			break;
 		}
 	}
 }
 
-// STEP 6: CHECK FOR COMPLETED BUILDINGS
-void BuildingManager::checkForCompletedBuildings()
+// Terran under construction: If the SCV died, assign a new one.
+void BuildingManager::replaceDeadTerranBuilder(Building & b)
 {
-    std::vector<Building> toRemove;
+	if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Terran &&
+		!UnitUtil::IsValidUnit(b.builderUnit))
+	{
+		UAB_ASSERT(b.buildingUnit, "null buildingUnit");
 
-    // for each of our buildings under construction
-    for (auto & b : _buildings)
-    {
-        if (b.status != BuildingStatus::UnderConstruction)
-        {
-            continue;       
-        }
+		b.builderUnit = WorkerManager::Instance().getBuilder(b);
+		if (b.builderUnit && b.builderUnit->exists())
+		{
+			b.builderUnit->rightClick(b.buildingUnit);
+		}
+		else
+		{
+			wakeAt(b, BWAPI::Broodwar->getFrameCount() + BuilderRetryFrames);
+			return;
+		}
+	}
 
-		UAB_ASSERT(b.buildingUnit, "null buildingUnit");
+	wakeAt(b, b.startFrame + GiveUpFrames + 1);
+}
 
-        // if the unit has completed
-        if (b.buildingUnit->isCompleted())
-        {
-            // if we are terran, give the worker back to worker manager
-            if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Terran)
-            {
-                if (b.isGasSteal)
-                {
-                    ScoutManager::Instance().setWorkerScout(b.builderUnit);
-                }
-                // otherwise tell the worker manager we're finished with this unit
-                else
-                {
-                    WorkerManager::Instance().finishedWithWorker(b.builderUnit);
-                }
-            }
+// The building is finished. Release the worker if it is still ours, and forget the building.
+void BuildingManager::completeBuilding(Building & b)
+{
+	// if we are terran, give the worker back to worker manager
+	if (BWAPI::Broodwar->self()->getRace() == BWAPI::Races::Terran)
+	{
+		if (b.isGasSteal)
+		{
+			ScoutManager::Instance().setWorkerScout(b.builderUnit);
+		}
+		// otherwise tell the worker manager we're finished with this unit
+		else
+		{
+			WorkerManager::Instance().finishedWithWorker(b.builderUnit);
+		}
+	}
 
-            // remove this unit from the under construction vector
-            toRemove.push_back(b);
-        }
-    }
+	// remove this unit from the under construction list
+	removeBuilding(b.id);
+}
 
-    removeBuildings(toRemove);
+void BuildingManager::onUnitCreate(BWAPI::Unit unit)
+{
+	startBuilding(unit);
+}
+
+void BuildingManager::onUnitMorph(BWAPI::Unit unit)
+{
+	// A zerg building that is canceled turns back into a drone.
+	for (auto & kv : _buildings)
+	{
+		if (kv.second.buildingUnit == unit && !unit->getType().isBuilding())
+		{
+			undoBuilding(kv.first);
+			return;
+		}
+	}
+
+	startBuilding(unit);
+}
+
+void BuildingManager::onUnitComplete(BWAPI::Unit unit)
+{
+	for (auto & kv : _buildings)
+	{
+		if (kv.second.buildingUnit == unit && kv.second.status == BuildingStatus::UnderConstruction)
+		{
+			completeBuilding(kv.second);
+			return;
+		}
+	}
+}
+
+// If the building died, forget it. If the builder died, look at the building this frame.
+void BuildingManager::onUnitDestroy(BWAPI::Unit unit)
+{
+	for (auto & kv : _buildings)
+	{
+		Building & b = kv.second;
+
+		if (b.buildingUnit == unit)
+		{
+			undoBuilding(kv.first);
+			return;
+		}
+		if (b.builderUnit == unit)
+		{
+			wakeAt(b, BWAPI::Broodwar->getFrameCount());
+		}
+	}
 }
 
 // Add a new building to be constructed and return it.
+// The reference stays good until the building is finished or given up on.
 Building & BuildingManager::addTrackedBuildingTask(const MacroAct & act, BWAPI::TilePosition desiredLocation, bool isGasSteal)
 {
 	UAB_ASSERT(act.isBuilding(), "trying to build a non-building");
@@ -292,12 +402,14 @@ Building & BuildingManager::addTrackedBuildingTask(const MacroAct & act, BWAPI::
 	_reservedGas += type.gasPrice();
 
 	Building b(type, desiredLocation);
+	b.id = _nextBuildingID++;
 	b.macroLocation = act.getMacroLocation();
 	b.isGasSteal = isGasSteal;
 	b.status = BuildingStatus::Unassigned;
 
-	_buildings.push_back(b);      // makes a "permanent" copy of the Building object
-	return _buildings.back();     // return a reference to the permanent copy
+	Building & added = _buildings[b.id] = b;      // makes a "permanent" copy of the Building object
+	wakeAt(added, BWAPI::Broodwar->getFrameCount());
+	return added;                                 // return a reference to the permanent copy
 }
 
 // Add a new building to be constructed.
@@ -343,9 +455,9 @@ int BuildingManager::getReservedGas() const
 // In the building queue with any status.
 bool BuildingManager::isBeingBuilt(BWAPI::UnitType type) const
 {
-	for (const auto & b : _buildings)
+	for (const auto & kv : _buildings)
 	{
-		if (b.type == type)
+		if (kv.second.type == type)
 		{
 			return true;
 		}
@@ -359,8 +471,9 @@ size_t BuildingManager::getNumUnstarted(BWAPI::UnitType type) const
 {
 	size_t count = 0;
 
-	for (const auto & b : _buildings)
+	for (const auto & kv : _buildings)
 	{
+		const Building & b = kv.second;
 		if (b.type == type && b.status != BuildingStatus::UnderConstruction)
 		{
 			++count;
@@ -397,8 +510,9 @@ void BuildingManager::drawBuildingInformation(int x, int y)
 
     int yspace = 0;
 
-	for (const auto & b : _buildings)
+	for (const auto & kv : _buildings)
     {
+		const Building & b = kv.second;
         if (b.status == BuildingStatus::Unassigned)
         {
 			int x1 = b.desiredPosition.x * 32;
@@ -442,8 +556,9 @@ std::vector<BWAPI::UnitType> BuildingManager::buildingsQueued()
 {
     std::vector<BWAPI::UnitType> buildingsQueued;
 
-    for (const auto & b : _buildings)
+    for (const auto & kv : _buildings)
     {
+        const Building & b = kv.second;
         if (b.status == BuildingStatus::Unassigned || b.status == BuildingStatus::Assigned)
         {
             buildingsQueued.push_back(b.type);
@@ -463,7 +578,7 @@ void BuildingManager::cancelBuilding(Building & b)
 	{
 		_reservedMinerals -= b.type.mineralPrice();
 		_reservedGas -= b.type.gasPrice();
-		undoBuildings({ b });
+		undoBuilding(b.id);
 	}
 	else if (b.status == BuildingStatus::Assigned)
 	{
@@ -471,7 +586,7 @@ void BuildingManager::cancelBuilding(Building & b)
 		_reservedGas -= b.type.gasPrice();
 		WorkerManager::Instance().finishedWithWorker(b.builderUnit);
 		BuildingPlacer::Instance().freeTiles(b.finalPosition, b.type.tileWidth(), b.type.tileHeight());
-		undoBuildings({ b });
+		undoBuilding(b.id);
 	}
 	else if (b.status == BuildingStatus::UnderConstruction)
 	{
@@ -480,7 +595,7 @@ void BuildingManager::cancelBuilding(Building & b)
 			b.buildingUnit->cancelConstruction();
 			BuildingPlacer::Instance().freeTiles(b.finalPosition, b.type.tileWidth(), b.type.tileHeight());
 		}
-		undoBuildings({ b });
+		undoBuilding(b.id);
 	}
 	else
 	{
@@ -491,25 +606,38 @@ void BuildingManager::cancelBuilding(Building & b)
 // It's an emergency. Cancel all buildings which are not yet started.
 void BuildingManager::cancelQueuedBuildings()
 {
-	for (Building & b : _buildings)
+	// Canceling removes the building, so collect them first.
+	std::vector<int> toCancel;
+	for (const auto & kv : _buildings)
 	{
-		if (b.status == BuildingStatus::Unassigned || b.status == BuildingStatus::Assigned)
+		if (kv.second.status == BuildingStatus::Unassigned || kv.second.status == BuildingStatus::Assigned)
 		{
-			cancelBuilding(b);
+			toCancel.push_back(kv.first);
 		}
 	}
+
+	for (const int id : toCancel)
+	{
+		cancelBuilding(_buildings[id]);
+	}
 }
 
 // It's an emergency. Cancel all buildings of a given type.
 void BuildingManager::cancelBuildingType(BWAPI::UnitType t)
 {
-	for (Building & b : _buildings)
+	std::vector<int> toCancel;
+	for (const auto & kv : _buildings)
 	{
-		if (b.type == t)
+		if (kv.second.type == t)
 		{
-			cancelBuilding(b);
+			toCancel.push_back(kv.first);
 		}
 	}
+
+	for (const int id : toCancel)
+	{
+		cancelBuilding(_buildings[id]);
+	}
 }
 
 // TODO fails in placing a hatchery after all others are destroyed - why?
@@ -552,15 +680,37 @@ BWAPI::TilePosition BuildingManager::getBuildingLocation(const Building & b)
 		// Else if it's a macro hatchery, treat it like any other building.
 	}
 
-    int distance = Config::Macro::BuildingSpacing;
-	if (b.type == BWAPI::UnitTypes::Terran_Bunker ||
-		b.type == BWAPI::UnitTypes::Protoss_Photon_Cannon ||
-		b.type == BWAPI::UnitTypes::Zerg_Creep_Colony)
+	int distance;
+	bool noVerticalSpacing;
+	getBuildingSpacing(b.type, numPylons, distance, noVerticalSpacing);
+
+	// Take a slot from the layout planned at the start of the game, if one is good now.
+	// Defenses, with no spacing, are packed near the desired position instead.
+	if (distance > 0)
+	{
+		BWAPI::TilePosition slot = LayoutPlanner::Instance().getSlot(b, distance, noVerticalSpacing);
+		if (slot.isValid())
+		{
+			return slot;
+		}
+	}
+
+	// Get a position within our region.
+	return BuildingPlacer::Instance().getBuildLocationNear(b, distance, noVerticalSpacing);
+}
+
+// How much space to leave around a building of the given type, and whether only horizontally.
+void BuildingManager::getBuildingSpacing(BWAPI::UnitType type, int numPylons, int & distance, bool & noVerticalSpacing)
+{
+	distance = Config::Macro::BuildingSpacing;
+	if (type == BWAPI::UnitTypes::Terran_Bunker ||
+		type == BWAPI::UnitTypes::Protoss_Photon_Cannon ||
+		type == BWAPI::UnitTypes::Zerg_Creep_Colony)
 	{
 		// Pack defenses tightly together.
 		distance = 0;
 	}
-	else if (b.type == BWAPI::UnitTypes::Protoss_Pylon)
+	else if (type == BWAPI::UnitTypes::Protoss_Pylon)
     {
 		if (numPylons < 3)
 		{
@@ -575,53 +725,47 @@ BWAPI::TilePosition BuildingManager::getBuildingLocation(const Building & b)
 	}
 
 	// Try to pack protoss buildings more closely together. Space can run out.
-	bool noVerticalSpacing = false;
-	if (b.type == BWAPI::UnitTypes::Protoss_Gateway ||
-		b.type == BWAPI::UnitTypes::Protoss_Forge || 
-		b.type == BWAPI::UnitTypes::Protoss_Stargate || 
-		b.type == BWAPI::UnitTypes::Protoss_Citadel_of_Adun || 
-		b.type == BWAPI::UnitTypes::Protoss_Templar_Archives || 
-		b.type == BWAPI::UnitTypes::Protoss_Gateway)
+	noVerticalSpacing = false;
+	if (type == BWAPI::UnitTypes::Protoss_Gateway ||
+		type == BWAPI::UnitTypes::Protoss_Forge || 
+		type == BWAPI::UnitTypes::Protoss_Stargate || 
+		type == BWAPI::UnitTypes::Protoss_Citadel_of_Adun || 
+		type == BWAPI::UnitTypes::Protoss_Templar_Archives || 
+		type == BWAPI::UnitTypes::Protoss_Gateway)
 	{
 		noVerticalSpacing = true;
 	}
-
-	// Get a position within our region.
-	return BuildingPlacer::Instance().getBuildLocationNear(b, distance, noVerticalSpacing);
 }
 
 // The building failed or is canceled.
 // Undo any connections with other data structures, then delete.
-void BuildingManager::undoBuildings(const std::vector<Building> & toRemove)
+void BuildingManager::undoBuilding(int id)
 {
-	for (auto & b : toRemove)
+	auto it = _buildings.find(id);
+	if (it == _buildings.end())
 	{
-		// If the building was to establish a base, unreserve the base location.
-		if (b.type.isResourceDepot() && b.macroLocation != MacroLocation::Macro && b.finalPosition.isValid())
-		{
-			InformationManager::Instance().unreserveBase(b.finalPosition);
-		}
+		return;
+	}
+	const Building & b = it->second;
 
-		// Release the worker, if necessary.
-		if (b.builderUnit && b.builderUnit->exists() && b.builderUnit->getType().isWorker())
-		{
-			WorkerManager::Instance().finishedWithWorker(b.builderUnit);
-		}
+	// If the building was to establish a base, unreserve the base location.
+	if (b.type.isResourceDepot() && b.macroLocation != MacroLocation::Macro && b.finalPosition.isValid())
+	{
+		InformationManager::Instance().unreserveBase(b.finalPosition);
 	}
 
-	removeBuildings(toRemove);
+	// Release the worker, if necessary.
+	if (b.builderUnit && b.builderUnit->exists() && b.builderUnit->getType().isWorker())
+	{
+		WorkerManager::Instance().finishedWithWorker(b.builderUnit);
+	}
+
+	removeBuilding(id);
 }
 
-// Remove buildings from the list of buildings--nothing more, nothing less.
-void BuildingManager::removeBuildings(const std::vector<Building> & toRemove)
+// Remove a building from the list of buildings--nothing more, nothing less.
+// Its timer, if any, is skipped when it goes off.
+void BuildingManager::removeBuilding(int id)
 {
-    for (auto & b : toRemove)
-    {
-		auto & it = std::find(_buildings.begin(), _buildings.end(), b);
-
-        if (it != _buildings.end())
-        {
-            _buildings.erase(it);
-        }
-    }
+	_buildings.erase(id);
 }
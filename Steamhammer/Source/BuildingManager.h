@@ -12,21 +12,27 @@ class BuildingManager
 {
     BuildingManager();
 
-    std::vector<Building> _buildings;
+    std::map<int, Building>     _buildings;         // by id, in the order they were added
+    std::multimap<int, int>     _wakeups;           // frame -> building id; outdated entries are skipped
+    int                         _nextBuildingID;
+    int                         _lastStartedCheck;      // frame of the last checkStarted()
 
     int             _reservedMinerals;				// minerals reserved for planned buildings
     int             _reservedGas;					// gas reserved for planned buildings
 
     bool            isBuildingPositionExplored(const Building & b) const;
-	void			undoBuildings(const std::vector<Building> & toRemove);
-    void            removeBuildings(const std::vector<Building> & toRemove);
+	void			undoBuilding(int id);
+    void            removeBuilding(int id);
 
-    void            validateWorkersAndBuildings();		    // STEP 1
-    void            assignWorkersToUnassignedBuildings();	// STEP 2
-    void            constructAssignedBuildings();			// STEP 3
-    void            checkForStartedConstruction();			// STEP 4
-    void            checkForDeadTerranBuilders();			// STEP 5
-    void            checkForCompletedBuildings();			// STEP 6
+    void            wakeAt(Building & b, int frame);
+    void            updateBuilding(Building & b);
+
+    void            assignWorker(Building & b);             // unassigned -> assigned
+    void            construct(Building & b);                // assigned: give the build order
+    void            startBuilding(BWAPI::Unit unit);        // assigned -> under construction
+    void            checkStarted();                         // assigned -> under construction, if missed
+    void            replaceDeadTerranBuilder(Building & b); // under construction
+    void            completeBuilding(Building & b);         // under construction -> done
 
     char            getBuildingWorkerCode(const Building & b) const;
     
@@ -35,13 +41,17 @@ public:
     static BuildingManager &	Instance();
 
     void                update();
+    void                onUnitCreate(BWAPI::Unit unit);
     void                onUnitMorph(BWAPI::Unit unit);
+    void                onUnitComplete(BWAPI::Unit unit);
     void                onUnitDestroy(BWAPI::Unit unit);
 	Building &		    addTrackedBuildingTask(const MacroAct & act, BWAPI::TilePosition desiredLocation, bool isGasSteal);
 	void                addBuildingTask(const MacroAct & act, BWAPI::TilePosition desiredLocation, bool isGasSteal);
     void                drawBuildingInformation(int x,int y);
     BWAPI::TilePosition getBuildingLocation(const Building & b);
 
+    static void         getBuildingSpacing(BWAPI::UnitType type, int numPylons, int & distance, bool & noVerticalSpacing);
+
     int                 getReservedMinerals() const;
     int                 getReservedGas() const;
 
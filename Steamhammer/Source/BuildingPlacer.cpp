@@ -6,14 +6,37 @@
 using namespace UAlbertaBot;
 
 BuildingPlacer::BuildingPlacer()
-    : _boxTop       (std::numeric_limits<int>::max())
+    : _mapWidth     (BWAPI::Broodwar->mapWidth())
+    , _mapHeight    (BWAPI::Broodwar->mapHeight())
+    , _boxTop       (std::numeric_limits<int>::max())
     , _boxBottom    (std::numeric_limits<int>::lowest())
     , _boxLeft      (std::numeric_limits<int>::max())
     , _boxRight     (std::numeric_limits<int>::lowest())
 {
-    _reserveMap = std::vector< std::vector<bool> >(BWAPI::Broodwar->mapWidth(),std::vector<bool>(BWAPI::Broodwar->mapHeight(),false));
+    _reserved.init(_mapWidth, _mapHeight);
+    _resourceBox.init(_mapWidth, _mapHeight);
+    _mapBuildable.init(_mapWidth, _mapHeight);
+    _blocked.init(_mapWidth, _mapHeight);
+    _buildingTiles.assign(_mapWidth * _mapHeight, 0);
+    for (int x = 0; x < _mapWidth; ++x)
+    {
+        for (int y = 0; y < _mapHeight; ++y)
+        {
+            const bool buildable = BWAPI::Broodwar->isBuildable(x, y);
+            _mapBuildable.set(x, y, buildable);
+            _blocked.set(x, y, !buildable);
+        }
+    }
+    _mapBuildable.updateSums(0, 0);
+    _blocked.updateSums(0, 0);
 
     computeResourceBox();
+
+    // Buildings that existed before we were created, like the starting base.
+    for (const auto unit : BWAPI::Broodwar->self()->getUnits())
+    {
+        trackBuilding(unit);
+    }
 }
 
 BuildingPlacer & BuildingPlacer::Instance() 
@@ -61,6 +84,15 @@ void BuildingPlacer::computeResourceBox()
     }
 
     //BWAPI::Broodwar->printf("%d %d %d %d", boxTop, boxBottom, boxLeft, boxRight);
+
+    for (int x = 0; x < _mapWidth; ++x)
+    {
+        for (int y = 0; y < _mapHeight; ++y)
+        {
+            _resourceBox.set(x, y, isInResourceBox(x, y));
+        }
+    }
+    _resourceBox.updateSums(0, 0);
 }
 
 // makes final checks to see if a building can be built at a certain location
@@ -77,15 +109,9 @@ bool BuildingPlacer::canBuildHere(BWAPI::TilePosition position,const Building &
     }
 
     // check the reserve map
-    for (int x = position.x; x < position.x + b.type.tileWidth(); x++)
+    if (_reserved.count(position.x, position.y, b.type.tileWidth(), b.type.tileHeight()) > 0)
     {
-        for (int y = position.y; y < position.y + b.type.tileHeight(); y++)
-        {
-            if (_reserveMap[x][y])
-            {
-                return false;
-            }
-        }
+        return false;
     }
 
     // if it overlaps a base location return false
@@ -117,16 +143,10 @@ bool BuildingPlacer::tileBlocksAddon(BWAPI::TilePosition position) const
     return false;
 }
 
-// Can we build this building here with the specified amount of space?
-// Space value is buildDist. horizontalOnly means only horizontal spacing.
-bool BuildingPlacer::canBuildHereWithSpace(BWAPI::TilePosition position,const Building & b,int buildDist,bool horizontalOnly) const
+// The rectangle of tiles that must be free to build b with the given spacing,
+// relative to the building's tile position. The right and bottom are exclusive.
+void BuildingPlacer::getSpaceRectangle(const Building & b, int buildDist, bool horizontalOnly, int & left, int & top, int & right, int & bottom)
 {
-    //if we can't build here, we of course can't build here with space
-    if (!canBuildHere(position,b))
-    {
-        return false;
-    }
-
     // height and width of the building
     int width(b.type.tileWidth());
     int height(b.type.tileHeight());
@@ -140,28 +160,54 @@ bool BuildingPlacer::canBuildHereWithSpace(BWAPI::TilePosition position,const Bu
         width += 2;
     }
 
-    // define the rectangle of the building spot
-    int startx = position.x - buildDist;
-    int starty = position.y - buildDist;
-    int endx   = position.x + width + buildDist;
-    int endy   = position.y + height + buildDist;
+    left   = -buildDist;
+    top    = -buildDist;
+    right  = width + buildDist;
+    bottom = height + buildDist;
 
     if (b.type.isAddon())
     {
         const BWAPI::UnitType builderType = b.type.whatBuilds().first;
 
-        BWAPI::TilePosition builderTile(position.x - builderType.tileWidth(),position.y + 2 - builderType.tileHeight());
-
-        startx = builderTile.x - buildDist;
-        starty = builderTile.y - buildDist;
-        endx = position.x + width + buildDist;
-        endy = position.y + height + buildDist;
+        left = -builderType.tileWidth() - buildDist;
+        top  = 2 - builderType.tileHeight() - buildDist;
     }
 
     if (horizontalOnly)
     {
-        starty += buildDist;
-        endy -= buildDist;
+        top += buildDist;
+        bottom -= buildDist;
+    }
+}
+
+// Can we build this building here with the specified amount of space?
+// Space value is buildDist. horizontalOnly means only horizontal spacing.
+bool BuildingPlacer::canBuildHereWithSpace(BWAPI::TilePosition position,const Building & b,int buildDist,bool horizontalOnly) const
+{
+    //if we can't build here, we of course can't build here with space
+    if (!canBuildHere(position,b))
+    {
+        return false;
+    }
+
+    // height and width of the building
+    int width(b.type.tileWidth());
+    int height(b.type.tileHeight());
+
+    // define the rectangle of the building spot
+    int startx, starty, endx, endy;
+    getSpaceRectangle(b, buildDist, horizontalOnly, startx, starty, endx, endy);
+    startx += position.x;
+    starty += position.y;
+    endx += position.x;
+    endy += position.y;
+
+    if (b.type == BWAPI::UnitTypes::Terran_Command_Center ||
+        b.type == BWAPI::UnitTypes::Terran_Factory ||
+        b.type == BWAPI::UnitTypes::Terran_Starport ||
+        b.type == BWAPI::UnitTypes::Terran_Science_Facility)
+    {
+        width += 2;
     }
 
     // if this rectangle doesn't fit on the map we can't build here
@@ -170,17 +216,25 @@ bool BuildingPlacer::canBuildHereWithSpace(BWAPI::TilePosition position,const Bu
         return false;
     }
 
+    if (b.type.isRefinery())
+    {
+        return true;
+    }
+
     // if space is reserved, or it's in the resource box, we can't build here
+    if (!isFreeRectangle(startx, starty, endx - startx, endy - starty, b.type != BWAPI::UnitTypes::Protoss_Photon_Cannon))
+    {
+        return false;
+    }
+
+    // the rest of buildable() depends on units, and has to be checked tile by tile
     for (int x = startx; x < endx; x++)
     {
         for (int y = starty; y < endy; y++)
         {
-            if (!b.type.isRefinery())
+            if (!buildable(b,x,y))
             {
-                if (!buildable(b,x,y) || _reserveMap[x][y] || ((b.type != BWAPI::UnitTypes::Protoss_Photon_Cannon) && isInResourceBox(x,y)))
-                {
-                    return false;
-                }
+                return false;
             }
         }
     }
@@ -188,16 +242,44 @@ bool BuildingPlacer::canBuildHereWithSpace(BWAPI::TilePosition position,const Bu
     return true;
 }
 
-BWAPI::TilePosition BuildingPlacer::getBuildLocationNear(const Building & b,int buildDist,bool horizontalOnly) const
+BWAPI::TilePosition BuildingPlacer::getBuildLocationNear(const Building & b,int buildDist,bool horizontalOnly)
 {
 	// BWAPI::Broodwar->printf("Building Placer seeks position near %d, %d", b.desiredPosition.x, b.desiredPosition.y);
 
 	// get the precomputed vector of tile positions which are sorted closest to this location
     const std::vector<BWAPI::TilePosition> & closestToBuilding = MapTools::Instance().getClosestTilesTo(BWAPI::Position(b.desiredPosition));
 
-    // iterate through the list until we've found a suitable location
+    // Refineries don't check their space. Test them directly.
+    if (b.type.isRefinery())
+    {
+        for (size_t i(0); i < closestToBuilding.size(); ++i)
+        {
+            if (canBuildHereWithSpace(closestToBuilding[i],b,buildDist,horizontalOnly))
+            {
+                return closestToBuilding[i];
+            }
+        }
+        return BWAPI::TilePositions::None;
+    }
+
+    refreshBuildings();
+
+    // Skip tiles whose space rectangle is known to be blocked. Only the candidates that remain
+    // get the full check, which also looks at creep, power, and units in the way.
+    int left, top, right, bottom;
+    getSpaceRectangle(b, buildDist, horizontalOnly, left, top, right, bottom);
+    const CandidateMap & candidates =
+        getCandidates(right - left, bottom - top, b.type != BWAPI::UnitTypes::Protoss_Photon_Cannon);
+
     for (size_t i(0); i < closestToBuilding.size(); ++i)
     {
+        const int x = closestToBuilding[i].x + left;
+        const int y = closestToBuilding[i].y + top;
+        if (x < 0 || y < 0 || x >= _mapWidth || y >= _mapHeight || !candidates.ok[tileIndex(x, y)])
+        {
+            continue;
+        }
+
         if (canBuildHereWithSpace(closestToBuilding[i],b,buildDist,horizontalOnly))
         {
             return closestToBuilding[i];
@@ -279,15 +361,9 @@ bool BuildingPlacer::buildable(const Building & b,int x,int y) const
 
 void BuildingPlacer::reserveTiles(BWAPI::TilePosition position,int width,int height)
 {
-    int rwidth = _reserveMap.size();
-    int rheight = _reserveMap[0].size();
-    for (int x = position.x; x < position.x + width && x < rwidth; x++)
-    {
-        for (int y = position.y; y < position.y + height && y < rheight; y++)
-        {
-            _reserveMap[x][y] = true;
-        }
-    }
+    _reserved.setRectangle(position.x, position.y, width, height, true);
+
+    tilesChanged(position.x, position.y, width, height);
 }
 
 void BuildingPlacer::drawReservedTiles()
@@ -297,14 +373,11 @@ void BuildingPlacer::drawReservedTiles()
         return;
     }
 
-    int rwidth = _reserveMap.size();
-    int rheight = _reserveMap[0].size();
-
-    for (int x = 0; x < rwidth; ++x)
+    for (int x = 0; x < _mapWidth; ++x)
     {
-        for (int y = 0; y < rheight; ++y)
+        for (int y = 0; y < _mapHeight; ++y)
         {
-            if (_reserveMap[x][y] || isInResourceBox(x,y))
+            if (_reserved.get(x,y) || _resourceBox.get(x,y))
             {
                 int x1 = x*32 + 8;
                 int y1 = y*32 + 8;
@@ -319,16 +392,9 @@ void BuildingPlacer::drawReservedTiles()
 
 void BuildingPlacer::freeTiles(BWAPI::TilePosition position, int width, int height)
 {
-    int rwidth = _reserveMap.size();
-    int rheight = _reserveMap[0].size();
+    _reserved.setRectangle(position.x, position.y, width, height, false);
 
-    for (int x = position.x; x < position.x + width && x < rwidth; x++)
-    {
-        for (int y = position.y; y < position.y + height && y < rheight; y++)
-        {
-            _reserveMap[x][y] = false;
-        }
-    }
+    tilesChanged(position.x, position.y, width, height);
 }
 
 BWAPI::TilePosition BuildingPlacer::getRefineryPosition()
@@ -367,14 +433,212 @@ BWAPI::TilePosition BuildingPlacer::getRefineryPosition()
     return closestGeyser;
 }
 
+bool BuildingPlacer::isBlocked(BWAPI::TilePosition position, int width, int height) const
+{
+    return _blocked.count(position.x, position.y, width, height) > 0;
+}
+
 bool BuildingPlacer::isReserved(int x, int y) const
 {
-    int rwidth = _reserveMap.size();
-    int rheight = _reserveMap[0].size();
-    if (x < 0 || y < 0 || x >= rwidth || y >= rheight)
+    return _reserved.get(x, y);
+}
+
+// A rectangle is free if all its tiles are buildable on the map, not reserved, and not covered by
+// one of our buildings. Other conditions, like creep and power and units in the way, change too
+// often to keep track of. Constant time, from the summed-area tables.
+bool BuildingPlacer::isFreeRectangle(int x, int y, int width, int height, bool avoidResourceBox) const
+{
+    if (x < 0 || y < 0 || x + width > _mapWidth || y + height > _mapHeight)
     {
         return false;
     }
 
-    return _reserveMap[x][y];
+    return
+        _blocked.count(x, y, width, height) == 0 &&
+        _reserved.count(x, y, width, height) == 0 &&
+        !(avoidResourceBox && _resourceBox.count(x, y, width, height) > 0);
+}
+
+int BuildingPlacer::candidateKey(int width, int height, bool avoidResourceBox)
+{
+    return ((width << 8) + height) * 2 + (avoidResourceBox ? 1 : 0);
+}
+
+// Create the candidate map for a rectangle size the first time it is asked for.
+BuildingPlacer::CandidateMap & BuildingPlacer::getCandidates(int width, int height, bool avoidResourceBox)
+{
+    const int key = candidateKey(width, height, avoidResourceBox);
+    auto it = _candidates.find(key);
+    if (it != _candidates.end())
+    {
+        return it->second;
+    }
+
+    CandidateMap & candidates = _candidates[key];
+    candidates.width = width;
+    candidates.height = height;
+    candidates.avoidResourceBox = avoidResourceBox;
+    candidates.ok.assign(_mapWidth * _mapHeight, 0);
+
+    if (width <= 0 || height <= 0)
+    {
+        return candidates;
+    }
+
+    for (int x = 0; x < _mapWidth; ++x)
+    {
+        for (int y = 0; y < _mapHeight; ++y)
+        {
+            candidates.ok[tileIndex(x, y)] = isFreeRectangle(x, y, width, height, avoidResourceBox) ? 1 : 0;
+        }
+    }
+
+    return candidates;
+}
+
+// Tiles in the given rectangle may have changed. Update every candidate rectangle that overlaps them.
+void BuildingPlacer::tilesChanged(int x, int y, int width, int height)
+{
+    for (auto & kv : _candidates)
+    {
+        CandidateMap & candidates = kv.second;
+
+        const int left = std::max(0, x - candidates.width + 1);
+        const int top = std::max(0, y - candidates.height + 1);
+        const int right = std::min(_mapWidth, x + width);
+        const int bottom = std::min(_mapHeight, y + height);
+
+        for (int cx = left; cx < right; ++cx)
+        {
+            for (int cy = top; cy < bottom; ++cy)
+            {
+                candidates.ok[tileIndex(cx, cy)] =
+                    isFreeRectangle(cx, cy, candidates.width, candidates.height, candidates.avoidResourceBox) ? 1 : 0;
+            }
+        }
+    }
+}
+
+// The tiles the unit covers, if it is one of our buildings on the ground.
+BuildingPlacer::Footprint BuildingPlacer::getFootprint(BWAPI::Unit unit) const
+{
+    Footprint footprint;
+    footprint.tile = BWAPI::TilePositions::None;
+    footprint.width = 0;
+    footprint.height = 0;
+
+    if (unit->exists() &&
+        unit->getPlayer() == BWAPI::Broodwar->self() &&
+        unit->getType().isBuilding() &&
+        !unit->isLifted())
+    {
+        footprint.tile = unit->getTilePosition();
+        footprint.width = unit->getType().tileWidth();
+        footprint.height = unit->getType().tileHeight();
+    }
+
+    return footprint;
+}
+
+void BuildingPlacer::markFootprint(const Footprint & footprint, int delta)
+{
+    if (footprint.tile == BWAPI::TilePositions::None)
+    {
+        return;
+    }
+
+    const int left = std::max(0, footprint.tile.x);
+    const int top = std::max(0, footprint.tile.y);
+    const int right = std::min(_mapWidth, footprint.tile.x + footprint.width);
+    const int bottom = std::min(_mapHeight, footprint.tile.y + footprint.height);
+
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    for (int x = left; x < right; ++x)
+    {
+        for (int y = top; y < bottom; ++y)
+        {
+            _buildingTiles[tileIndex(x, y)] += delta;
+            _blocked.set(x, y, !_mapBuildable.get(x, y) || _buildingTiles[tileIndex(x, y)] > 0);
+        }
+    }
+    _blocked.updateSums(left, top);
+
+    tilesChanged(footprint.tile.x, footprint.tile.y, footprint.width, footprint.height);
+}
+
+// Start, update, or stop tracking the unit's footprint, whichever fits its current state.
+void BuildingPlacer::trackBuilding(BWAPI::Unit unit)
+{
+    const Footprint footprint = getFootprint(unit);
+    auto it = _footprints.find(unit);
+
+    if (it != _footprints.end())
+    {
+        if (it->second.tile == footprint.tile &&
+            it->second.width == footprint.width &&
+            it->second.height == footprint.height)
+        {
+            return;
+        }
+        markFootprint(it->second, -1);
+        _footprints.erase(it);
+    }
+
+    if (footprint.tile != BWAPI::TilePositions::None)
+    {
+        markFootprint(footprint, 1);
+        _footprints[unit] = footprint;
+    }
+}
+
+void BuildingPlacer::untrackBuilding(BWAPI::Unit unit)
+{
+    auto it = _footprints.find(unit);
+    if (it != _footprints.end())
+    {
+        markFootprint(it->second, -1);
+        _footprints.erase(it);
+    }
+}
+
+// Terran buildings lift off and land without any event. Catch up before placing a building.
+void BuildingPlacer::refreshBuildings()
+{
+    if (BWAPI::Broodwar->self()->getRace() != BWAPI::Races::Terran)
+    {
+        return;
+    }
+
+    for (const auto unit : BWAPI::Broodwar->self()->getUnits())
+    {
+        if (unit->getType().isBuilding())
+        {
+            trackBuilding(unit);
+        }
+    }
+}
+
+void BuildingPlacer::onUnitCreate(BWAPI::Unit unit)
+{
+    trackBuilding(unit);
+}
+
+// A drone becomes a building, or a hatchery becomes a lair, or a geyser becomes a refinery.
+void BuildingPlacer::onUnitMorph(BWAPI::Unit unit)
+{
+    trackBuilding(unit);
+}
+
+void BuildingPlacer::onUnitRenegade(BWAPI::Unit unit)
+{
+    trackBuilding(unit);
+}
+
+void BuildingPlacer::onUnitDestroy(BWAPI::Unit unit)
+{
+    untrackBuilding(unit);
 }
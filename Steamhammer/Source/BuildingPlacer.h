@@ -4,6 +4,7 @@
 #include "BuildingData.h"
 //#include "MacroAct.h"
 #include "InformationManager.h"
+#include "TileLayer.h"
 
 namespace UAlbertaBot
 {
@@ -13,7 +14,35 @@ class BuildingPlacer
 {
     BuildingPlacer();
 
-    std::vector< std::vector<bool> > _reserveMap;
+    // Placement candidates for one size of rectangle: For each tile, whether the rectangle
+    // with its top left corner on the tile is all free. Kept up to date as tiles change,
+    // so that finding a building location does not test every tile of every spot.
+    struct CandidateMap
+    {
+        int                 width;
+        int                 height;
+        bool                avoidResourceBox;
+        std::vector<char>   ok;                 // indexed by tileIndex()
+    };
+
+    // The tiles covered by one of our buildings, or None if it covers nothing (it is lifted).
+    struct Footprint
+    {
+        BWAPI::TilePosition tile;
+        int                 width;
+        int                 height;
+    };
+
+    int     _mapWidth;
+    int     _mapHeight;
+
+    TileLayer                           _reserved;
+    TileLayer                           _resourceBox;
+    TileLayer                           _mapBuildable;      // the map's own buildability
+    TileLayer                           _blocked;           // unbuildable on the map, or covered by our building
+    std::vector<unsigned char>          _buildingTiles;     // how many of our buildings cover each tile
+    std::map<BWAPI::Unit, Footprint>    _footprints;
+    std::map<int, CandidateMap>         _candidates;        // by candidateKey()
 
     int     _boxTop;
     int	    _boxBottom;
@@ -22,6 +51,19 @@ class BuildingPlacer
 
     void    computeBuildableTileDistance(BWAPI::TilePosition tp);
 
+    int     tileIndex(int x, int y) const { return y * _mapWidth + x; };
+    bool    isFreeRectangle(int x, int y, int width, int height, bool avoidResourceBox) const;
+
+    static int      candidateKey(int width, int height, bool avoidResourceBox);
+    CandidateMap &  getCandidates(int width, int height, bool avoidResourceBox);
+    void            tilesChanged(int x, int y, int width, int height);
+
+    Footprint       getFootprint(BWAPI::Unit unit) const;
+    void            markFootprint(const Footprint & footprint, int delta);
+    void            trackBuilding(BWAPI::Unit unit);
+    void            untrackBuilding(BWAPI::Unit unit);
+    void            refreshBuildings();
+
 public:
 
     static BuildingPlacer & Instance();
@@ -37,12 +79,24 @@ public:
     bool					canBuildHere(BWAPI::TilePosition position,const Building & b) const;
     bool					canBuildHereWithSpace(BWAPI::TilePosition position,const Building & b,int buildDist,bool horizontalOnly = false) const;
 
+    // the rectangle that must be free for canBuildHereWithSpace(), relative to the building's tile
+    static void				getSpaceRectangle(const Building & b,int buildDist,bool horizontalOnly,int & left,int & top,int & right,int & bottom);
+
+    // is any tile in the rectangle unbuildable on the map or covered by one of our buildings?
+    bool					isBlocked(BWAPI::TilePosition position,int width,int height) const;
+
     // returns a build location near a building's desired location
-    BWAPI::TilePosition		getBuildLocationNear(const Building & b,int buildDist,bool horizontalOnly = false) const;
+    BWAPI::TilePosition		getBuildLocationNear(const Building & b,int buildDist,bool horizontalOnly = false);
 
 	void					reserveTiles(BWAPI::TilePosition position, int width, int height);
     void					freeTiles(BWAPI::TilePosition position,int width,int height);
 
+    // keep track of the tiles our buildings cover
+    void					onUnitCreate(BWAPI::Unit unit);
+    void					onUnitMorph(BWAPI::Unit unit);
+    void					onUnitRenegade(BWAPI::Unit unit);
+    void					onUnitDestroy(BWAPI::Unit unit);
+
     void					drawReservedTiles();
     void					computeResourceBox();
 
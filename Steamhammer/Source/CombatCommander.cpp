@@ -12,6 +12,8 @@ const size_t ScoutDefensePriority = 4;
 const size_t DropPriority = 5;         // don't steal from Drop squad for Defense squad
 const size_t SurveyPriority = 10;      // consists of only 1 overlord, no need to steal from it
 
+const int DefenseReinforceFrames = 48;	// how long the base can hold out for defenders to arrive
+
 CombatCommander::CombatCommander() 
     : _initialized(false)
 	, _goAggressive(true)
@@ -379,7 +381,7 @@ void CombatCommander::updateBaseDefenseSquads()
 
 		// all of the enemy units in this region
 		BWAPI::Unitset enemyUnitsInRegion;
-        for (const auto unit : BWAPI::Broodwar->enemy()->getUnits())
+        for (const auto unit : MapGrid::Instance().getEnemiesInRegion(myRegion))
         {
             // If it's a harmless air unit, don't worry about it for base defense.
 			// TODO something more sensible
@@ -390,10 +392,7 @@ void CombatCommander::updateBaseDefenseSquads()
                 continue;
             }
 
-            if (BWTA::getRegion(BWAPI::TilePosition(unit->getPosition())) == myRegion)
-            {
-                enemyUnitsInRegion.insert(unit);
-            }
+            enemyUnitsInRegion.insert(unit);
         }
 
         // we ignore the first enemy worker in our region since we assume it is a scout
@@ -480,6 +479,23 @@ void CombatCommander::updateBaseDefenseSquads()
 			Config::Micro::WorkersDefendRush &&
 			(!sunkenDefender && numZerglingsInOurBase() > 0 || buildingRush());
 
+		// And not if the combat sim says that the fighting units can win without them,
+		// or hold until the defenders in reach arrive, or that the workers would not help.
+		if (pullWorkers)
+		{
+			BWAPI::Unit nearestEnemy = BWAPI::Broodwar->getClosestUnit(regionCenter, BWAPI::Filter::IsEnemy && !BWAPI::Filter::IsFlying, 32 * 25);
+			if (nearestEnemy)
+			{
+				CombatSimulation sim;
+				CombatPlanScores plans;
+				sim.simulatePlans(nearestEnemy->getPosition(), DefenseReinforceFrames, plans);
+				pullWorkers =
+					plans.fightNow < 0 &&
+					plans.reinforced < 0 &&
+					plans.workersPulled > plans.fightNow;
+			}
+		}
+
 		updateDefenseSquadUnits(defenseSquad, flyingDefendersNeeded, groundDefendersNeeded, pullWorkers);
     }
 
@@ -1,10 +1,26 @@
+#include <fstream>
+
 #include "CombatSimulation.h"
-#include "FAP.h"
+#include "TaskPool.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
 
+// Signature quantization.
+const int SignatureCellSize = 64;		// pixels; positions are relative to the engagement center
+const int SignatureHPBuckets = 8;		// of hit points plus shields
+
+const int SimulationFrames = 96;		// 4 seconds
+
+// A cached result is good for this many frames.
+const int CacheLifetime = 24;
+
+// What-if plans.
+const int PlanFrames = 96;				// the usual simulation length
+
 CombatSimulation::CombatSimulation()
+	: _scores(0, 0)
+	, _frames(0)
 {
 }
 
@@ -12,7 +28,10 @@ CombatSimulation::CombatSimulation()
 // this center will most likely be the position of the forwardmost combat unit we control
 void CombatSimulation::setCombatUnits(const BWAPI::Position & center, const int radius)
 {
-	fap.clearState();
+	_fap.clearState();
+	_fap.setFixedPoint(Config::Micro::CombatSimFixedPoint);
+	_signature.clear();
+	_trace.clear();
 
 	if (Config::Debug::DrawCombatSimulationInfo)
 	{
@@ -31,7 +50,8 @@ void CombatSimulation::setCombatUnits(const BWAPI::Position & center, const int
 	{
 		if (UnitUtil::IsCombatSimUnit(unit))
 		{
-			fap.addIfCombatUnitPlayer1(unit);
+			_fap.addIfCombatUnitPlayer1(unit);
+			addToSignature(false, unit->getType(), unit->getHitPoints(), unit->getShields(), unit->isStimmed(), unit->getPosition(), center);
 		}
 	}
 
@@ -41,24 +61,297 @@ void CombatSimulation::setCombatUnits(const BWAPI::Position & center, const int
 		if (ui.lastHealth > 0 &&
 			(ui.unit->exists() ? UnitUtil::IsCombatSimUnit(ui.unit) : UnitUtil::IsCombatSimUnit(ui.type)))
 		{
-			fap.addIfCombatUnitPlayer2(ui);
+			_fap.addIfCombatUnitPlayer2(ui);
+			addToSignature(true, ui.type, ui.lastHealth, ui.lastShields, ui.unit->exists() && ui.unit->isStimmed(), ui.lastPosition, center);
 		}
 	}
+
+	std::sort(_signature.begin(), _signature.end());
+
+	if (Config::Debug::TraceCombatSim)
+	{
+		std::ostringstream trace;
+		_fap.writeTraceStart(trace, BWAPI::Broodwar->getFrameCount());
+		_trace = trace.str();
+	}
+}
+
+// Pack one unit into an int: side, type, hit point bucket, stim, and position cell.
+void CombatSimulation::addToSignature(bool enemy, BWAPI::UnitType type, int hp, int shields, bool stimmed,
+	const BWAPI::Position & pos, const BWAPI::Position & center)
+{
+	const int maxHP = std::max(1, type.maxHitPoints() + type.maxShields());
+	const int hpBucket = std::min(SignatureHPBuckets - 1, (hp + shields) * SignatureHPBuckets / maxHP);
+	const int cellX = std::max(-32, std::min(31, (pos.x - center.x) / SignatureCellSize)) + 32;
+	const int cellY = std::max(-32, std::min(31, (pos.y - center.y) / SignatureCellSize)) + 32;
+
+	_signature.push_back(
+		(enemy ? 1 << 24 : 0) |
+		type.getID() << 16 |
+		hpBucket << 13 |
+		(stimmed ? 1 << 12 : 0) |
+		cellX << 6 |
+		cellY);
 }
 
 double CombatSimulation::simulateCombat()
 {
-	fap.simulate();
-	std::pair<int, int> scores = fap.playerScores();
+	simulate();
+	drawScore();
+	writeTrace();
+	return getScore();
+}
+
+// Safe to call on any thread: It touches only this simulation's data.
+// Adaptive simulation stops early when the winner is clear, and runs long when the fight
+// develops slowly, so that long range units like sieged tanks and lurkers get to act.
+void CombatSimulation::simulate()
+{
+	if (Config::Micro::CombatSimAdaptive)
+	{
+		_frames = _fap.simulateAdaptive(SimulationFrames, Config::Micro::CombatSimMaxFrames, Config::Micro::CombatSimDecisivePercent);
+	}
+	else
+	{
+		_frames = _fap.simulate(SimulationFrames);
+	}
+	_scores = _fap.playerScores();
+}
 
-	int score = scores.first - scores.second;
+double CombatSimulation::getScore() const
+{
+	return double(_scores.first - _scores.second);
+}
 
+void CombatSimulation::drawScore() const
+{
 	if (Config::Debug::DrawCombatSimulationInfo)
 	{
+		const int score = _scores.first - _scores.second;
 		BWAPI::Broodwar->drawTextScreen(150, 200, "%cCombat sim: us %c%d %c- them %c%d %c= %c%d",
-			white, orange, scores.first, white, orange, scores.second, white,
+			white, orange, _scores.first, white, orange, _scores.second, white,
 			score >= 0 ? green : red, score);
 	}
+}
+
+// Append the simulation to the trace file, which collects them over games.
+// Main thread only.
+void CombatSimulation::writeTrace() const
+{
+	if (_trace.empty())
+	{
+		return;
+	}
+
+	const std::string filename = Config::IO::WriteDir + "FAPTrace.bin";
+	const bool isNew = !std::ifstream(filename.c_str());
+
+	std::ofstream file(filename.c_str(), std::ios::binary | std::ios::app);
+	if (isNew)
+	{
+		FastAPproximation::writeTraceHeader(file);
+	}
+	file.write(_trace.data(), _trace.size());
+	FastAPproximation::writeTraceEnd(file, _frames, _scores);
+}
+
+// Evaluate several plans for the fight at center in one call.
+// The units are read from the game once, on this thread. Each plan is a copy of the
+// starting state (or, for reinforcements, of the fight-now state when they arrive),
+// changed a little and simulated on. The independent plans run side by side on the TaskPool.
+void CombatSimulation::simulatePlans(const BWAPI::Position & center, int reinforceFrames, CombatPlanScores & plans)
+{
+	const int radius = Config::Micro::CombatRegroupRadius;
+	const int arrival = std::max(0, std::min(reinforceFrames, PlanFrames - 1));
+
+	setCombatUnits(center, radius);
+
+	// Combat units that are not in the fight but can reach it in time enter it at the
+	// point they would have reached. Workers that are not fighting already can be pulled.
+	FastAPproximation reinforcements;
+	FastAPproximation workers;
+	plans.reinforcements = 0;
+	plans.workers = 0;
+
+	for (const auto unit : BWAPI::Broodwar->self()->getUnits())
+	{
+		if (!unit->getPosition().isValid() || !unit->isCompleted())
+		{
+			continue;
+		}
+		const int dist = unit->getDistance(center);
+
+		if (unit->getType().isWorker())
+		{
+			if (dist <= radius && !UnitUtil::IsCombatSimUnit(unit))
+			{
+				workers.addIfCombatUnitPlayer1(unit);
+				++plans.workers;
+			}
+		}
+		else if (dist > radius && UnitUtil::IsCombatSimUnit(unit))
+		{
+			const double reach = BWAPI::Broodwar->self()->topSpeed(unit->getType()) * arrival;
+			if (dist - radius <= reach)
+			{
+				const double along = std::min(1.0, reach / dist);
+				UnitInfo ui(unit);
+				ui.lastPosition = ui.lastPosition + BWAPI::Position(int((center.x - ui.lastPosition.x) * along), int((center.y - ui.lastPosition.y) * along));
+				reinforcements.addIfCombatUnitPlayer1(ui);
+				++plans.reinforcements;
+			}
+		}
+	}
+
+	const FastAPproximation start = _fap;
+	std::pair<int, int> now, reinforced, pulled;
+
+	std::vector<std::function<void()>> tasks;
+
+	// Fight now, and fork off the reinforced fight when the reinforcements arrive.
+	tasks.push_back([&]() -> void
+	{
+		FastAPproximation fight = start;
+		fight.simulate(arrival);
+		if (plans.reinforcements)
+		{
+			FastAPproximation later = fight;
+			later.addUnitsPlayer1(reinforcements);
+			later.simulate(PlanFrames - arrival);
+			reinforced = later.playerScores();
+		}
+		fight.simulate(PlanFrames - arrival);
+		now = fight.playerScores();
+	});
+
+	if (plans.workers)
+	{
+		tasks.push_back([&]() -> void
+		{
+			FastAPproximation fight = start;
+			fight.addUnitsPlayer1(workers);
+			fight.simulate(PlanFrames);
+			pulled = fight.playerScores();
+		});
+	}
+
+	TaskPool::Instance().run(tasks);
+
+	_scores = now;
+	plans.fightNow = double(now.first - now.second);
+	plans.reinforced = plans.reinforcements ? double(reinforced.first - reinforced.second) : plans.fightNow;
+	plans.workersPulled = plans.workers ? double(pulled.first - pulled.second) : plans.fightNow;
+}
+
+CombatSimulationBatch::CombatSimulationBatch()
+	: _size(0)
+	, _lookups(0)
+	, _hits(0)
+	, _simulated(0)
+	, _framesSimulated(0)
+{
+}
+
+size_t CombatSimulationBatch::hashSignature(const std::vector<int> & signature)
+{
+	size_t hash = 2166136261U;
+	for (const int unit : signature)
+	{
+		hash = (hash ^ size_t(unit)) * 16777619U;
+	}
+	return hash;
+}
+
+// Start a new frame's batch. Drop cached results that have grown stale.
+void CombatSimulationBatch::clear()
+{
+	_size = 0;
+
+	const int now = BWAPI::Broodwar->getFrameCount();
+	for (auto it = _cache.begin(); it != _cache.end(); )
+	{
+		if (now - it->second.frame >= CacheLifetime)
+		{
+			it = _cache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+// Set up a simulation and return its index, to get the score with after run().
+// If a recent simulation had the same signature, its result is reused.
+int CombatSimulationBatch::add(const BWAPI::Position & center, const int radius)
+{
+	if (_size == _sims.size())
+	{
+		_sims.push_back(CombatSimulation());
+		_cached.push_back(false);
+	}
+	CombatSimulation & sim = _sims[_size];
+	sim.setCombatUnits(center, radius);
 
-	return double(score);
+	++_lookups;
+	auto it = _cache.find(hashSignature(sim.getSignature()));
+	_cached[_size] = it != _cache.end() && it->second.signature == sim.getSignature();
+	if (_cached[_size])
+	{
+		++_hits;
+		sim.setScores(it->second.scores);
+	}
+
+	return int(_size++);
+}
+
+void CombatSimulationBatch::run()
+{
+	std::vector<std::function<void()>> tasks;
+	for (size_t i = 0; i < _size; ++i)
+	{
+		if (!_cached[i])
+		{
+			CombatSimulation * sim = &_sims[i];
+			tasks.push_back([sim]() { sim->simulate(); });
+		}
+	}
+
+	TaskPool::Instance().run(tasks);
+
+	const int now = BWAPI::Broodwar->getFrameCount();
+	for (size_t i = 0; i < _size; ++i)
+	{
+		if (!_cached[i])
+		{
+			CachedResult & result = _cache[hashSignature(_sims[i].getSignature())];
+			result.signature = _sims[i].getSignature();
+			result.scores = _sims[i].getScores();
+			result.frame = now;
+			_sims[i].writeTrace();
+
+			++_simulated;
+			_framesSimulated += _sims[i].getFramesSimulated();
+		}
+		_sims[i].drawScore();
+	}
+
+	if (Config::Debug::DrawCombatSimulationInfo)
+	{
+		drawCacheInfo(150, 210);
+	}
+}
+
+double CombatSimulationBatch::getScore(int index) const
+{
+	return _sims[index].getScore();
+}
+
+void CombatSimulationBatch::drawCacheInfo(int x, int y) const
+{
+	BWAPI::Broodwar->drawTextScreen(x, y, "%cCombat sim cache: %c%d %chits of %c%d %c(%d%%), %d cached",
+		white, orange, _hits, white, orange, _lookups, white,
+		_lookups ? 100 * _hits / _lookups : 0, int(_cache.size()));
+	BWAPI::Broodwar->drawTextScreen(x, y + 10, "%cCombat sims run: %c%d%c, %c%d %cframes on average",
+		white, orange, _simulated, white, orange, _simulated ? int(_framesSimulated / _simulated) : 0, white);
 }
@@ -1,20 +1,98 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "Common.h"
 #include "MapGrid.h"
+#include "FAP.h"
 
 #include "InformationManager.h"
 
 namespace UAlbertaBot
 {
+// Scores of what-if simulations of one fight, from our point of view like simulateCombat().
+// A plan that doesn't apply (no reinforcements in reach, no workers nearby)
+// gets the fight-now score.
+struct CombatPlanScores
+{
+	double	fightNow;
+	double	reinforced;			// fight, and the reinforcements in reach join after a delay
+	double	workersPulled;		// fight now with the nearby workers too
+	int		reinforcements;		// units added by the plans
+	int		workers;
+};
+
 class CombatSimulation
 {
+	FastAPproximation	_fap;
+	std::pair<int, int>	_scores;
+	std::vector<int>	_signature;		// the units of both sides, quantized and sorted
+	std::string			_trace;			// the starting state, if TraceCombatSim is on
+	int					_frames;		// simulated, which can differ from the nominal length
+
+	void addToSignature(bool enemy, BWAPI::UnitType type, int hp, int shields, bool stimmed,
+		const BWAPI::Position & pos, const BWAPI::Position & center);
+
 public:
 
 	CombatSimulation();
 
 	void setCombatUnits(const BWAPI::Position & center, const int radius);
+	const std::vector<int> & getSignature() const { return _signature; };
 
+	// simulateCombat() does it all. Or, to run on another thread, call simulate() there
+	// and the rest on the main thread.
 	double simulateCombat();
+
+	void simulate();
+	double getScore() const;
+	void drawScore() const;
+	void writeTrace() const;
+
+	void simulatePlans(const BWAPI::Position & center, int reinforceFrames, CombatPlanScores & plans);
+
+	int getFramesSimulated() const { return _frames; };
+
+	const std::pair<int, int> & getScores() const { return _scores; };
+	void setScores(const std::pair<int, int> & scores) { _scores = scores; };
+};
+
+// All the squads' combat simulations for a frame, run side by side on the TaskPool.
+// Set up each one with add() on the main thread, then run() them all at once.
+// The simulations are kept from frame to frame to reuse their storage.
+// Recent results are cached by signature. In a standoff the armies hardly change, and the
+// simulation would give the same answer again; the quantization of the signature is
+// the tolerance for "hardly".
+class CombatSimulationBatch
+{
+	struct CachedResult
+	{
+		std::vector<int>		signature;
+		std::pair<int, int>		scores;
+		int						frame;
+	};
+
+	std::vector<CombatSimulation>	_sims;
+	std::vector<char>				_cached;	// the sim's scores came from the cache
+	size_t							_size;
+
+	std::unordered_map<size_t, CachedResult>	_cache;		// by hash of the signature
+	int								_lookups;
+	int								_hits;
+	int								_simulated;		// sims run, not from the cache
+	long long						_framesSimulated;
+
+	static size_t hashSignature(const std::vector<int> & signature);
+
+public:
+
+	CombatSimulationBatch();
+
+	void	clear();
+	int		add(const BWAPI::Position & center, const int radius);
+	void	run();
+	double	getScore(int index) const;
+
+	void	drawCacheInfo(int x, int y) const;
 };
-}
\ No newline at end of file
+}
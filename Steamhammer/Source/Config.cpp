@@ -73,6 +73,10 @@ namespace Config
 		bool DrawUnitOrders					= false;
         bool DrawSquadInfo                  = false;
         bool DrawBOSSStateInfo              = false;
+		bool DrawThreatGrid					= false;
+		bool DrawMapAnalysis				= false;
+		bool DrawBaseLayout					= false;
+		bool TraceCombatSim					= false;	// record combat sims for Tools/FAPReplay
 
         std::string ErrorLogFilename        = "Steamhammer_ErrorLog.txt";
         bool LogAssertToErrorFile           = false;
@@ -93,6 +97,12 @@ namespace Config
         int CombatRegroupRadius             = 300;      // radius of units around frontmost unit for combat sim
         int UnitNearEnemyRadius             = 600;      // radius to consider a unit 'near' to an enemy unit
 		int ScoutDefenseRadius				= 600;		// radius to chase enemy scout worker
+		bool CombatSimFixedPoint			= false;	// deterministic fixed point combat sim
+		bool CombatSimAdaptive				= true;		// stop early or go on, depending on the fight
+		int CombatSimMaxFrames				= 192;		// longest adaptive combat sim
+		int CombatSimDecisivePercent		= 90;		// loss that ends an adaptive combat sim
+		int SquadUpdateInterval				= 4;		// frames between updates of squads out of combat
+		int SquadUpdateBudgetMs				= 4;		// time per frame for updating squads out of combat
     }
 
     namespace Macro
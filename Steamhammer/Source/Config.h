@@ -72,6 +72,10 @@ namespace Config
         extern bool DrawBuildingInfo;
 		extern bool DrawReservedBuildingTiles;
 		extern bool DrawBOSSStateInfo;
+		extern bool DrawThreatGrid;
+		extern bool DrawMapAnalysis;
+		extern bool DrawBaseLayout;
+		extern bool TraceCombatSim;
 
         extern std::string ErrorLogFilename;
         extern bool LogAssertToErrorFile;
@@ -92,6 +96,12 @@ namespace Config
         extern int CombatRegroupRadius;         
         extern int UnitNearEnemyRadius;         
 		extern int ScoutDefenseRadius;
+		extern bool CombatSimFixedPoint;
+		extern bool CombatSimAdaptive;
+		extern int CombatSimMaxFrames;
+		extern int CombatSimDecisivePercent;
+		extern int SquadUpdateInterval;
+		extern int SquadUpdateBudgetMs;
 	}
     
     namespace Macro
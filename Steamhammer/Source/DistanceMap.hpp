@@ -34,6 +34,7 @@ public:
 	}
 
 	short int & operator [] (const short int index)			{ return dist[index]; }
+	int getDistance(const int index) const					{ return dist[index]; }
 	short int & operator [] (const BWAPI::Position & pos)	{ return dist[getIndex(pos.y / 32, pos.x / 32)]; }
 	void setDistance(const short int index, const int val)	{ dist[index] = val; }
 
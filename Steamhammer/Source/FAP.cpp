@@ -1,16 +1,217 @@
 #include "FAP.h"
 #include "BWAPI.h"
-
-UAlbertaBot::FastAPproximation fap;
+#include "../../BOSS/source/Timer.hpp"
+#include <climits>
+#include <cstring>
+#include <iomanip>
+#include <random>
 
 namespace UAlbertaBot {
 
-	FastAPproximation::FastAPproximation() {
+	// Below this many enemies, scanning them all is faster than keeping the target index.
+	// Measured with benchmarkTargetSearch().
+	const int DefaultIndexMinUnits = 32;
+
+	// Trace files start with this, then the format version.
+	const char TraceMagic[4] = { 'F', 'A', 'P', 'T' };
+	const int TraceVersion = 2;
+
+	// Adaptive simulation: Check the scores this often, and at the nominal length,
+	// go on while neither side has lost this much.
+	const int AdaptiveCheckFrames = 8;
+	const int SlowFightPercent = 10;
+
+	FastAPproximation::FastAPproximation()
+		: indexedSide(nullptr)
+		, indexMinUnits(DefaultIndexMinUnits)
+		, fixedPoint(false)
+	{
+
+	}
+
+	FastAPproximation::UnitStats::UnitStats(const FAPUnit & fu)
+		: maxHealth(fu.maxHealth)
+		, armor(fu.armor)
+		, shieldArmor(fu.shieldArmor)
+		, maxShields(fu.maxShields)
+		, speed(fu.speed)
+		, speedFP(int(fu.speed * 256.0 + 0.5))
+		, elevation(fu.elevation)
+		, unitSize(fu.unitSize.getID())
+		, groundDamage(fu.groundDamage)
+		, groundCooldown(fu.groundCooldown)
+		, groundMaxRange(fu.groundMaxRange)
+		, groundMinRange(fu.groundMinRange)
+		, groundDamageType(fu.groundDamageType.getID())
+		, airDamage(fu.airDamage)
+		, airCooldown(fu.airCooldown)
+		, airMaxRange(fu.airMaxRange)
+		, airMinRange(fu.airMinRange)
+		, airDamageType(fu.airDamageType.getID())
+		, unitType(fu.unitType)
+		, player(fu.player)
+		, isOrganic(fu.isOrganic)
+		, score(fu.score)
+	{
+	}
+
+	void FastAPproximation::Side::push(const FAPUnit & fu) {
+		if (fu.unitType == BWAPI::UnitTypes::Terran_Bunker && !hasBunkerMarine) {
+			UAlbertaBot::UnitInfo ui;
+			ui.lastPosition = BWAPI::Position(fu.x, fu.y);
+			ui.player = fu.player;
+			ui.type = BWAPI::UnitTypes::Terran_Marine;
+
+			bunkerMarine = UnitStats(FAPUnit(ui));
+			hasBunkerMarine = true;
+		}
+
+		push(UnitStats(fu), fu.x, fu.y, fu.flying, fu.health, fu.shields, fu.attackCooldownRemaining);
+	}
+
+	void FastAPproximation::Side::push(const UnitStats & s, int ux, int uy, bool isFlying, int hp, int sh, int cooldown) {
+		x.push_back(ux);
+		y.push_back(uy);
+		flying.push_back(isFlying);
+		health.push_back(hp);
+		shields.push_back(sh);
+		attackCooldownRemaining.push_back(cooldown);
+		healTimer.push_back(0);
+		didHealThisFrame.push_back(false);
+		suicided.push_back(false);
+		stats.push_back(s);
+	}
+
+	void FastAPproximation::Side::append(const Side & other) {
+		x.insert(x.end(), other.x.begin(), other.x.end());
+		y.insert(y.end(), other.y.begin(), other.y.end());
+		flying.insert(flying.end(), other.flying.begin(), other.flying.end());
+		health.insert(health.end(), other.health.begin(), other.health.end());
+		shields.insert(shields.end(), other.shields.begin(), other.shields.end());
+		attackCooldownRemaining.insert(attackCooldownRemaining.end(), other.attackCooldownRemaining.begin(), other.attackCooldownRemaining.end());
+		healTimer.insert(healTimer.end(), other.healTimer.begin(), other.healTimer.end());
+		didHealThisFrame.insert(didHealThisFrame.end(), other.didHealThisFrame.begin(), other.didHealThisFrame.end());
+		suicided.insert(suicided.end(), other.suicided.begin(), other.suicided.end());
+		stats.insert(stats.end(), other.stats.begin(), other.stats.end());
+		nSuicided += other.nSuicided;
+
+		if (!hasBunkerMarine && other.hasBunkerMarine) {
+			bunkerMarine = other.bunkerMarine;
+			hasBunkerMarine = true;
+		}
+	}
+
+	void FastAPproximation::Side::swapRemove(size_t i) {
+		const size_t last = size() - 1;
+
+		x[i] = x[last]; x.pop_back();
+		y[i] = y[last]; y.pop_back();
+		flying[i] = flying[last]; flying.pop_back();
+		health[i] = health[last]; health.pop_back();
+		shields[i] = shields[last]; shields.pop_back();
+		attackCooldownRemaining[i] = attackCooldownRemaining[last]; attackCooldownRemaining.pop_back();
+		healTimer[i] = healTimer[last]; healTimer.pop_back();
+		didHealThisFrame[i] = didHealThisFrame[last]; didHealThisFrame.pop_back();
+		suicided[i] = suicided[last]; suicided.pop_back();
+		stats[i] = stats[last]; stats.pop_back();
+	}
+
+	// Compact out the flagged suicide units, keeping the order of the rest.
+	void FastAPproximation::Side::removeSuicided() {
+		if (!nSuicided)
+			return;
+
+		size_t to = 0;
+		for (size_t from = 0; from < size(); ++from) {
+			if (suicided[from])
+				continue;
+
+			if (to != from) {
+				x[to] = x[from];
+				y[to] = y[from];
+				flying[to] = flying[from];
+				health[to] = health[from];
+				shields[to] = shields[from];
+				attackCooldownRemaining[to] = attackCooldownRemaining[from];
+				healTimer[to] = healTimer[from];
+				didHealThisFrame[to] = didHealThisFrame[from];
+				suicided[to] = false;
+				stats[to] = stats[from];
+			}
+			++to;
+		}
+
+		x.resize(to);
+		y.resize(to);
+		flying.resize(to);
+		health.resize(to);
+		shields.resize(to);
+		attackCooldownRemaining.resize(to);
+		healTimer.resize(to);
+		didHealThisFrame.resize(to);
+		suicided.resize(to);
+		stats.resize(to);
+
+		nSuicided = 0;
+	}
+
+	void FastAPproximation::Side::clear() {
+		x.clear(), y.clear(), flying.clear();
+		health.clear(), shields.clear();
+		attackCooldownRemaining.clear(), healTimer.clear(), didHealThisFrame.clear();
+		suicided.clear(), stats.clear();
+		nSuicided = 0;
+		hasBunkerMarine = false;
+	}
+
+	void FastAPproximation::TargetIndex::build(const Side & side, bool byX) {
+		const int n = int(side.size());
+		const std::vector<int> & key = byX ? side.x : side.y;
+		const std::vector<int> & other = byX ? side.y : side.x;
+		alongX = byX;
+
+		order.resize(n);
+		for (int j = 0; j < n; ++j)
+			order[j] = j;
+		std::sort(order.begin(), order.end(), [&key](int a, int b) { return key[a] < key[b]; });
+
+		along.resize(n), across.resize(n), flying.resize(n), unit.resize(n);
+		for (int k = 0; k < n; ++k) {
+			const int j = order[k];
+			along[k] = key[j];
+			across[k] = other[j];
+			flying[k] = side.flying[j];
+			unit[k] = j;
+		}
+	}
+
+	void FastAPproximation::TargetIndex::insert(int u, int x, int y, bool isFlying) {
+		const int a = alongX ? x : y;
+		const size_t k = std::upper_bound(along.begin(), along.end(), a) - along.begin();
+		along.insert(along.begin() + k, a);
+		across.insert(across.begin() + k, alongX ? y : x);
+		flying.insert(flying.begin() + k, isFlying);
+		unit.insert(unit.begin() + k, u);
+	}
+
+	// Unit u was swap-removed from the side: The last unit took its index.
+	void FastAPproximation::TargetIndex::remove(int u, int last) {
+		size_t dead = 0;
+		for (size_t k = 0; k < unit.size(); ++k) {
+			if (unit[k] == u)
+				dead = k;
+			else if (unit[k] == last)
+				unit[k] = u;
+		}
 
+		along.erase(along.begin() + dead);
+		across.erase(across.begin() + dead);
+		flying.erase(flying.begin() + dead);
+		unit.erase(unit.begin() + dead);
 	}
 
 	void FastAPproximation::addUnitPlayer1(FAPUnit fu) {
-		player1.push_back(fu);
+		player1.push(fu);
 	}
 
 	void FastAPproximation::addIfCombatUnitPlayer1(FAPUnit fu) {
@@ -19,7 +220,7 @@ namespace UAlbertaBot {
 	}
 
 	void FastAPproximation::addUnitPlayer2(FAPUnit fu) {
-		player2.push_back(fu);
+		player2.push(fu);
 	}
 
 	void FastAPproximation::addIfCombatUnitPlayer2(FAPUnit fu) {
@@ -27,252 +228,517 @@ namespace UAlbertaBot {
 			addUnitPlayer2(fu);
 	}
 
-	void FastAPproximation::simulate(int nFrames) {
-		while (nFrames--) {
+	int FastAPproximation::simulate(int nFrames) {
+		int frames = 0;
+		while (frames < nFrames) {
 			if (!player1.size() || !player2.size())
 				break;
 
 			didSomething = false;
 
 			isimulate();
+			++frames;
 
 			if (!didSomething)
 				break;
 		}
+		return frames;
 	}
 
-	std::pair <int, int> FastAPproximation::playerScores() const {
-		std::pair <int, int> res;
+	static int percentLost(int start, int now) {
+		return start > 0 ? 100 * (start - now) / start : 0;
+	}
 
-		for (auto & u : player1)
-			if (u.health && u.maxHealth)
-				res.first += (u.score * u.health) / (u.maxHealth * 2);
+	int FastAPproximation::simulateAdaptive(int nFrames, int maxFrames, int decisivePercent) {
+		const std::pair<int, int> start = playerScores();
 
-		for (auto & u : player2)
-			if (u.health && u.maxHealth)
-				res.second += (u.score * u.health) / (u.maxHealth * 2);
+		int frames = 0;
+		while (frames < maxFrames) {
+			const int until = frames < nFrames ? nFrames : maxFrames;
+			const int chunk = std::min(AdaptiveCheckFrames, until - frames);
+			const int done = simulate(chunk);
+			frames += done;
+			if (done < chunk)
+				break;		// one side is gone, or nobody can do anything
 
-		return res;
+			const std::pair<int, int> now = playerScores();
+			const int lost1 = percentLost(start.first, now.first);
+			const int lost2 = percentLost(start.second, now.second);
+
+			if ((now.first < now.second && lost1 >= decisivePercent) ||
+				(now.second < now.first && lost2 >= decisivePercent))
+				break;
+
+			if (frames >= nFrames && (lost1 >= SlowFightPercent || lost2 >= SlowFightPercent))
+				break;
+		}
+		return frames;
 	}
 
-	std::pair <int, int> FastAPproximation::playerScoresUnits() const {
+	std::pair <int, int> FastAPproximation::scores(const Side & side1, const Side & side2, bool units, bool buildings) {
 		std::pair <int, int> res;
 
-		for (auto & u : player1)
-			if (u.health && u.maxHealth && !u.unitType.isBuilding())
-				res.first += (u.score * u.health) / (u.maxHealth * 2);
+		for (size_t i = 0; i < side1.size(); ++i) {
+			const UnitStats & s = side1.stats[i];
+			if (side1.health[i] && s.maxHealth && (s.unitType.isBuilding() ? buildings : units))
+				res.first += (s.score * side1.health[i]) / (s.maxHealth * 2);
+		}
 
-		for (auto & u : player2)
-			if (u.health && u.maxHealth && !u.unitType.isBuilding())
-				res.second += (u.score * u.health) / (u.maxHealth * 2);
+		for (size_t i = 0; i < side2.size(); ++i) {
+			const UnitStats & s = side2.stats[i];
+			if (side2.health[i] && s.maxHealth && (s.unitType.isBuilding() ? buildings : units))
+				res.second += (s.score * side2.health[i]) / (s.maxHealth * 2);
+		}
 
 		return res;
 	}
 
+	std::pair <int, int> FastAPproximation::playerScores() const {
+		return scores(player1, player2, true, true);
+	}
+
+	std::pair <int, int> FastAPproximation::playerScoresUnits() const {
+		return scores(player1, player2, true, false);
+	}
+
 	std::pair <int, int> FastAPproximation::playerScoresBuildings() const {
-		std::pair <int, int> res;
+		return scores(player1, player2, false, true);
+	}
+
+	void FastAPproximation::clearState() {
+		player1.clear(), player2.clear();
+	}
 
-		for (auto & u : player1)
-			if (u.health && u.maxHealth && u.unitType.isBuilding())
-				res.first += (u.score * u.health) / (u.maxHealth * 2);
+	static void putInt(std::ostream & out, int n) {
+		const unsigned u = unsigned(n);
+		const char bytes[4] = { char(u), char(u >> 8), char(u >> 16), char(u >> 24) };
+		out.write(bytes, 4);
+	}
 
-		for (auto & u : player2)
-			if (u.health && u.maxHealth && u.unitType.isBuilding())
-				res.second += (u.score * u.health) / (u.maxHealth * 2);
+	static bool getInt(std::istream & in, int & n) {
+		unsigned char bytes[4];
+		if (!in.read((char *)bytes, 4))
+			return false;
+		n = int(unsigned(bytes[0]) | unsigned(bytes[1]) << 8 | unsigned(bytes[2]) << 16 | unsigned(bytes[3]) << 24);
+		return true;
+	}
 
-		return res;
+	// A double goes by its bits, so that it reads back exactly.
+	static void putDouble(std::ostream & out, double d) {
+		unsigned long long bits;
+		memcpy(&bits, &d, sizeof(bits));
+		putInt(out, int(bits & 0xffffffff));
+		putInt(out, int(bits >> 32));
 	}
 
-	std::pair<std::vector<FastAPproximation::FAPUnit>*, std::vector<FastAPproximation::FAPUnit>*> FastAPproximation::getState() {
-		return { &player1, &player2 };
+	static bool getDouble(std::istream & in, double & d) {
+		int lo, hi;
+		if (!getInt(in, lo) || !getInt(in, hi))
+			return false;
+		const unsigned long long bits = (unsigned long long)unsigned(hi) << 32 | unsigned(lo);
+		memcpy(&d, &bits, sizeof(d));
+		return true;
 	}
 
-	void FastAPproximation::clearState() {
-		player1.clear(), player2.clear();
+	void FastAPproximation::UnitStats::write(std::ostream & out) const {
+		const int fields[] = {
+			maxHealth, armor, shieldArmor, maxShields, speedFP, elevation, unitSize,
+			groundDamage, groundCooldown, groundMaxRange, groundMinRange, groundDamageType,
+			airDamage, airCooldown, airMaxRange, airMinRange, airDamageType,
+			unitType.getID(), isOrganic, score
+		};
+		for (int field : fields)
+			putInt(out, field);
+		putDouble(out, speed);
+	}
+
+	bool FastAPproximation::UnitStats::read(std::istream & in) {
+		int * fields[] = {
+			&maxHealth, &armor, &shieldArmor, &maxShields, &speedFP, &elevation, &unitSize,
+			&groundDamage, &groundCooldown, &groundMaxRange, &groundMinRange, &groundDamageType,
+			&airDamage, &airCooldown, &airMaxRange, &airMinRange, &airDamageType
+		};
+		for (int * field : fields)
+			if (!getInt(in, *field))
+				return false;
+
+		int type, organic;
+		if (!getInt(in, type) || !getInt(in, organic) || !getInt(in, score) || !getDouble(in, speed))
+			return false;
+		unitType = BWAPI::UnitType(type);
+		isOrganic = organic != 0;
+		player = nullptr;
+		return true;
+	}
+
+	void FastAPproximation::Side::write(std::ostream & out) const {
+		putInt(out, int(size()));
+		for (size_t i = 0; i < size(); ++i) {
+			putInt(out, x[i]);
+			putInt(out, y[i]);
+			putInt(out, flying[i]);
+			putInt(out, health[i]);
+			putInt(out, shields[i]);
+			putInt(out, attackCooldownRemaining[i]);
+			putInt(out, healTimer[i]);
+			putInt(out, didHealThisFrame[i]);
+			stats[i].write(out);
+		}
+
+		putInt(out, hasBunkerMarine);
+		if (hasBunkerMarine)
+			bunkerMarine.write(out);
+	}
+
+	bool FastAPproximation::Side::read(std::istream & in) {
+		clear();
+
+		int n;
+		if (!getInt(in, n) || n < 0)
+			return false;
+		for (int i = 0; i < n; ++i) {
+			int ux, uy, isFlying, hp, sh, cooldown, timer, didHeal;
+			UnitStats s;
+			if (!getInt(in, ux) || !getInt(in, uy) || !getInt(in, isFlying) || !getInt(in, hp) || !getInt(in, sh) ||
+				!getInt(in, cooldown) || !getInt(in, timer) || !getInt(in, didHeal) || !s.read(in))
+				return false;
+			push(s, ux, uy, isFlying != 0, hp, sh, cooldown);
+			healTimer.back() = timer;
+			didHealThisFrame.back() = didHeal != 0;
+		}
+
+		int marine;
+		if (!getInt(in, marine))
+			return false;
+		hasBunkerMarine = marine != 0;
+		return !hasBunkerMarine || bunkerMarine.read(in);
+	}
+
+	void FastAPproximation::writeTraceHeader(std::ostream & out) {
+		out.write(TraceMagic, sizeof(TraceMagic));
+		putInt(out, TraceVersion);
+	}
+
+	bool FastAPproximation::readTraceHeader(std::istream & in) {
+		char magic[sizeof(TraceMagic)];
+		int version;
+		return
+			in.read(magic, sizeof(magic)) &&
+			!memcmp(magic, TraceMagic, sizeof(magic)) &&
+			getInt(in, version) &&
+			version == TraceVersion;
+	}
+
+	void FastAPproximation::writeTraceStart(std::ostream & out, int frame) const {
+		putInt(out, frame);
+		putInt(out, fixedPoint);
+		player1.write(out);
+		player2.write(out);
+	}
+
+	void FastAPproximation::writeTraceEnd(std::ostream & out, int nFrames, std::pair<int, int> scores) {
+		putInt(out, nFrames);
+		putInt(out, scores.first);
+		putInt(out, scores.second);
+	}
+
+	// Load the starting state of the next record, and return what the live simulation did with it.
+	bool FastAPproximation::readTraceRecord(std::istream & in, int & frame, int & nFrames, std::pair<int, int> & scores) {
+		int fixed;
+		if (!getInt(in, frame) || !getInt(in, fixed) ||
+			!player1.read(in) || !player2.read(in) ||
+			!getInt(in, nFrames) || !getInt(in, scores.first) || !getInt(in, scores.second))
+			return false;
+		fixedPoint = fixed != 0;
+		return true;
 	}
 
-	void FastAPproximation::dealDamage(const FastAPproximation::FAPUnit &fu, int damage, BWAPI::DamageType damageType) const {
-		if (fu.shields >= damage - fu.shieldArmor) {
-			fu.shields -= damage - fu.shieldArmor;
+	void FastAPproximation::addUnitsPlayer1(const FastAPproximation & from) {
+		player1.append(from.player1);
+	}
+
+	void FastAPproximation::dealDamage(Side & side, size_t i, int damage, int damageType) const {
+		const UnitStats & s = side.stats[i];
+		int & shields = side.shields[i];
+
+		if (shields >= damage - s.shieldArmor) {
+			shields -= damage - s.shieldArmor;
 			return;
 		}
-		else if(fu.shields) {
-			damage -= (fu.shields + fu.shieldArmor);
-			fu.shields = 0;
+		else if(shields) {
+			damage -= (shields + s.shieldArmor);
+			shields = 0;
 		}
 
 
 		if (!damage)
 			return;
 
-		if (damageType == BWAPI::DamageTypes::Concussive) {
-			if(fu.unitSize == BWAPI::UnitSizeTypes::Large)
+		if (damageType == BWAPI::DamageTypes::Concussive.getID()) {
+			if(s.unitSize == BWAPI::UnitSizeTypes::Large.getID())
 				damage = damage / 4;
-			else if(fu.unitSize == BWAPI::UnitSizeTypes::Medium)
+			else if(s.unitSize == BWAPI::UnitSizeTypes::Medium.getID())
 				damage = damage / 2;
 		}
-		else if (damageType == BWAPI::DamageTypes::Explosive) {
-			if (fu.unitSize == BWAPI::UnitSizeTypes::Small)
+		else if (damageType == BWAPI::DamageTypes::Explosive.getID()) {
+			if (s.unitSize == BWAPI::UnitSizeTypes::Small.getID())
 				damage = damage / 2;
-			else if (fu.unitSize == BWAPI::UnitSizeTypes::Medium)
+			else if (s.unitSize == BWAPI::UnitSizeTypes::Medium.getID())
 				damage = (damage * 3) / 4;
 		}
 
-		fu.health -= std::max(1, damage - fu.armor);
+		side.health[i] -= std::max(1, damage - s.armor);
+	}
+
+	// The closest enemy that unit i can shoot at, or -1 if none. Ties go to the lower index.
+	// Against few enemies, the scan is over the contiguous position arrays, with no early exits.
+	int FastAPproximation::nearestTarget(const Side & us, size_t i, const Side & enemies, int & closestDist) const {
+		const UnitStats & s = us.stats[i];
+		const int ux = us.x[i];
+		const int uy = us.y[i];
+
+		// Squared minimum range for each kind of target, or INT_MAX if we can't hit it at all.
+		// Squared distances on the map are far below INT_MAX, so no distance passes INT_MAX.
+		const int groundMin = s.groundDamage ? s.groundMinRange : INT_MAX;
+		const int airMin = s.airDamage ? s.airMinRange : INT_MAX;
+		if (groundMin == INT_MAX && airMin == INT_MAX)
+			return -1;
+
+		if (&enemies == indexedSide)
+			return indexedNearestTarget(ux, uy, groundMin, airMin, closestDist);
+
+		const int * ex = enemies.x.data();
+		const int * ey = enemies.y.data();
+		const char * ef = enemies.flying.data();
+		const int n = int(enemies.size());
+
+		int closest = -1;
+		closestDist = INT_MAX;
+
+		for (int j = 0; j < n; ++j) {
+			const int dx = ux - ex[j];
+			const int dy = uy - ey[j];
+			const int d = dx*dx + dy*dy;
+			const int minRange = ef[j] ? airMin : groundMin;
+			if (d >= minRange && d < closestDist) {
+				closestDist = d;
+				closest = j;
+			}
+		}
+
+		return closest;
+	}
+
+	// The same answer as the full scan, from the target index.
+	// Sweep away from the attacker along the sorted axis, first one way and then the other.
+	// Stop each way when the distance along the axis alone is more than the closest so far.
+	int FastAPproximation::indexedNearestTarget(int ux, int uy, int groundMin, int airMin, int & closestDist) const {
+		const int * ea = targets.along.data();
+		const int * eb = targets.across.data();
+		const char * ef = targets.flying.data();
+		const int * eunit = targets.unit.data();
+		const int n = int(targets.along.size());
+
+		const int ua = targets.alongX ? ux : uy;
+		const int ub = targets.alongX ? uy : ux;
+		const int start = int(std::lower_bound(targets.along.begin(), targets.along.end(), ua) - targets.along.begin());
+
+		int closest = -1;
+		closestDist = INT_MAX;
+
+		for (int k = start; k < n; ++k) {
+			const int da = ea[k] - ua;
+			if (da*da > closestDist)
+				break;
+			const int db = eb[k] - ub;
+			const int d = da*da + db*db;
+			const int minRange = ef[k] ? airMin : groundMin;
+			if (d >= minRange && (d < closestDist || (d == closestDist && eunit[k] < closest))) {
+				closestDist = d;
+				closest = eunit[k];
+			}
+		}
+
+		for (int k = start - 1; k >= 0; --k) {
+			const int da = ua - ea[k];
+			if (da*da > closestDist)
+				break;
+			const int db = eb[k] - ub;
+			const int d = da*da + db*db;
+			const int minRange = ef[k] ? airMin : groundMin;
+			if (d >= minRange && (d < closestDist || (d == closestDist && eunit[k] < closest))) {
+				closestDist = d;
+				closest = eunit[k];
+			}
+		}
+
+		return closest;
 	}
 
-	int inline FastAPproximation::distButNotReally(const FastAPproximation::FAPUnit &u1, const FastAPproximation::FAPUnit &u2) const {
-		return (u1.x - u2.x)*(u1.x - u2.x) + (u1.y - u2.y)*(u1.y - u2.y);
+	// Index the enemies if there are enough of them to pay for it.
+	// Sort them along the axis on which the whole battle is spread the most; usually
+	// that is the axis the two sides face each other on, so the sweep is short.
+	void FastAPproximation::startTurn(const Side & us, const Side & enemies) {
+		if (int(enemies.size()) < indexMinUnits) {
+			indexedSide = nullptr;
+			return;
+		}
+
+		int left = INT_MAX, right = INT_MIN, top = INT_MAX, bottom = INT_MIN;
+		for (const Side * side : { &us, &enemies }) {
+			for (size_t j = 0; j < side->size(); ++j) {
+				left = std::min(left, side->x[j]);
+				right = std::max(right, side->x[j]);
+				top = std::min(top, side->y[j]);
+				bottom = std::max(bottom, side->y[j]);
+			}
+		}
+
+		targets.build(enemies, right - left >= bottom - top);
+		indexedSide = &enemies;
 	}
 
 	bool FastAPproximation::isSuicideUnit(BWAPI::UnitType ut) {
 		return (ut == BWAPI::UnitTypes::Zerg_Scourge || ut == BWAPI::UnitTypes::Terran_Vulture_Spider_Mine || ut == BWAPI::UnitTypes::Zerg_Infested_Terran);
 	}
 
-	void FastAPproximation::unitsim(const FastAPproximation::FAPUnit &fu, std::vector <FastAPproximation::FAPUnit> &enemyUnits) {
-		if (fu.attackCooldownRemaining) {
+	// Integer square root, rounded down, the same on every machine. The floating point
+	// square root is only a first guess; the corrections make the result exact.
+	// n must be below 2^52 so that it converts to double exactly.
+	static long long isqrt(long long n) {
+		long long root = (long long)sqrt(double(n));
+		while (root * root > n)
+			--root;
+		while ((root + 1) * (root + 1) <= n)
+			++root;
+		return root;
+	}
+
+	// Whether a target distSq away (squared pixels) is within one frame's move.
+	bool FastAPproximation::withinStep(const UnitStats & s, int distSq) const {
+		if (fixedPoint)
+			return (long long)distSq << 16 <= (long long)s.speedFP * s.speedFP;
+		return sqrt(distSq) <= s.speed;
+	}
+
+	// Move one frame's distance toward the target, which is farther than that.
+	void FastAPproximation::stepToward(Side & us, size_t i, int tx, int ty, int distSq) const {
+		const UnitStats & s = us.stats[i];
+		const int dx = tx - us.x[i], dy = ty - us.y[i];
+
+		if (fixedPoint) {
+			const long long distFP = isqrt((long long)distSq << 16);	// 256 * dist
+
+			us.x[i] += int(dx * (long long)s.speedFP / distFP);
+			us.y[i] += int(dy * (long long)s.speedFP / distFP);
+		}
+		else {
+			const double step = s.speed / sqrt(distSq);
+
+			us.x[i] += (int)(dx*step);
+			us.y[i] += (int)(dy*step);
+		}
+	}
+
+	void FastAPproximation::unitsim(Side & us, size_t i, Side & enemies) {
+		if (us.attackCooldownRemaining[i]) {
 			didSomething = true;
 			return;
 		}
 
-		auto closestEnemy = enemyUnits.end();
 		int closestDist;
+		const int closest = nearestTarget(us, i, enemies, closestDist);
+		if (closest < 0)
+			return;
 
-		for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++ enemyIt) {
-			if (enemyIt->flying) {
-				if (fu.airDamage) {
-					int d = distButNotReally(fu, *enemyIt);
-					if ((closestEnemy == enemyUnits.end() || d < closestDist) && d >= fu.airMinRange) {
-						closestDist = d;
-						closestEnemy = enemyIt;
-					}
-				}
-			}
-			else {
-				if (fu.groundDamage) {
-					int d = distButNotReally(fu, *enemyIt);
-					if ((closestEnemy == enemyUnits.end() || d < closestDist) && d >= fu.groundMinRange) {
-						closestDist = d;
-						closestEnemy = enemyIt;
-					}
-				}
-			}
-		}
+		const UnitStats & s = us.stats[i];
+		const bool inReach = withinStep(s, closestDist);
 
-		if (closestEnemy != enemyUnits.end() && sqrt(closestDist) <= fu.speed && !(fu.x == closestEnemy->x && fu.y == closestEnemy->y)) {
-			fu.x = closestEnemy->x;
-			fu.y = closestEnemy->y;
+		if (inReach && !(us.x[i] == enemies.x[closest] && us.y[i] == enemies.y[closest])) {
+			us.x[i] = enemies.x[closest];
+			us.y[i] = enemies.y[closest];
 			closestDist = 0;
 
 			didSomething = true;
 		}
 
-		if (closestEnemy != enemyUnits.end() && closestDist <= (closestEnemy->flying ? fu.groundMaxRange : fu.airMinRange)) {
-			if (closestEnemy->flying)
-				dealDamage(*closestEnemy, fu.airDamage, fu.airDamageType), fu.attackCooldownRemaining = fu.airCooldown;
+		if (closestDist <= (enemies.flying[closest] ? s.groundMaxRange : s.airMinRange)) {
+			if (enemies.flying[closest])
+				dealDamage(enemies, closest, s.airDamage, s.airDamageType), us.attackCooldownRemaining[i] = s.airCooldown;
 			else {
-				dealDamage(*closestEnemy, fu.groundDamage, fu.groundDamageType);
-				fu.attackCooldownRemaining = fu.groundCooldown;
-				if (fu.elevation != -1 && closestEnemy->elevation != -1)
-					if (closestEnemy->elevation > fu.elevation)
-						fu.attackCooldownRemaining += fu.groundCooldown;
+				dealDamage(enemies, closest, s.groundDamage, s.groundDamageType);
+				us.attackCooldownRemaining[i] = s.groundCooldown;
+				if (s.elevation != -1 && enemies.stats[closest].elevation != -1)
+					if (enemies.stats[closest].elevation > s.elevation)
+						us.attackCooldownRemaining[i] += s.groundCooldown;
 			}
 
-			if (closestEnemy->health < 1) {
-				auto temp = *closestEnemy;
-				*closestEnemy = enemyUnits.back();
-				enemyUnits.pop_back();
-				unitDeath(temp, enemyUnits);
-			}
+			if (enemies.health[closest] < 1)
+				killUnit(enemies, closest);
 
 			didSomething = true;
 			return;
 		}
-		else if(closestEnemy != enemyUnits.end() && sqrt(closestDist) > fu.speed) {
-			int dx = closestEnemy->x - fu.x, dy = closestEnemy->y - fu.y;
+		else if (!inReach) {
+			stepToward(us, i, enemies.x[closest], enemies.y[closest], closestDist);
 
-			fu.x += (int)(dx*(fu.speed / sqrt(dx*dx + dy*dy)));
-			fu.y += (int)(dy*(fu.speed / sqrt(dx*dx + dy*dy)));
-				
 			didSomething = true;
 			return;
 		}
 	}
 
-	void FastAPproximation::medicsim(const FAPUnit & fu, std::vector<FAPUnit> &friendlyUnits) {
-		auto closestHealable = friendlyUnits.end();
+	void FastAPproximation::medicsim(Side & us, size_t i) {
+		int closestHealable = -1;
 		int closestDist;
 
-		for (auto it = friendlyUnits.begin(); it != friendlyUnits.end(); ++it) {
-			if (it->isOrganic && it->health < it->maxHealth && !it->didHealThisFrame) {
-				int d = distButNotReally(fu, *it);
-				if (closestHealable == friendlyUnits.end() || d < closestDist) {
-					closestHealable = it;
+		for (size_t j = 0; j < us.size(); ++j) {
+			if (us.stats[j].isOrganic && us.health[j] < us.stats[j].maxHealth && !us.didHealThisFrame[j] && !us.suicided[j]) {
+				const int dx = us.x[i] - us.x[j];
+				const int dy = us.y[i] - us.y[j];
+				const int d = dx*dx + dy*dy;
+				if (closestHealable == -1 || d < closestDist) {
+					closestHealable = j;
 					closestDist = d;
 				}
 			}
 		}
 
-		if (closestHealable != friendlyUnits.end()) {
-			fu.x = closestHealable->x;
-			fu.y = closestHealable->y;
+		if (closestHealable != -1) {
+			us.x[i] = us.x[closestHealable];
+			us.y[i] = us.y[closestHealable];
 
-			closestHealable->health += (closestHealable->healTimer += 400) / 256;
-			closestHealable->healTimer %= 256;
+			us.health[closestHealable] += (us.healTimer[closestHealable] += 400) / 256;
+			us.healTimer[closestHealable] %= 256;
 
-			if (closestHealable->health > closestHealable->maxHealth)
-				closestHealable->health = closestHealable->maxHealth;
+			if (us.health[closestHealable] > us.stats[closestHealable].maxHealth)
+				us.health[closestHealable] = us.stats[closestHealable].maxHealth;
 
-			closestHealable->didHealThisFrame = false;
+			us.didHealThisFrame[closestHealable] = false;
 		}
 	}
 
-	bool FastAPproximation::suicideSim(const FAPUnit & fu, std::vector<FAPUnit>& enemyUnits) {
-		auto closestEnemy = enemyUnits.end();
+	bool FastAPproximation::suicideSim(Side & us, size_t i, Side & enemies) {
 		int closestDist;
+		const int closest = nearestTarget(us, i, enemies, closestDist);
+		if (closest < 0)
+			return false;
 
-		for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++enemyIt) {
-			if (enemyIt->flying) {
-				if (fu.airDamage) {
-					int d = distButNotReally(fu, *enemyIt);
-					if ((closestEnemy == enemyUnits.end() || d < closestDist) && d >= fu.airMinRange) {
-						closestDist = d;
-						closestEnemy = enemyIt;
-					}
-				}
-			}
-			else {
-				if (fu.groundDamage) {
-					int d = distButNotReally(fu, *enemyIt);
-					if ((closestEnemy == enemyUnits.end() || d < closestDist) && d >= fu.groundMinRange) {
-						closestDist = d;
-						closestEnemy = enemyIt;
-					}
-				}
-			}
-		}
+		const UnitStats & s = us.stats[i];
 
-		if (closestEnemy != enemyUnits.end() && sqrt(closestDist) <= fu.speed) {
-			if(closestEnemy->flying)
-				dealDamage(*closestEnemy, fu.airDamage, fu.airDamageType);
-			else 
-				dealDamage(*closestEnemy, fu.groundDamage, fu.groundDamageType);
+		if (withinStep(s, closestDist)) {
+			if(enemies.flying[closest])
+				dealDamage(enemies, closest, s.airDamage, s.airDamageType);
+			else
+				dealDamage(enemies, closest, s.groundDamage, s.groundDamageType);
 
-			if (closestEnemy->health < 1) {
-				auto temp = *closestEnemy;
-				*closestEnemy = enemyUnits.back();
-				enemyUnits.pop_back();
-				unitDeath(temp, enemyUnits);
-			}
+			if (enemies.health[closest] < 1)
+				killUnit(enemies, closest);
 
 			didSomething = true;
 			return true;
 		}
-		else if (closestEnemy != enemyUnits.end() && sqrt(closestDist) > fu.speed) {
-			int dx = closestEnemy->x - fu.x, dy = closestEnemy->y - fu.y;
-
-			fu.x += (int)(dx*(fu.speed / sqrt(dx*dx + dy*dy)));
-			fu.y += (int)(dy*(fu.speed / sqrt(dx*dx + dy*dy)));
+		else {
+			stepToward(us, i, enemies.x[closest], enemies.y[closest], closestDist);
 
 			didSomething = true;
 		}
@@ -280,120 +746,203 @@ namespace UAlbertaBot {
 		return false;
 	}
 
-	void FastAPproximation::isimulate() {
-		for (auto fu = player1.begin(); fu != player1.end();) {
-			if (isSuicideUnit(fu->unitType)) {
-				bool result = suicideSim(*fu, player2);
-				if (result)
-					fu = player1.erase(fu);
-				else
-					++fu;
-			}
-			else {
-				if (fu->unitType == BWAPI::UnitTypes::Terran_Medic)
-					medicsim(*fu, player1);
-				else
-					unitsim(*fu, player2);
-				++fu;
+	// Swap-remove the dead unit. A bunker leaves behind its 4 marines.
+	// The marines take the bunker's place, cooldown, and elevation (and shield armor,
+	// which a straight copy of the marine's other stats has always left alone).
+	void FastAPproximation::killUnit(Side & side, size_t i) {
+		const UnitStats dead = side.stats[i];
+		const int x = side.x[i];
+		const int y = side.y[i];
+		const int cooldown = side.attackCooldownRemaining[i];
+
+		side.swapRemove(i);
+		if (&side == indexedSide)
+			targets.remove(int(i), int(side.size()));
+
+		if (dead.unitType == BWAPI::UnitTypes::Terran_Bunker) {
+			UnitStats marine = side.bunkerMarine;
+			marine.elevation = dead.elevation;
+			marine.shieldArmor = dead.shieldArmor;
+
+			// The marines come out with the health and shields of a marine that was never seen: none.
+			for (unsigned n = 0; n < 4; ++n) {
+				side.push(marine, x, y, false, 0, 0, cooldown);
+				if (&side == indexedSide)
+					targets.insert(int(side.size()) - 1, x, y, false);
 			}
 		}
+	}
 
-		for (auto fu = player2.begin(); fu != player2.end();) {
-			if (isSuicideUnit(fu->unitType)) {
-				bool result = suicideSim(*fu, player1);
-				if (result)
-					fu = player2.erase(fu);
-				else
-					++fu;
+	void FastAPproximation::isimulate() {
+		startTurn(player1, player2);
+		for (size_t i = 0; i < player1.size(); ++i) {
+			const BWAPI::UnitType type = player1.stats[i].unitType;
+			if (isSuicideUnit(type)) {
+				if (suicideSim(player1, i, player2)) {
+					player1.suicided[i] = true;
+					++player1.nSuicided;
+				}
 			}
-			else {
-				if (fu->unitType == BWAPI::UnitTypes::Terran_Medic)
-					medicsim(*fu, player2);
-				else
-					unitsim(*fu, player1);
-				++fu;
+			else if (type == BWAPI::UnitTypes::Terran_Medic)
+				medicsim(player1, i);
+			else
+				unitsim(player1, i, player2);
+		}
+		player1.removeSuicided();
+
+		startTurn(player2, player1);
+		for (size_t i = 0; i < player2.size(); ++i) {
+			const BWAPI::UnitType type = player2.stats[i].unitType;
+			if (isSuicideUnit(type)) {
+				if (suicideSim(player2, i, player1)) {
+					player2.suicided[i] = true;
+					++player2.nSuicided;
+				}
 			}
+			else if (type == BWAPI::UnitTypes::Terran_Medic)
+				medicsim(player2, i);
+			else
+				unitsim(player2, i, player1);
 		}
+		player2.removeSuicided();
+		indexedSide = nullptr;
 
-		for (auto &fu : player1) {
-			if (fu.attackCooldownRemaining)
-				--fu.attackCooldownRemaining;
-			if (fu.didHealThisFrame)
-				fu.didHealThisFrame = false;
+		for (size_t i = 0; i < player1.size(); ++i) {
+			if (player1.attackCooldownRemaining[i])
+				--player1.attackCooldownRemaining[i];
+			player1.didHealThisFrame[i] = false;
 		}
 
-		for (auto &fu : player2) {
-			if (fu.attackCooldownRemaining)
-				--fu.attackCooldownRemaining;
-			if (fu.didHealThisFrame)
-				fu.didHealThisFrame = false;
+		for (size_t i = 0; i < player2.size(); ++i) {
+			if (player2.attackCooldownRemaining[i])
+				--player2.attackCooldownRemaining[i];
+			player2.didHealThisFrame[i] = false;
 		}
 	}
 
-	void FastAPproximation::unitDeath(const FAPUnit &fu, std::vector<FAPUnit> &itsFriendlies) {
-		if (fu.unitType == BWAPI::UnitTypes::Terran_Bunker) {
-			convertToUnitType(fu, BWAPI::UnitTypes::Terran_Marine);
+	// Fight n against n, each side in a loose clump of mixed units, for fight sizes from
+	// tiny to huge. Simulate each fight with the plain scan and with the target index, and
+	// check that the two agree. The index wins from some size on; that is the crossover.
+	int FastAPproximation::benchmarkTargetSearch(BWAPI::Player p1, BWAPI::Player p2, std::ostream & out) {
+		const BWAPI::UnitType types1[] = { BWAPI::UnitTypes::Zerg_Zergling, BWAPI::UnitTypes::Zerg_Hydralisk, BWAPI::UnitTypes::Zerg_Mutalisk, BWAPI::UnitTypes::Zerg_Ultralisk };
+		const BWAPI::UnitType types2[] = { BWAPI::UnitTypes::Terran_Marine, BWAPI::UnitTypes::Protoss_Zealot, BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::UnitTypes::Terran_Wraith };
+		const int sizes[] = { 2, 4, 6, 8, 10, 12, 16, 20, 24, 32, 48, 64, 96, 128 };
+		const int runs = 20;
+
+		std::minstd_rand rng(1);
+		int crossover = INT_MAX;
+
+		out << "units   scan ms  index ms   agree" << std::endl;
+		out << std::fixed << std::setprecision(3);
+
+		for (const int n : sizes) {
+			// Bigger armies stand in bigger clumps.
+			const int spread = 64 + 24 * int(sqrt(double(n)));
+
+			std::vector<FAPUnit> units1, units2;
+			for (int side = 0; side < 2; ++side) {
+				for (int k = 0; k < n; ++k) {
+					UnitInfo ui;
+					ui.player = side ? p2 : p1;
+					ui.type = side ? types2[rng() % 4] : types1[rng() % 4];
+					ui.lastPosition = BWAPI::Position(1000 + side * (spread + 160) + int(rng() % spread), 1000 + int(rng() % spread));
+					ui.lastHealth = ui.type.maxHitPoints();
+					ui.lastShields = ui.type.maxShields();
+					(side ? units2 : units1).push_back(FAPUnit(ui));
+				}
+			}
 
-			for(unsigned i = 0; i < 4; ++ i)
-				itsFriendlies.push_back(fu);
-		}
-	}
+			double ms[2];
+			std::pair<int, int> result[2];
+			for (int useIndex = 0; useIndex < 2; ++useIndex) {
+				ms[useIndex] = 0.0;
+				for (int run = 0; run < runs; ++run) {
+					FastAPproximation sim;
+					sim.setIndexMinUnits(useIndex ? 0 : INT_MAX);
+					for (const FAPUnit & fu : units1)
+						sim.addUnitPlayer1(fu);
+					for (const FAPUnit & fu : units2)
+						sim.addUnitPlayer2(fu);
+
+					BOSS::Timer timer;
+					timer.start();
+					sim.simulate();
+					ms[useIndex] += timer.getElapsedTimeInMilliSec();
+
+					result[useIndex] = sim.playerScores();
+				}
+				ms[useIndex] /= runs;
+			}
 
-	void FastAPproximation::convertToUnitType(const FAPUnit &fu, BWAPI::UnitType ut)
-	{
-		UAlbertaBot::UnitInfo ui;
-		ui.lastPosition = BWAPI::Position(fu.x, fu.y);
-		ui.player = fu.player;
-		ui.type = ut;
+			// The crossover is the smallest size from which the index always wins.
+			if (ms[1] < ms[0]) {
+				if (crossover == INT_MAX)
+					crossover = n;
+			}
+			else
+				crossover = INT_MAX;
 
-		FAPUnit funew(ui);
-		funew.attackCooldownRemaining = fu.attackCooldownRemaining;
-		funew.elevation = fu.elevation;
+			out << std::setw(5) << n << std::setw(10) << ms[0] << std::setw(10) << ms[1]
+				<< "   " << (result[0] == result[1] ? "yes" : "NO") << std::endl;
+		}
 
-		fu.operator=(funew);
+		out << "index from " << crossover << " units" << std::endl;
+		return crossover;
 	}
 
 	FastAPproximation::FAPUnit::FAPUnit(BWAPI::Unit u): FAPUnit(UnitInfo(u)) {
 
 	}
 
+	// The unit's own state goes onto a copy of the type's entry in the table.
 	FastAPproximation::FAPUnit::FAPUnit(UnitInfo ui) :
-		x(ui.lastPosition.x),
-		y(ui.lastPosition.y),
-
-		speed(ui.player->topSpeed(ui.type)),
-
-		health(ui.lastHealth),
-		maxHealth(ui.type.maxHitPoints()),
-
-		shields(ui.lastShields),
-		shieldArmor(ui.player->getUpgradeLevel(BWAPI::UpgradeTypes::Protoss_Plasma_Shields)),
-		maxShields(ui.type.maxShields()),
-		armor(ui.player->armor(ui.type)),
-		flying(ui.type.isFlyer()),
-
-		groundDamage(ui.player->damage(ui.type.groundWeapon())),
-		groundCooldown(ui.type.groundWeapon().damageFactor() && ui.type.maxGroundHits() ? ui.player->weaponDamageCooldown(ui.type) / (ui.type.groundWeapon().damageFactor() * ui.type.maxGroundHits()) : 0),
-		groundMaxRange(ui.player->weaponMaxRange(ui.type.groundWeapon())),
-		groundMinRange(ui.type.groundWeapon().minRange()),
-		groundDamageType(ui.type.groundWeapon().damageType()),
-
-		airDamage(ui.player->damage(ui.type.airWeapon())),
-		airCooldown(ui.type.airWeapon().damageFactor() && ui.type.maxAirHits() ? ui.type.airWeapon().damageCooldown() / (ui.type.airWeapon().damageFactor() * ui.type.maxAirHits()) : 0),
-		airMaxRange(ui.player->weaponMaxRange(ui.type.airWeapon())),
-		airMinRange(ui.type.airWeapon().minRange()),
-		airDamageType(ui.type.airWeapon().damageType()),
-
-		unitType(ui.type),
-		isOrganic(ui.type.isOrganic()),
-		score(ui.type.destroyScore()),
-		player(ui.player)
+		FAPUnit(UnitTypeTable::Instance().get(ui.player, ui.type))
 	{
-		static int nextId = 0;
-		id = nextId++;
+		x = ui.lastPosition.x;
+		y = ui.lastPosition.y;
+
+		health = ui.lastHealth * 2;
+		shields = ui.lastShields * 2;
+
+		if (ui.unit && ui.unit->isStimmed()) {
+			groundCooldown /= 2;
+			airCooldown /= 2;
+		}
+
+		if (ui.unit && ui.unit->isVisible() && !ui.unit->isFlying()) {
+			elevation = BWAPI::Broodwar->getGroundHeight(ui.unit->getTilePosition());
+		}
+	}
+
+	FastAPproximation::FAPUnit::FAPUnit(BWAPI::Player player, BWAPI::UnitType type) :
+		speed(player->topSpeed(type)),
 
-		if (ui.type == BWAPI::UnitTypes::Protoss_Carrier) {
-			groundDamage = ui.player->damage(BWAPI::UnitTypes::Protoss_Interceptor.groundWeapon());
+		maxHealth(type.maxHitPoints()),
+
+		shieldArmor(player->getUpgradeLevel(BWAPI::UpgradeTypes::Protoss_Plasma_Shields)),
+		maxShields(type.maxShields()),
+		armor(player->armor(type)),
+		flying(type.isFlyer()),
+
+		groundDamage(player->damage(type.groundWeapon())),
+		groundCooldown(type.groundWeapon().damageFactor() && type.maxGroundHits() ? player->weaponDamageCooldown(type) / (type.groundWeapon().damageFactor() * type.maxGroundHits()) : 0),
+		groundMaxRange(player->weaponMaxRange(type.groundWeapon())),
+		groundMinRange(type.groundWeapon().minRange()),
+		groundDamageType(type.groundWeapon().damageType()),
+
+		airDamage(player->damage(type.airWeapon())),
+		airCooldown(type.airWeapon().damageFactor() && type.maxAirHits() ? type.airWeapon().damageCooldown() / (type.airWeapon().damageFactor() * type.maxAirHits()) : 0),
+		airMaxRange(player->weaponMaxRange(type.airWeapon())),
+		airMinRange(type.airWeapon().minRange()),
+		airDamageType(type.airWeapon().damageType()),
+
+		unitType(type),
+		isOrganic(type.isOrganic()),
+		score(type.destroyScore()),
+		player(player)
+	{
+		if (type == BWAPI::UnitTypes::Protoss_Carrier) {
+			groundDamage = player->damage(BWAPI::UnitTypes::Protoss_Interceptor.groundWeapon());
 			groundDamageType = BWAPI::UnitTypes::Protoss_Interceptor.groundWeapon().damageType();
 			groundCooldown = 5;
 			groundMaxRange = 32 * 8;
@@ -403,26 +952,17 @@ namespace UAlbertaBot {
 			airCooldown = groundCooldown;
 			airMaxRange = groundMaxRange;
 		}
-		else if (ui.type == BWAPI::UnitTypes::Terran_Bunker) {
-			groundDamage = ui.player->damage(BWAPI::WeaponTypes::Gauss_Rifle);
+		else if (type == BWAPI::UnitTypes::Terran_Bunker) {
+			groundDamage = player->damage(BWAPI::WeaponTypes::Gauss_Rifle);
 			groundCooldown = BWAPI::UnitTypes::Terran_Marine.groundWeapon().damageCooldown() / 4;
-			groundMaxRange = ui.player->weaponMaxRange(BWAPI::UnitTypes::Terran_Marine.groundWeapon()) + 32;
+			groundMaxRange = player->weaponMaxRange(BWAPI::UnitTypes::Terran_Marine.groundWeapon()) + 32;
 
 			airDamage = groundDamage;
 			airCooldown = groundCooldown;
 			airMaxRange = groundMaxRange;
 		}
-		else if (ui.type == BWAPI::UnitTypes::Protoss_Reaver) {
-			groundDamage = ui.player->damage(BWAPI::WeaponTypes::Scarab);
-		}
-
-		if (ui.unit && ui.unit->isStimmed()) {
-			groundCooldown /= 2;
-			airCooldown /= 2;
-		}
-
-		if (ui.unit && ui.unit->isVisible() && !ui.unit->isFlying()) {
-			elevation = BWAPI::Broodwar->getGroundHeight(ui.unit->getTilePosition());
+		else if (type == BWAPI::UnitTypes::Protoss_Reaver) {
+			groundDamage = player->damage(BWAPI::WeaponTypes::Scarab);
 		}
 
 		groundMaxRange *= groundMaxRange;
@@ -436,31 +976,47 @@ namespace UAlbertaBot {
 		shieldArmor *= 2;
 		armor *= 2;
 
-		health *= 2;
 		maxHealth *= 2;
-		shields *= 2;
 		maxShields *= 2;
 	}
 
-	const FastAPproximation::FAPUnit &FastAPproximation::FAPUnit::operator=(const FAPUnit & other) const {
-		x = other.x, y = other.y;
-		health = other.health, maxHealth = other.maxHealth;
-		shields = other.shields, maxShields = other.maxShields;
-		speed = other.speed, armor = other.armor, flying = other.flying, unitSize = other.unitSize;
-		groundDamage = other.groundDamage, groundCooldown = other.groundCooldown, groundMaxRange = other.groundMaxRange, groundMinRange = other.groundMinRange, groundDamageType = other.groundDamageType;
-		airDamage = other.airDamage, airCooldown = other.airCooldown, airMaxRange = other.airMaxRange, airMinRange = other.airMinRange, airDamageType = other.airDamageType;
-		score = other.score;
-		attackCooldownRemaining = other.attackCooldownRemaining;
-		unitType = other.unitType; isOrganic = other.isOrganic;
-		healTimer = other.healTimer; didHealThisFrame = other.didHealThisFrame;
-		elevation = other.elevation;
-		player = other.player;
-
-		return *this;
+	FastAPproximation::UnitTypeTable & FastAPproximation::UnitTypeTable::Instance() {
+		static UnitTypeTable instance;
+		return instance;
 	}
 
-	bool FastAPproximation::FAPUnit::operator<(const FAPUnit & other) const {
-		return id < other.id;
+	const FastAPproximation::FAPUnit & FastAPproximation::UnitTypeTable::get(BWAPI::Player player, BWAPI::UnitType type) {
+		const int now = BWAPI::Broodwar->getFrameCount();
+		if (now < lastFrame)
+			players.clear();		// a new game
+		lastFrame = now;
+
+		PlayerTable & table = players[player];
+
+		// Check the upgrades once per frame.
+		if (table.checkedFrame != now) {
+			table.checkedFrame = now;
+
+			std::vector<int> levels;
+			for (const BWAPI::UpgradeType upgrade : BWAPI::UpgradeTypes::allUpgradeTypes())
+				levels.push_back(player->getUpgradeLevel(upgrade));
+
+			if (levels != table.upgradeLevels) {
+				table.upgradeLevels.swap(levels);
+				table.filled.assign(table.filled.size(), false);
+			}
+		}
+
+		const size_t id = size_t(type.getID());
+		if (id >= table.units.size()) {
+			table.units.resize(id + 1);
+			table.filled.resize(id + 1, false);
+		}
+		if (!table.filled[id]) {
+			table.units[id] = FAPUnit(player, type);
+			table.filled[id] = true;
+		}
+		return table.units[id];
 	}
 
 }
@@ -1,61 +1,165 @@
 #pragma once
 
 #include "UnitData.h"
+#include <iostream>
 
 namespace UAlbertaBot {
 
+	// Simulation instances are independent, so different threads can run different simulations.
 	class FastAPproximation {
+		// A unit as it enters the simulation.
+		// Inside the simulation the same data is kept in a Side.
+		// Constructing one reads the game, so do it on the main thread.
 		struct FAPUnit {
+			FAPUnit() {}
 			FAPUnit(BWAPI::Unit u);
 			FAPUnit(UnitInfo ui);
-			const FAPUnit &operator= (const FAPUnit &other) const;
+			FAPUnit(BWAPI::Player player, BWAPI::UnitType type);		// the parts that UnitTypeTable keeps
 
-			int id = 0;
+			int x = 0, y = 0;
 
-			mutable int x = 0, y = 0;
+			int health = 0;
+			int maxHealth = 0;
+			int armor = 0;
 
-			mutable int health = 0;
-			mutable int maxHealth = 0;
-			mutable int armor = 0;
+			int shields = 0;
+			int shieldArmor = 0;
+			int maxShields = 0;
 
-			mutable int shields = 0;
-			mutable int shieldArmor = 0;
-			mutable int maxShields = 0;
+			double speed = 0;
+			bool flying = 0;
+			int elevation = -1;
 
-			mutable double speed = 0;
-			mutable bool flying = 0;
-			mutable int elevation = -1;
+			BWAPI::UnitSizeType unitSize;
 
-			mutable BWAPI::UnitSizeType unitSize;
+			int groundDamage = 0;
+			int groundCooldown = 0;
+			int groundMaxRange = 0;
+			int groundMinRange = 0;
+			BWAPI::DamageType groundDamageType;
 
-			mutable int groundDamage = 0;
-			mutable int groundCooldown = 0;
-			mutable int groundMaxRange = 0;
-			mutable int groundMinRange = 0;
-			mutable BWAPI::DamageType groundDamageType;
+			int airDamage = 0;
+			int airCooldown = 0;
+			int airMaxRange = 0;
+			int airMinRange = 0;
+			BWAPI::DamageType airDamageType;
 
-			mutable int airDamage = 0;
-			mutable int airCooldown = 0;
-			mutable int airMaxRange = 0;
-			mutable int airMinRange = 0;
-			mutable BWAPI::DamageType airDamageType;
+			BWAPI::UnitType unitType;
+			BWAPI::Player player = nullptr;
+			bool isOrganic = false;
+			int score = 0;
 
-			mutable BWAPI::UnitType unitType;
-			mutable BWAPI::Player player = nullptr;
-			mutable int healTimer = 0;
-			mutable bool isOrganic = false;
-			mutable bool didHealThisFrame = false;
-			mutable int score = 0;
+			int attackCooldownRemaining = 0;
+		};
 
-			mutable int attackCooldownRemaining = 0;
+		// For each player and unit type, the parts of a FAPUnit that depend on nothing else,
+		// which is most of it. Reading them from BWAPI used to cost as much as a small simulation.
+		// A player's table is refilled, lazily, when the player's upgrades change.
+		// Main thread only, like making FAPUnits.
+		class UnitTypeTable {
+			struct PlayerTable {
+				int checkedFrame = -1;
+				std::vector<int> upgradeLevels;
+				std::vector<FAPUnit> units;		// by unit type ID
+				std::vector<char> filled;
+			};
+
+			std::map<BWAPI::Player, PlayerTable> players;
+			int lastFrame = -1;
 
-#ifdef _DEBUG
+		public:
+			static UnitTypeTable & Instance();
+			const FAPUnit & get(BWAPI::Player player, BWAPI::UnitType type);
+		};
 
-			mutable int damageTaken = 0;
+		// The parts of a unit that the simulation only reads.
+		struct UnitStats {
+			UnitStats() {}
+			explicit UnitStats(const FAPUnit & fu);
+
+			int maxHealth;
+			int armor;
+			int shieldArmor;
+			int maxShields;
+			double speed;
+			int speedFP;				// speed in 1/256 pixels per frame, for fixed point
+			int elevation;
+			int unitSize;				// UnitSizeType ID
+
+			int groundDamage;
+			int groundCooldown;
+			int groundMaxRange;			// ranges are squared
+			int groundMinRange;
+			int groundDamageType;		// DamageType ID
+
+			int airDamage;
+			int airCooldown;
+			int airMaxRange;
+			int airMinRange;
+			int airDamageType;
+
+			BWAPI::UnitType unitType;
+			BWAPI::Player player;		// not saved in traces
+			bool isOrganic;
+			int score;
+
+			void write(std::ostream & out) const;
+			bool read(std::istream & in);
+		};
 
-#endif
+		// The units of one side, stored as parallel arrays: Unit i is element i of each array.
+		// The fields that the target search scans and the fields that change every frame
+		// get their own arrays; the rest is in stats.
+		// A unit killed in combat is swap-removed. A suicide unit that hits is only flagged,
+		// and the flagged units are compacted out after their side's turn, so that the
+		// units of the side are visited in the same order as when they were erased one by one.
+		// All units of a side belong to one player.
+		struct Side {
+			std::vector<int> x, y;
+			std::vector<char> flying;
+			std::vector<int> health;
+			std::vector<int> shields;
+			std::vector<int> attackCooldownRemaining;
+			std::vector<int> healTimer;
+			std::vector<char> didHealThisFrame;
+			std::vector<char> suicided;
+			std::vector<UnitStats> stats;
+			int nSuicided = 0;
+
+			// What a dead bunker leaves behind, made when the first bunker is added
+			// so that the simulation never has to read the game.
+			UnitStats bunkerMarine;
+			bool hasBunkerMarine = false;
+
+			size_t size() const { return x.size(); }
+			void push(const FAPUnit & fu);
+			void push(const UnitStats & s, int ux, int uy, bool isFlying, int hp, int sh, int cooldown);
+			void append(const Side & other);
+			void swapRemove(size_t i);
+			void removeSuicided();
+			void clear();
+
+			// Write or read the units and bunker marine, for traces. Not the suicide flags.
+			void write(std::ostream & out) const;
+			bool read(std::istream & in);
+		};
 
-			bool operator< (const FAPUnit &other) const;
+		// The enemy units sorted along the long axis of the battle, so that in a big fight the
+		// nearest target search can sweep outward from the attacker and stop as soon as the
+		// units left are farther along the axis than the closest target found.
+		// It is built at the start of each side's turn, while the enemies stand still,
+		// and kept up to date as they die (and bunkers leave marines behind).
+		struct TargetIndex {
+			bool alongX = true;				// sorted by x, else by y
+			std::vector<int> along;			// the sort key
+			std::vector<int> across;		// the other coordinate
+			std::vector<char> flying;
+			std::vector<int> unit;			// index in the side
+			std::vector<int> order;			// scratch for sorting
+
+			void build(const Side & side, bool byX);
+			void insert(int u, int x, int y, bool isFlying);
+			void remove(int u, int last);
 		};
 
 		public:
@@ -67,30 +171,69 @@ namespace UAlbertaBot {
 			void addUnitPlayer2(FAPUnit fu);
 			void addIfCombatUnitPlayer2(FAPUnit fu);
 
-			void simulate(int nFrames = 96); // = 24*4, 4 seconds on fastest
+			// Return the number of frames simulated, fewer if the fight ended early.
+			int simulate(int nFrames = 96); // = 24*4, 4 seconds on fastest
+
+			// Simulate about nFrames, but stop as soon as one side has lost decisivePercent of its
+			// score and is behind, and go on up to maxFrames while neither side has lost much yet,
+			// as when the armies are still closing in on each other. Return the frames simulated.
+			int simulateAdaptive(int nFrames, int maxFrames, int decisivePercent);
 
 			std::pair <int, int> playerScores() const;
 			std::pair <int, int> playerScoresUnits() const;
 			std::pair <int, int> playerScoresBuildings() const;
-			std::pair <std::vector <FAPUnit> *, std::vector <FAPUnit> *> getState();
 			void clearState();
 
+			// A copy of the simulator is an independent branch of the fight; copying is cheap
+			// next to building the units from the game. These change a branch.
+			void addUnitsPlayer1(const FastAPproximation & from);	// all of from's player 1 units
+
+			// Use the target index against this many enemies or more.
+			void setIndexMinUnits(int n) { indexMinUnits = n; }
+
+			// Move in fixed point, so that a simulation comes out the same with any compiler
+			// and floating point settings. Off by default, because it rounds a little differently.
+			void setFixedPoint(bool on) { fixedPoint = on; }
+			bool isFixedPoint() const { return fixedPoint; }
+
+			// Traces of live simulations, to replay offline (see Tools/FAPReplay).
+			// A trace file is a header and then records. A record is the frame, the starting state
+			// of the simulation, the number of frames simulated, and the scores it came to.
+			// The state is written before simulating and the rest after. All numbers are little-endian.
+			static void writeTraceHeader(std::ostream & out);
+			static bool readTraceHeader(std::istream & in);
+			void writeTraceStart(std::ostream & out, int frame) const;
+			static void writeTraceEnd(std::ostream & out, int nFrames, std::pair<int, int> scores);
+			bool readTraceRecord(std::istream & in, int & frame, int & nFrames, std::pair<int, int> & scores);
+
+			// Time the target search with and without the index over a range of fight sizes.
+			// Returns the size from which the index is faster.
+			static int benchmarkTargetSearch(BWAPI::Player p1, BWAPI::Player p2, std::ostream & out);
+
 		private:
-			std::vector <FAPUnit> player1, player2;
+			Side player1, player2;
+
+			TargetIndex targets;
+			const Side * indexedSide;		// the side in the target index, or null if none
+			int indexMinUnits;
+
+			bool fixedPoint;
 
 			bool didSomething;
-			void dealDamage(const FastAPproximation::FAPUnit & fu, int damage, BWAPI::DamageType damageType) const;
-			int distButNotReally(const FastAPproximation::FAPUnit & u1, const FastAPproximation::FAPUnit & u2) const;
+			void dealDamage(Side & side, size_t i, int damage, int damageType) const;
+			int nearestTarget(const Side & us, size_t i, const Side & enemies, int & closestDist) const;
+			int indexedNearestTarget(int ux, int uy, int groundMin, int airMin, int & closestDist) const;
+			void startTurn(const Side & us, const Side & enemies);
 			bool isSuicideUnit(BWAPI::UnitType ut);
-			void unitsim(const FAPUnit & fu, std::vector <FAPUnit> &enemyUnits);
-			void medicsim(const FAPUnit & fu, std::vector <FAPUnit> &friendlyUnits);
-			bool suicideSim(const FAPUnit & fu, std::vector <FAPUnit> &enemyUnits);
+			bool withinStep(const UnitStats & s, int distSq) const;
+			void stepToward(Side & us, size_t i, int tx, int ty, int distSq) const;
+			void unitsim(Side & us, size_t i, Side & enemies);
+			void medicsim(Side & us, size_t i);
+			bool suicideSim(Side & us, size_t i, Side & enemies);
+			void killUnit(Side & side, size_t i);
 			void isimulate();
-			void unitDeath(const FAPUnit & fu, std::vector <FAPUnit> &itsFriendlies);
-			void convertToUnitType(const FAPUnit &fu, BWAPI::UnitType ut);
+			static std::pair <int, int> scores(const Side & side1, const Side & side2, bool units, bool buildings);
 
 	};
 
 }
-
-extern UAlbertaBot::FastAPproximation fap;
@@ -1,5 +1,6 @@
 #include "Common.h"
 #include "GameCommander.h"
+#include "LayoutPlanner.h"
 #include "OpponentModel.h"
 #include "UnitUtil.h"
 
@@ -42,6 +43,7 @@ void GameCommander::update()
 
 	_timerManager.startTimer(TimerManager::MapGrid);
 	MapGrid::Instance().update();
+	ThreatGrid::Instance().update();
 	_timerManager.stopTimer(TimerManager::MapGrid);
 
 	_timerManager.startTimer(TimerManager::Search);
@@ -88,6 +90,8 @@ void GameCommander::drawDebugInterface()
 	BOSSManager::Instance().drawSearchInformation(490, 100);
     BOSSManager::Instance().drawStateInformation(250, 0);
 	MapTools::Instance().drawHomeDistanceMap();
+	MapAnalysis::Instance().drawMapAnalysis();
+	LayoutPlanner::Instance().drawLayout();
     
 	_combatCommander.drawSquadInformation(200, 30);
     _timerManager.displayTimers(490, 225);
@@ -266,16 +270,23 @@ void GameCommander::onUnitHide(BWAPI::Unit unit)
 void GameCommander::onUnitCreate(BWAPI::Unit unit)		
 { 
 	InformationManager::Instance().onUnitCreate(unit); 
+	BuildingPlacer::Instance().onUnitCreate(unit);
+	BuildingManager::Instance().onUnitCreate(unit);
+	BOSSManager::Instance().onUnitCreate(unit);
 }
 
 void GameCommander::onUnitComplete(BWAPI::Unit unit)
 {
 	InformationManager::Instance().onUnitComplete(unit);
+	BuildingManager::Instance().onUnitComplete(unit);
+	BOSSManager::Instance().onUnitComplete(unit);
 }
 
 void GameCommander::onUnitRenegade(BWAPI::Unit unit)		
 { 
 	InformationManager::Instance().onUnitRenegade(unit); 
+	BuildingPlacer::Instance().onUnitRenegade(unit);
+	BOSSManager::Instance().onUnitRenegade(unit);
 }
 
 void GameCommander::onUnitDestroy(BWAPI::Unit unit)		
@@ -283,12 +294,19 @@ void GameCommander::onUnitDestroy(BWAPI::Unit unit)
 	ProductionManager::Instance().onUnitDestroy(unit);
 	WorkerManager::Instance().onUnitDestroy(unit);
 	InformationManager::Instance().onUnitDestroy(unit); 
+	BuildingPlacer::Instance().onUnitDestroy(unit);
+	LayoutPlanner::Instance().onUnitDestroy(unit);
+	BuildingManager::Instance().onUnitDestroy(unit);
+	BOSSManager::Instance().onUnitDestroy(unit);
 }
 
 void GameCommander::onUnitMorph(BWAPI::Unit unit)		
 { 
 	InformationManager::Instance().onUnitMorph(unit);
 	WorkerManager::Instance().onUnitMorph(unit);
+	BuildingPlacer::Instance().onUnitMorph(unit);
+	BuildingManager::Instance().onUnitMorph(unit);
+	BOSSManager::Instance().onUnitChange(unit);
 }
 
 // Used only to choose a worker to scout.
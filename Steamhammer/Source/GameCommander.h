@@ -3,7 +3,9 @@
 #include "Common.h"
 #include "CombatCommander.h"
 #include "InformationManager.h"
+#include "MapAnalysis.h"
 #include "MapGrid.h"
+#include "ThreatGrid.h"
 #include "WorkerManager.h"
 #include "ProductionManager.h"
 #include "BuildingManager.h"
@@ -929,10 +929,20 @@ void InformationManager::onUnitDestroy(BWAPI::Unit unit)
 // Only returns units believed to be completed.
 void InformationManager::getNearbyForce(std::vector<UnitInfo> & unitInfo, BWAPI::Position p, BWAPI::Player player, int radius) 
 {
-	// for each unit we know about for that player
-	for (const auto & kv : getUnitData(player).getUnits())
+	// The farthest any unit can reach and still be included: Longest ground range plus fudge factor,
+	// or the detector radius, whichever is greater.
+	static const int maxReach = std::max(250, BWAPI::UnitTypes::Terran_Siege_Tank_Siege_Mode.groundWeapon().maxRange() + 40);
+
+	// Candidates come from the spatial index, then get the exact check.
+	std::vector<const UnitInfo *> candidates;
+	getUnitData(player).getUnitsNear(candidates, p, radius + maxReach);
+
+	for (const UnitInfo * uiPtr : candidates)
 	{
-		const UnitInfo & ui(kv.second);
+		const UnitInfo & ui(*uiPtr);
+		const int dx = ui.lastPosition.x - p.x;
+		const int dy = ui.lastPosition.y - p.y;
+		const int distSq = dx * dx + dy * dy;
 
 		// if it's a combat unit we care about
 		// and it's finished! 
@@ -949,13 +959,13 @@ void InformationManager::getNearbyForce(std::vector<UnitInfo> & unitInfo, BWAPI:
 			// included (except turrets and spores, because they are also detectors).
 
 			// if it can attack into the radius we care about
-			if (ui.lastPosition.getDistance(p) <= (radius + range))
+			if (distSq <= (radius + range) * (radius + range))
 			{
 				// add it to the vector
 				unitInfo.push_back(ui);
 			}
 		}
-		else if (ui.type.isDetector() && ui.lastPosition.getDistance(p) <= (radius + 250))
+		else if (ui.type.isDetector() && distSq <= (radius + 250) * (radius + 250))
         {
 			unitInfo.push_back(ui);
         }
@@ -0,0 +1,470 @@
+#include <fstream>
+#include <climits>
+
+#include "LayoutPlanner.h"
+
+#include "BuildingManager.h"
+#include "BuildingPlacer.h"
+#include "MapAnalysis.h"
+
+using namespace UAlbertaBot;
+
+const int FileVersion = 1;
+
+const int MaxSlots = 24;				// per base and shape
+const int BaseSnap = 10;				// tiles; a desired position this close to a depot belongs to its base
+const int ResourceRadius = 12;			// tiles; resources this close to a depot are its mineral line
+const int PathWidth = 1;				// tiles kept clear on each side of a path to a choke
+
+LayoutPlanner & LayoutPlanner::Instance()
+{
+	static LayoutPlanner instance;
+	return instance;
+}
+
+bool LayoutPlanner::Shape::operator<(const Shape & rhs) const
+{
+	return
+		std::tie(left, top, right, bottom, width, height) <
+		std::tie(rhs.left, rhs.top, rhs.right, rhs.bottom, rhs.width, rhs.height);
+}
+
+LayoutPlanner::LayoutPlanner()
+	: _readFromFile(false)
+{
+	const int cols = BWAPI::Broodwar->mapWidth();
+	const int rows = BWAPI::Broodwar->mapHeight();
+
+	_buildable.init(cols, rows);
+	for (int x = 0; x < cols; ++x)
+	{
+		for (int y = 0; y < rows; ++y)
+		{
+			_buildable.set(x, y, BWAPI::Broodwar->isBuildable(x, y));
+		}
+	}
+	_buildable.updateSums(0, 0);
+
+	// Read the plan for every base, or make it.
+	_plans.resize(MapAnalysis::Instance().getBases().size());
+	if (read())
+	{
+		_readFromFile = true;
+	}
+	else
+	{
+		std::vector<Shape> shapes;
+		getStartShapes(shapes);
+		for (size_t i = 0; i < _plans.size(); ++i)
+		{
+			planBase(i, shapes);
+		}
+		write();
+	}
+}
+
+std::string LayoutPlanner::getFilename() const
+{
+	return "layout_" + BWAPI::Broodwar->mapHash() + "_" + BWAPI::Broodwar->self()->getRace().getName() + ".txt";
+}
+
+LayoutPlanner::Shape LayoutPlanner::getShape(const Building & b, int buildDist, bool horizontalOnly)
+{
+	Shape shape;
+	BuildingPlacer::getSpaceRectangle(b, buildDist, horizontalOnly, shape.left, shape.top, shape.right, shape.bottom);
+
+	shape.width = b.type.tileWidth();
+	shape.height = b.type.tileHeight();
+	if (b.type == BWAPI::UnitTypes::Terran_Command_Center ||
+		b.type == BWAPI::UnitTypes::Terran_Factory ||
+		b.type == BWAPI::UnitTypes::Terran_Starport ||
+		b.type == BWAPI::UnitTypes::Terran_Science_Facility)
+	{
+		shape.width += 2;
+	}
+
+	return shape;
+}
+
+// The shapes of the buildings our workers make, with the spacing that BuildingManager asks for.
+// Depots go to base locations, except that zerg makes macro hatcheries.
+void LayoutPlanner::getStartShapes(std::vector<Shape> & shapes) const
+{
+	const BWAPI::Race race = BWAPI::Broodwar->self()->getRace();
+
+	std::set<Shape> unique;
+	for (const BWAPI::UnitType type : BWAPI::UnitTypes::allUnitTypes())
+	{
+		if (type.getRace() != race ||
+			!type.isBuilding() ||
+			!type.whatBuilds().first.isWorker() ||
+			type.isRefinery() ||
+			(type.isResourceDepot() && race != BWAPI::Races::Zerg))
+		{
+			continue;
+		}
+
+		// Pylon spacing depends on how many pylons there are.
+		for (int numPylons = 0; numPylons <= 3; numPylons += 3)
+		{
+			int distance;
+			bool noVerticalSpacing;
+			BuildingManager::getBuildingSpacing(type, numPylons, distance, noVerticalSpacing);
+			if (distance > 0)
+			{
+				Building b;
+				b.type = type;
+				unique.insert(getShape(b, distance, noVerticalSpacing));
+			}
+		}
+	}
+
+	shapes.assign(unique.begin(), unique.end());
+}
+
+// -1 if the tile is not near any base.
+int LayoutPlanner::getBaseIndex(BWAPI::TilePosition tile) const
+{
+	const std::vector<MapAnalysis::Base> & bases = MapAnalysis::Instance().getBases();
+
+	int best = -1;
+	int bestDist = BaseSnap + 1;
+	for (size_t i = 0; i < bases.size(); ++i)
+	{
+		const int dist = std::max(std::abs(bases[i].depot.x - tile.x), std::abs(bases[i].depot.y - tile.y));
+		if (dist < bestDist)
+		{
+			best = i;
+			bestDist = dist;
+		}
+	}
+	return best;
+}
+
+// Plan slots for each of the shapes at one base.
+void LayoutPlanner::planBase(int baseIndex, const std::vector<Shape> & shapes)
+{
+	const MapAnalysis & map = MapAnalysis::Instance();
+	const MapAnalysis::Base & base = map.getBases()[baseIndex];
+	const int cols = BWAPI::Broodwar->mapWidth();
+	const int rows = BWAPI::Broodwar->mapHeight();
+	const BWAPI::UnitType depotType = BWAPI::UnitTypes::Terran_Command_Center;
+
+	if (base.region < 0 || base.region >= int(map.getRegions().size()))
+	{
+		return;
+	}
+
+	// Breadth-first search over the base's region from the depot. The visiting order is the
+	// order of preference for slots, and the parents give the paths to the chokes.
+	const BWAPI::TilePosition start = base.depot + BWAPI::TilePosition(2, 1);
+	std::vector<int> order;
+	std::vector<int> parent(rows * cols, -1);
+	if (map.getRegionID(start) == base.region)
+	{
+		order.push_back(start.y * cols + start.x);
+		parent[order[0]] = order[0];
+	}
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const int x = order[i] % cols;
+		const int y = order[i] / cols;
+		const int dx[4] = { 1, -1, 0, 0 };
+		const int dy[4] = { 0, 0, 1, -1 };
+		for (int d = 0; d < 4; ++d)
+		{
+			const BWAPI::TilePosition next(x + dx[d], y + dy[d]);
+			if (map.getRegionID(next) == base.region && parent[next.y * cols + next.x] < 0)
+			{
+				parent[next.y * cols + next.x] = order[i];
+				order.push_back(next.y * cols + next.x);
+			}
+		}
+	}
+
+	// Footprints must stay off the depot, the mineral line, and the paths to the chokes.
+	// Space rectangles must stay off the depot and the mineral line.
+	TileLayer mineralLine;
+	TileLayer paths;
+	mineralLine.init(cols, rows);
+	paths.init(cols, rows);
+
+	int left = base.depot.x;
+	int top = base.depot.y;
+	int right = base.depot.x + depotType.tileWidth();
+	int bottom = base.depot.y + depotType.tileHeight();
+	BWAPI::Unitset resources = BWAPI::Broodwar->getStaticMinerals();
+	const BWAPI::Unitset geysers = BWAPI::Broodwar->getStaticGeysers();
+	resources.insert(geysers.begin(), geysers.end());
+	for (const auto resource : resources)
+	{
+		const BWAPI::TilePosition tile = resource->getInitialTilePosition();
+		if (std::abs(tile.x - base.depot.x) <= ResourceRadius && std::abs(tile.y - base.depot.y) <= ResourceRadius)
+		{
+			left = std::min(left, tile.x);
+			top = std::min(top, tile.y);
+			right = std::max(right, tile.x + resource->getInitialType().tileWidth());
+			bottom = std::max(bottom, tile.y + resource->getInitialType().tileHeight());
+		}
+	}
+	mineralLine.setRectangle(left, top, right - left, bottom - top, true);
+
+	for (const int c : map.getRegions()[base.region].chokes)
+	{
+		// Walk back from the reached tile nearest the choke.
+		const BWAPI::TilePosition choke = map.getChokes()[c].center;
+		int end = -1;
+		int endDist = INT_MAX;
+		for (const int index : order)
+		{
+			const int dist = std::max(std::abs(index % cols - choke.x), std::abs(index / cols - choke.y));
+			if (dist < endDist)
+			{
+				end = index;
+				endDist = dist;
+			}
+		}
+		for (int index = end; index >= 0; index = parent[index] == index ? -1 : parent[index])
+		{
+			for (int dy = -PathWidth; dy <= PathWidth; ++dy)
+			{
+				for (int dx = -PathWidth; dx <= PathWidth; ++dx)
+				{
+					paths.set(index % cols + dx, index / cols + dy, true);
+				}
+			}
+		}
+	}
+	paths.updateSums(0, 0);
+
+	for (const Shape & shape : shapes)
+	{
+		Plan & plan = _plans[baseIndex][shape];
+		plan.slots.clear();
+		plan.next = 0;
+
+		const int spaceWidth = shape.right - shape.left;
+		const int spaceHeight = shape.bottom - shape.top;
+
+		for (const int index : order)
+		{
+			const BWAPI::TilePosition tile(index % cols, index / cols);
+			const BWAPI::TilePosition space(tile.x + shape.left, tile.y + shape.top);
+
+			if (space.x < 0 || space.y < 0 || space.x + spaceWidth > cols || space.y + spaceHeight > rows ||
+				tile.x + shape.width > cols || tile.y + shape.height > rows ||
+				_buildable.count(space.x, space.y, spaceWidth, spaceHeight) < spaceWidth * spaceHeight ||
+				mineralLine.count(space.x, space.y, spaceWidth, spaceHeight) > 0 ||
+				paths.count(tile.x, tile.y, shape.width, shape.height) > 0 ||
+				map.getRegionID(tile) != base.region ||
+				map.getRegionID(tile + BWAPI::TilePosition(shape.width - 1, shape.height - 1)) != base.region)
+			{
+				continue;
+			}
+
+			// The footprint must not be in the space of an earlier slot, nor the reverse.
+			bool crowded = false;
+			for (const BWAPI::TilePosition & other : plan.slots)
+			{
+				const BWAPI::TilePosition otherSpace(other.x + shape.left, other.y + shape.top);
+				if ((tile.x < otherSpace.x + spaceWidth && otherSpace.x < tile.x + shape.width &&
+					 tile.y < otherSpace.y + spaceHeight && otherSpace.y < tile.y + shape.height) ||
+					(other.x < space.x + spaceWidth && space.x < other.x + shape.width &&
+					 other.y < space.y + spaceHeight && space.y < other.y + shape.height))
+				{
+					crowded = true;
+					break;
+				}
+			}
+			if (crowded)
+			{
+				continue;
+			}
+
+			plan.slots.push_back(tile);
+			if (int(plan.slots.size()) >= MaxSlots)
+			{
+				break;
+			}
+		}
+	}
+}
+
+// The first slot for the building that can be built on now, or None if there is none.
+// Slots covered by our buildings are used up and are not looked at again.
+BWAPI::TilePosition LayoutPlanner::getSlot(const Building & b, int buildDist, bool horizontalOnly)
+{
+	if (b.type.isAddon() || b.type.isRefinery())
+	{
+		return BWAPI::TilePositions::None;
+	}
+
+	const int baseIndex = getBaseIndex(b.desiredPosition);
+	if (baseIndex < 0)
+	{
+		return BWAPI::TilePositions::None;
+	}
+
+	const Shape shape = getShape(b, buildDist, horizontalOnly);
+	auto it = _plans[baseIndex].find(shape);
+	if (it == _plans[baseIndex].end())
+	{
+		planBase(baseIndex, std::vector<Shape>(1, shape));
+		it = _plans[baseIndex].find(shape);
+	}
+	Plan & plan = it->second;
+
+	for (size_t i = plan.next; i < plan.slots.size(); ++i)
+	{
+		const BWAPI::TilePosition & slot = plan.slots[i];
+		if (BuildingPlacer::Instance().isBlocked(slot, shape.width, shape.height))
+		{
+			if (i == plan.next)
+			{
+				++plan.next;
+			}
+			continue;
+		}
+		if (BuildingPlacer::Instance().canBuildHereWithSpace(slot, b, buildDist, horizontalOnly))
+		{
+			return slot;
+		}
+	}
+
+	return BWAPI::TilePositions::None;
+}
+
+// A slot may have opened up again.
+void LayoutPlanner::onUnitDestroy(BWAPI::Unit unit)
+{
+	if (unit->getPlayer() != BWAPI::Broodwar->self() || !unit->getType().isBuilding())
+	{
+		return;
+	}
+
+	for (auto & plans : _plans)
+	{
+		for (auto & kv : plans)
+		{
+			kv.second.next = 0;
+		}
+	}
+}
+
+// Read the layout file, if there is one. Return false if it's missing or doesn't fit the map.
+// The file is read into temporaries, and the plans are changed only if all of it is good.
+bool LayoutPlanner::read()
+{
+	std::ifstream inFile(Config::IO::ReadDir + getFilename());
+	if (!inFile.good())
+	{
+		return false;
+	}
+
+	size_t nBases, nPlans;
+	int version;
+	if (!(inFile >> version >> nBases >> nPlans) || version != FileVersion || nBases != _plans.size())
+	{
+		return false;
+	}
+
+	const int cols = BWAPI::Broodwar->mapWidth();
+	const int rows = BWAPI::Broodwar->mapHeight();
+
+	std::vector< std::map<Shape, Plan> > plans(_plans.size());
+	for (size_t p = 0; p < nPlans; ++p)
+	{
+		size_t baseIndex, nSlots;
+		Shape shape;
+		if (!(inFile >> baseIndex >> shape.left >> shape.top >> shape.right >> shape.bottom >> shape.width >> shape.height >> nSlots) ||
+			baseIndex >= plans.size() ||
+			shape.width <= 0 || shape.height <= 0 ||
+			nSlots > size_t(MaxSlots))
+		{
+			return false;
+		}
+
+		Plan & plan = plans[baseIndex][shape];
+		plan.next = 0;
+		plan.slots.resize(nSlots);
+		for (BWAPI::TilePosition & slot : plan.slots)
+		{
+			if (!(inFile >> slot.x >> slot.y) ||
+				slot.x < 0 || slot.y < 0 || slot.x + shape.width > cols || slot.y + shape.height > rows)
+			{
+				return false;
+			}
+		}
+	}
+
+	_plans.swap(plans);
+	return true;
+}
+
+void LayoutPlanner::write() const
+{
+	std::ofstream outFile(Config::IO::WriteDir + getFilename());
+
+	// If it fails, we'll plan again next time.
+	if (!outFile.good())
+	{
+		return;
+	}
+
+	size_t nPlans = 0;
+	for (const auto & plans : _plans)
+	{
+		nPlans += plans.size();
+	}
+
+	outFile << FileVersion << ' ' << _plans.size() << ' ' << nPlans << '\n';
+
+	for (size_t i = 0; i < _plans.size(); ++i)
+	{
+		for (const auto & kv : _plans[i])
+		{
+			const Shape & shape = kv.first;
+			outFile << i << ' ' << shape.left << ' ' << shape.top << ' ' << shape.right << ' ' << shape.bottom << ' '
+				<< shape.width << ' ' << shape.height << ' ' << kv.second.slots.size();
+			for (const BWAPI::TilePosition & slot : kv.second.slots)
+			{
+				outFile << ' ' << slot.x << ' ' << slot.y;
+			}
+			outFile << '\n';
+		}
+	}
+}
+
+// Outline the footprints of the unused slots, one color per shape.
+void LayoutPlanner::drawLayout() const
+{
+	if (!Config::Debug::DrawBaseLayout)
+	{
+		return;
+	}
+
+	const BWAPI::Color colors[] = { BWAPI::Colors::Cyan, BWAPI::Colors::Yellow, BWAPI::Colors::Purple, BWAPI::Colors::Orange, BWAPI::Colors::Green };
+	const int nColors = sizeof(colors) / sizeof(colors[0]);
+
+	size_t nSlots = 0;
+	for (const auto & plans : _plans)
+	{
+		int shapeIndex = 0;
+		for (const auto & kv : plans)
+		{
+			const Shape & shape = kv.first;
+			for (size_t i = kv.second.next; i < kv.second.slots.size(); ++i)
+			{
+				const BWAPI::Position topLeft(kv.second.slots[i]);
+				BWAPI::Broodwar->drawBoxMap(topLeft + BWAPI::Position(2 * shapeIndex, 2 * shapeIndex),
+					topLeft + BWAPI::Position(32 * shape.width - 2 * shapeIndex, 32 * shape.height - 2 * shapeIndex),
+					colors[shapeIndex % nColors]);
+			}
+			nSlots += kv.second.slots.size();
+			++shapeIndex;
+		}
+	}
+
+	BWAPI::Broodwar->drawTextScreen(10, 20, "%cbase layout %s: %d slots",
+		white, _readFromFile ? "read" : "planned", int(nSlots));
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Common.h"
+#include "BuildingData.h"
+#include "TileLayer.h"
+
+namespace UAlbertaBot
+{
+
+// Building slots for every base, planned once at the start of the game (in onStart).
+// For each base and each shape of building (its space rectangle and footprint), the planner
+// keeps a list of slots in the base's region, nearest the depot first. Slots of one shape do
+// not crowd each other, and none are on the mineral line or on the paths from the depot to
+// the region's chokes, so that the base cannot wall itself in.
+// Whether a slot can be built on right now (creep, power, units in the way) is checked when
+// it is handed out. Slots covered by our buildings are skipped for good, until one is destroyed.
+// The plan is saved to a file named for the map hash and our race, like MapAnalysis.
+// Shapes that were not planned at the start are planned when first asked for.
+class LayoutPlanner
+{
+	struct Shape
+	{
+		int		left;			// space rectangle relative to the building's tile, right and bottom exclusive
+		int		top;
+		int		right;
+		int		bottom;
+		int		width;			// footprint, with room for an addon
+		int		height;
+
+		bool operator<(const Shape & rhs) const;
+	};
+
+	struct Plan
+	{
+		std::vector<BWAPI::TilePosition>	slots;		// best first
+		size_t								next;		// the slots before this are used up
+	};
+
+	std::vector< std::map<Shape, Plan> >	_plans;		// indexed like MapAnalysis::getBases()
+	TileLayer								_buildable;	// the map's buildable tiles, shared by all plans
+	bool									_readFromFile;
+
+	LayoutPlanner();
+
+	std::string		getFilename() const;
+
+	static Shape	getShape(const Building & b, int buildDist, bool horizontalOnly);
+	void			getStartShapes(std::vector<Shape> & shapes) const;
+	int				getBaseIndex(BWAPI::TilePosition tile) const;
+	void			planBase(int baseIndex, const std::vector<Shape> & shapes);
+
+	bool			read();
+	void			write() const;
+
+public:
+
+	static LayoutPlanner &	Instance();
+
+	BWAPI::TilePosition		getSlot(const Building & b, int buildDist, bool horizontalOnly);
+
+	void					onUnitDestroy(BWAPI::Unit unit);
+
+	void					drawLayout() const;
+};
+
+}
@@ -0,0 +1,664 @@
+#include <fstream>
+#include <climits>
+
+#include "MapAnalysis.h"
+
+using namespace UAlbertaBot;
+
+const int FileVersion = 1;
+
+// Regions.
+const int MinRegionTiles = 64;			// smaller basins are merged into their neighbors
+const int MinRegionClearance = 3;		// so are basins that never get this open
+const int ChokeRatioPercent = 70;		// a meeting point narrower than this is a choke
+
+// Bases.
+const int ClusterDistance = 8 * 32;		// resources this close together belong to the same base
+const int MinClusterResources = 3;		// fewer is probably a mineral wall or a stray patch
+const int MinMineralAmount = 16;		// smaller mineral patches are there to block paths
+const int DepotSearchRadius = 12;		// tiles around the middle of the resources
+const int ResourceMargin = 3;			// tiles between a depot and any resource, by the game rules
+const int StartLocationSnap = 10;		// tiles; a base this close to a start location is the start location
+
+MapAnalysis & MapAnalysis::Instance()
+{
+	static MapAnalysis instance;
+	return instance;
+}
+
+MapAnalysis::MapAnalysis()
+	: _rows(BWAPI::Broodwar->mapHeight())
+	, _cols(BWAPI::Broodwar->mapWidth())
+	, _walkable(_rows * _cols, false)
+	, _clearance(_rows * _cols, 0)
+	, _regionIDs(_rows * _cols, -1)
+	, _readFromFile(false)
+{
+	computeWalkability();
+
+	if (read())
+	{
+		_readFromFile = true;
+	}
+	else
+	{
+		computeClearance();
+		computeRegions();
+		computeBases();
+		write();
+	}
+	linkChokes();
+}
+
+std::string MapAnalysis::getFilename() const
+{
+	return "map_" + BWAPI::Broodwar->mapHash() + ".txt";
+}
+
+// Which build tiles can big ground units walk on? Same rule as MapTools has always used:
+// All 16 walk tiles must be walkable, and no immobile neutral unit may be in the way.
+void MapAnalysis::computeWalkability()
+{
+	for (int r = 0; r < _rows; ++r)
+	{
+		for (int c = 0; c < _cols; ++c)
+		{
+			bool walkable = true;
+			for (int i = 0; i < 4 && walkable; ++i)
+			{
+				for (int j = 0; j < 4 && walkable; ++j)
+				{
+					walkable = BWAPI::Broodwar->isWalkable(c * 4 + i, r * 4 + j);
+				}
+			}
+			_walkable[getIndex(r, c)] = walkable;
+		}
+	}
+
+	for (const auto unit : BWAPI::Broodwar->getStaticNeutralUnits())
+	{
+		if (!unit->getType().canMove() && !unit->isFlying())
+		{
+			const BWAPI::TilePosition pos = unit->getTilePosition();
+			for (int r = std::max(0, pos.y); r < std::min(_rows, pos.y + unit->getType().tileHeight()); ++r)
+			{
+				for (int c = std::max(0, pos.x); c < std::min(_cols, pos.x + unit->getType().tileWidth()); ++c)
+				{
+					_walkable[getIndex(r, c)] = false;
+				}
+			}
+		}
+	}
+}
+
+// Breadth-first search outward from the unwalkable tiles and the map edge, 8-connected.
+void MapAnalysis::computeClearance()
+{
+	std::vector<int> fringe;
+	fringe.reserve(_rows * _cols);
+
+	for (int r = 0; r < _rows; ++r)
+	{
+		for (int c = 0; c < _cols; ++c)
+		{
+			const int index = getIndex(r, c);
+			if (!_walkable[index])
+			{
+				_clearance[index] = 0;
+				fringe.push_back(index);
+			}
+			else if (r == 0 || c == 0 || r == _rows - 1 || c == _cols - 1)
+			{
+				_clearance[index] = 1;
+				fringe.push_back(index);
+			}
+			else
+			{
+				_clearance[index] = -1;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < fringe.size(); ++i)
+	{
+		const int index = fringe[i];
+		const int r = index / _cols;
+		const int c = index % _cols;
+		for (int dr = -1; dr <= 1; ++dr)
+		{
+			for (int dc = -1; dc <= 1; ++dc)
+			{
+				const int nr = r + dr;
+				const int nc = c + dc;
+				if (nr >= 0 && nr < _rows && nc >= 0 && nc < _cols && _clearance[getIndex(nr, nc)] == -1)
+				{
+					_clearance[getIndex(nr, nc)] = _clearance[index] + 1;
+					fringe.push_back(getIndex(nr, nc));
+				}
+			}
+		}
+	}
+}
+
+// Watershed. Visit walkable tiles from most open to least open. A tile with no visited neighbor
+// starts a new basin. A tile that touches 2 basins either merges them, or, if both are big and
+// the tile is narrow compared to both, is recorded as a choke between them.
+void MapAnalysis::computeRegions()
+{
+	// Bucket the walkable tiles by clearance.
+	int maxClearance = 0;
+	for (short c : _clearance)
+	{
+		maxClearance = std::max(maxClearance, int(c));
+	}
+	std::vector< std::vector<int> > buckets(maxClearance + 1);
+	for (int index = 0; index < _rows * _cols; ++index)
+	{
+		if (_walkable[index])
+		{
+			buckets[_clearance[index]].push_back(index);
+		}
+	}
+
+	// Union-find over basins.
+	std::vector<int> parent;
+	std::vector<int> size;
+	std::vector<int> top;				// greatest clearance in the basin
+	auto find = [&parent](int b) -> int
+	{
+		while (parent[b] != b)
+		{
+			parent[b] = parent[parent[b]];
+			b = parent[b];
+		}
+		return b;
+	};
+
+	std::vector<int> basin(_rows * _cols, -1);
+	std::vector<Choke> chokes;			// regions are basin numbers for now
+
+	for (int clearance = maxClearance; clearance > 0; --clearance)
+	{
+		for (int index : buckets[clearance])
+		{
+			const int r = index / _cols;
+			const int c = index % _cols;
+
+			std::vector<int> touching;
+			for (int dr = -1; dr <= 1; ++dr)
+			{
+				for (int dc = -1; dc <= 1; ++dc)
+				{
+					const int nr = r + dr;
+					const int nc = c + dc;
+					if (nr >= 0 && nr < _rows && nc >= 0 && nc < _cols && basin[getIndex(nr, nc)] >= 0)
+					{
+						const int b = find(basin[getIndex(nr, nc)]);
+						if (std::find(touching.begin(), touching.end(), b) == touching.end())
+						{
+							touching.push_back(b);
+						}
+					}
+				}
+			}
+
+			if (touching.empty())
+			{
+				basin[index] = parent.size();
+				parent.push_back(parent.size());
+				size.push_back(1);
+				top.push_back(clearance);
+				continue;
+			}
+
+			// Join the biggest basin, and decide about the others.
+			int a = touching[0];
+			for (int b : touching)
+			{
+				if (size[b] > size[a])
+				{
+					a = b;
+				}
+			}
+
+			for (int b : touching)
+			{
+				if (b == a)
+				{
+					continue;
+				}
+
+				const bool separate =
+					size[a] >= MinRegionTiles && size[b] >= MinRegionTiles &&
+					top[a] >= MinRegionClearance && top[b] >= MinRegionClearance &&
+					100 * clearance < ChokeRatioPercent * std::min(top[a], top[b]);
+
+				if (separate)
+				{
+					// Record the choke, unless this tile belongs to a choke already found.
+					bool known = false;
+					const BWAPI::TilePosition here(c, r);
+					for (const Choke & choke : chokes)
+					{
+						if ((find(choke.region1) == a && find(choke.region2) == b) ||
+							(find(choke.region1) == b && find(choke.region2) == a))
+						{
+							if (std::abs(choke.center.x - here.x) + std::abs(choke.center.y - here.y) <= std::max(8, 2 * choke.width))
+							{
+								known = true;
+								break;
+							}
+						}
+					}
+					if (!known)
+					{
+						Choke choke;
+						choke.center = here;
+						choke.width = 2 * clearance - 1;
+						choke.region1 = a;
+						choke.region2 = b;
+						chokes.push_back(choke);
+					}
+				}
+				else
+				{
+					parent[b] = a;
+					size[a] += size[b];
+					top[a] = std::max(top[a], top[b]);
+				}
+			}
+
+			basin[index] = a;
+			++size[a];
+		}
+	}
+
+	// Number the final basins as regions.
+	std::vector<int> regionOf(parent.size(), -1);
+	for (int index = 0; index < _rows * _cols; ++index)
+	{
+		if (basin[index] < 0)
+		{
+			continue;
+		}
+		const int b = find(basin[index]);
+		if (regionOf[b] < 0)
+		{
+			regionOf[b] = _regions.size();
+			Region region;
+			region.center = BWAPI::TilePosition(index % _cols, index / _cols);
+			region.tiles = 0;
+			_regions.push_back(region);
+		}
+		Region & region = _regions[regionOf[b]];
+		_regionIDs[index] = regionOf[b];
+		++region.tiles;
+		if (_clearance[index] > _clearance[getIndex(region.center.y, region.center.x)])
+		{
+			region.center = BWAPI::TilePosition(index % _cols, index / _cols);
+		}
+	}
+
+	// Keep the chokes whose two sides did not end up in the same region after all.
+	for (Choke & choke : chokes)
+	{
+		choke.region1 = regionOf[find(choke.region1)];
+		choke.region2 = regionOf[find(choke.region2)];
+		if (choke.region1 != choke.region2)
+		{
+			_chokes.push_back(choke);
+		}
+	}
+}
+
+// Cluster the resources and find the best depot placement for each cluster.
+void MapAnalysis::computeBases()
+{
+	std::vector<BWAPI::Unit> resources;
+	for (const auto mineral : BWAPI::Broodwar->getStaticMinerals())
+	{
+		if (mineral->getInitialResources() >= MinMineralAmount)
+		{
+			resources.push_back(mineral);
+		}
+	}
+	for (const auto geyser : BWAPI::Broodwar->getStaticGeysers())
+	{
+		resources.push_back(geyser);
+	}
+
+	// Grow clusters by breadth-first search over nearby resources.
+	std::vector<int> cluster(resources.size(), -1);
+	int nClusters = 0;
+	for (size_t i = 0; i < resources.size(); ++i)
+	{
+		if (cluster[i] >= 0)
+		{
+			continue;
+		}
+		std::vector<size_t> fringe(1, i);
+		cluster[i] = nClusters;
+		for (size_t f = 0; f < fringe.size(); ++f)
+		{
+			for (size_t j = 0; j < resources.size(); ++j)
+			{
+				if (cluster[j] < 0 &&
+					resources[fringe[f]]->getInitialPosition().getApproxDistance(resources[j]->getInitialPosition()) <= ClusterDistance)
+				{
+					cluster[j] = nClusters;
+					fringe.push_back(j);
+				}
+			}
+		}
+		++nClusters;
+	}
+
+	for (int k = 0; k < nClusters; ++k)
+	{
+		std::vector<BWAPI::Unit> members;
+		Base base;
+		base.minerals = 0;
+		base.gas = 0;
+		base.startLocation = false;
+		BWAPI::Position sum(0, 0);
+		for (size_t i = 0; i < resources.size(); ++i)
+		{
+			if (cluster[i] == k)
+			{
+				members.push_back(resources[i]);
+				sum += resources[i]->getInitialPosition();
+				if (resources[i]->getInitialType().isMineralField())
+				{
+					base.minerals += resources[i]->getInitialResources();
+				}
+				else
+				{
+					base.gas += resources[i]->getInitialResources();
+				}
+			}
+		}
+		if (int(members.size()) < MinClusterResources)
+		{
+			continue;
+		}
+		const BWAPI::TilePosition middle(sum / int(members.size()));
+
+		// The depot must be buildable and keep its distance from all resources, not only these.
+		// Of the legal places, take the one closest to the resources.
+		const BWAPI::UnitType depotType = BWAPI::UnitTypes::Terran_Command_Center;
+		int bestScore = INT_MAX;
+		BWAPI::TilePosition bestTile = BWAPI::TilePositions::None;
+		for (int y = middle.y - DepotSearchRadius; y <= middle.y + DepotSearchRadius; ++y)
+		{
+			for (int x = middle.x - DepotSearchRadius; x <= middle.x + DepotSearchRadius; ++x)
+			{
+				bool legal = x >= 0 && y >= 0 && x + depotType.tileWidth() <= _cols && y + depotType.tileHeight() <= _rows;
+				for (int dy = 0; legal && dy < depotType.tileHeight(); ++dy)
+				{
+					for (int dx = 0; legal && dx < depotType.tileWidth(); ++dx)
+					{
+						legal = BWAPI::Broodwar->isBuildable(x + dx, y + dy);
+					}
+				}
+				for (size_t i = 0; legal && i < resources.size(); ++i)
+				{
+					const BWAPI::TilePosition rt = resources[i]->getInitialTilePosition();
+					const BWAPI::UnitType type = resources[i]->getInitialType();
+					legal =
+						x + depotType.tileWidth() + ResourceMargin <= rt.x ||
+						rt.x + type.tileWidth() + ResourceMargin <= x ||
+						y + depotType.tileHeight() + ResourceMargin <= rt.y ||
+						rt.y + type.tileHeight() + ResourceMargin <= y;
+				}
+				if (!legal)
+				{
+					continue;
+				}
+
+				const BWAPI::Position center = BWAPI::Position(BWAPI::TilePosition(x, y)) + BWAPI::Position(64, 48);
+				int score = 0;
+				for (const auto resource : members)
+				{
+					score += center.getApproxDistance(resource->getInitialPosition());
+				}
+				if (score < bestScore)
+				{
+					bestScore = score;
+					bestTile = BWAPI::TilePosition(x, y);
+				}
+			}
+		}
+
+		if (bestTile != BWAPI::TilePositions::None)
+		{
+			base.depot = bestTile;
+			_bases.push_back(base);
+		}
+	}
+
+	// Start locations are known exactly.
+	for (const BWAPI::TilePosition & start : BWAPI::Broodwar->getStartLocations())
+	{
+		Base * closest = nullptr;
+		for (Base & base : _bases)
+		{
+			const int dist = std::max(std::abs(base.depot.x - start.x), std::abs(base.depot.y - start.y));
+			if (dist <= StartLocationSnap &&
+				(!closest || dist < std::max(std::abs(closest->depot.x - start.x), std::abs(closest->depot.y - start.y))))
+			{
+				closest = &base;
+			}
+		}
+		if (!closest)
+		{
+			_bases.push_back(Base());
+			closest = &_bases.back();
+			closest->minerals = 0;
+			closest->gas = 0;
+		}
+		closest->depot = start;
+		closest->startLocation = true;
+	}
+
+	for (Base & base : _bases)
+	{
+		base.region = getRegionID(base.depot + BWAPI::TilePosition(2, 1));
+	}
+}
+
+// Fill in each region's list of chokes.
+void MapAnalysis::linkChokes()
+{
+	for (size_t i = 0; i < _chokes.size(); ++i)
+	{
+		_regions[_chokes[i].region1].chokes.push_back(i);
+		_regions[_chokes[i].region2].chokes.push_back(i);
+	}
+}
+
+// Read the analysis file, if there is one. Return false if it's missing or doesn't fit the map.
+// Exactly the walkable tiles are in regions, so a file that disagrees with the walkability is stale.
+// The file is read into temporaries, and the analysis is changed only if all of it is good.
+bool MapAnalysis::read()
+{
+	std::ifstream inFile(Config::IO::ReadDir + getFilename());
+	if (!inFile.good())
+	{
+		return false;
+	}
+
+	int version, cols, rows;
+	if (!(inFile >> version >> cols >> rows) || version != FileVersion || cols != _cols || rows != _rows)
+	{
+		return false;
+	}
+
+	const size_t nTiles = size_t(_rows * _cols);
+	std::vector<short> regionIDs(nTiles);
+	std::vector<short> clearance(nTiles);
+	for (size_t index = 0; index < nTiles; ++index)
+	{
+		if (!(inFile >> regionIDs[index] >> clearance[index]) || (regionIDs[index] >= 0) != _walkable[index])
+		{
+			return false;
+		}
+	}
+
+	size_t n;
+	if (!(inFile >> n) || n > nTiles)
+	{
+		return false;
+	}
+	std::vector<Region> regions(n);
+	for (Region & region : regions)
+	{
+		if (!(inFile >> region.center.x >> region.center.y >> region.tiles))
+		{
+			return false;
+		}
+	}
+
+	for (const short id : regionIDs)
+	{
+		if (id < -1 || id >= int(regions.size()))
+		{
+			return false;
+		}
+	}
+
+	if (!(inFile >> n) || n > nTiles)
+	{
+		return false;
+	}
+	std::vector<Choke> chokes(n);
+	for (Choke & choke : chokes)
+	{
+		if (!(inFile >> choke.center.x >> choke.center.y >> choke.width >> choke.region1 >> choke.region2) ||
+			choke.region1 < 0 || choke.region1 >= int(regions.size()) ||
+			choke.region2 < 0 || choke.region2 >= int(regions.size()))
+		{
+			return false;
+		}
+	}
+
+	if (!(inFile >> n) || n > nTiles)
+	{
+		return false;
+	}
+	std::vector<Base> bases(n);
+	for (Base & base : bases)
+	{
+		if (!(inFile >> base.depot.x >> base.depot.y >> base.region >> base.minerals >> base.gas >> base.startLocation) ||
+			base.region < -1 || base.region >= int(regions.size()) ||
+			!base.depot.isValid())
+		{
+			return false;
+		}
+	}
+
+	_regionIDs.swap(regionIDs);
+	_clearance.swap(clearance);
+	_regions.swap(regions);
+	_chokes.swap(chokes);
+	_bases.swap(bases);
+	return true;
+}
+
+void MapAnalysis::write() const
+{
+	std::ofstream outFile(Config::IO::WriteDir + getFilename());
+
+	// If it fails, we'll analyze the map again next time.
+	if (!outFile.good())
+	{
+		return;
+	}
+
+	outFile << FileVersion << ' ' << _cols << ' ' << _rows << '\n';
+
+	for (int r = 0; r < _rows; ++r)
+	{
+		for (int c = 0; c < _cols; ++c)
+		{
+			outFile << _regionIDs[getIndex(r, c)] << ' ' << _clearance[getIndex(r, c)] << ' ';
+		}
+		outFile << '\n';
+	}
+
+	outFile << _regions.size() << '\n';
+	for (const Region & region : _regions)
+	{
+		outFile << region.center.x << ' ' << region.center.y << ' ' << region.tiles << '\n';
+	}
+
+	outFile << _chokes.size() << '\n';
+	for (const Choke & choke : _chokes)
+	{
+		outFile << choke.center.x << ' ' << choke.center.y << ' ' << choke.width << ' ' << choke.region1 << ' ' << choke.region2 << '\n';
+	}
+
+	outFile << _bases.size() << '\n';
+	for (const Base & base : _bases)
+	{
+		outFile << base.depot.x << ' ' << base.depot.y << ' ' << base.region << ' ' << base.minerals << ' ' << base.gas << ' ' << base.startLocation << '\n';
+	}
+}
+
+// Off-map tiles are not walkable.
+bool MapAnalysis::isWalkable(const BWAPI::TilePosition & tile) const
+{
+	return tile.x >= 0 && tile.x < _cols && tile.y >= 0 && tile.y < _rows &&
+		_walkable[getIndex(tile.y, tile.x)];
+}
+
+// 0 for unwalkable and off-map tiles.
+int MapAnalysis::getClearance(const BWAPI::TilePosition & tile) const
+{
+	if (tile.x < 0 || tile.x >= _cols || tile.y < 0 || tile.y >= _rows)
+	{
+		return 0;
+	}
+	return _clearance[getIndex(tile.y, tile.x)];
+}
+
+// -1 for unwalkable and off-map tiles.
+int MapAnalysis::getRegionID(const BWAPI::TilePosition & tile) const
+{
+	if (tile.x < 0 || tile.x >= _cols || tile.y < 0 || tile.y >= _rows)
+	{
+		return -1;
+	}
+	return _regionIDs[getIndex(tile.y, tile.x)];
+}
+
+void MapAnalysis::drawMapAnalysis() const
+{
+	if (!Config::Debug::DrawMapAnalysis)
+	{
+		return;
+	}
+
+	BWAPI::Broodwar->drawTextScreen(10, 10, "%cmap analysis %s: %d regions, %d chokes, %d bases",
+		white, _readFromFile ? "read" : "computed", int(_regions.size()), int(_chokes.size()), int(_bases.size()));
+
+	for (size_t i = 0; i < _regions.size(); ++i)
+	{
+		const BWAPI::Position center = BWAPI::Position(_regions[i].center) + BWAPI::Position(16, 16);
+		BWAPI::Broodwar->drawTextMap(center, "%cregion %d", yellow, i);
+	}
+
+	for (const Choke & choke : _chokes)
+	{
+		const BWAPI::Position center = BWAPI::Position(choke.center) + BWAPI::Position(16, 16);
+		BWAPI::Broodwar->drawCircleMap(center, 16 * choke.width, BWAPI::Colors::Orange);
+		BWAPI::Broodwar->drawLineMap(center, BWAPI::Position(_regions[choke.region1].center) + BWAPI::Position(16, 16), BWAPI::Colors::Orange);
+		BWAPI::Broodwar->drawLineMap(center, BWAPI::Position(_regions[choke.region2].center) + BWAPI::Position(16, 16), BWAPI::Colors::Orange);
+	}
+
+	for (const Base & base : _bases)
+	{
+		const BWAPI::Position topLeft(base.depot);
+		BWAPI::Broodwar->drawBoxMap(topLeft, topLeft + BWAPI::Position(128, 96), base.startLocation ? BWAPI::Colors::Green : BWAPI::Colors::Cyan);
+		BWAPI::Broodwar->drawTextMap(topLeft + BWAPI::Position(4, 4), "%c%d %d", white, base.minerals, base.gas);
+	}
+}
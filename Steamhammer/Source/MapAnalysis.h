@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Common.h"
+
+namespace UAlbertaBot
+{
+
+// Regions, chokepoints and base locations, worked out from build tile walkability and
+// the map's starting resources, without BWTA.
+// Regions are found by flooding the walkable tiles from the most open tiles downward
+// (a watershed on the clearance, the distance to the nearest unwalkable tile).
+// Where two large basins meet at a narrow point, the meeting point is a chokepoint.
+// Bases are placed next to clusters of minerals and geysers.
+// The analysis is saved to a file named for the map hash. It is read from Config::IO::ReadDir
+// and, if it was not there, computed and written to Config::IO::WriteDir (like the opponent model).
+// It is made in onStart, next to BWTA, so that the game loop never pays for it.
+class MapAnalysis
+{
+public:
+
+	struct Region
+	{
+		BWAPI::TilePosition		center;			// the most open tile
+		int						tiles;
+		std::vector<int>		chokes;			// indexes into getChokes()
+	};
+
+	struct Choke
+	{
+		BWAPI::TilePosition		center;
+		int						width;			// in tiles
+		int						region1;		// indexes into getRegions()
+		int						region2;
+	};
+
+	struct Base
+	{
+		BWAPI::TilePosition		depot;			// top left tile of the resource depot
+		int						region;			// -1 if none
+		int						minerals;		// initial amounts
+		int						gas;
+		bool					startLocation;
+	};
+
+private:
+
+	int							_rows;
+	int							_cols;
+	std::vector<bool>			_walkable;		// build tile resolution, same rule as MapTools
+	std::vector<short>			_clearance;		// tiles to the nearest unwalkable tile or map edge
+	std::vector<short>			_regionIDs;		// -1 if not walkable
+	std::vector<Region>			_regions;
+	std::vector<Choke>			_chokes;
+	std::vector<Base>			_bases;
+	bool						_readFromFile;
+
+	MapAnalysis();
+
+	int				getIndex(int row, int col) const { return row * _cols + col; }
+	std::string		getFilename() const;
+
+	void			computeWalkability();
+	void			computeClearance();
+	void			computeRegions();
+	void			computeBases();
+	void			linkChokes();
+
+	bool			read();
+	void			write() const;
+
+public:
+
+	static MapAnalysis &	Instance();
+
+	bool					isWalkable(const BWAPI::TilePosition & tile) const;
+	int						getClearance(const BWAPI::TilePosition & tile) const;
+	int						getRegionID(const BWAPI::TilePosition & tile) const;
+
+	const std::vector<Region> &	getRegions() const	{ return _regions; };
+	const std::vector<Choke> &	getChokes() const	{ return _chokes; };
+	const std::vector<Base> &	getBases() const	{ return _bases; };
+
+	void					drawMapAnalysis() const;
+};
+
+}
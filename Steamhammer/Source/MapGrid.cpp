@@ -19,44 +19,91 @@ MapGrid::MapGrid(int mapWidth, int mapHeight, int cellSize)
 	, rows((mapHeight + cellSize - 1) / cellSize)
 	, cells(rows * cols)
 	, lastUpdated(0)
+	, exploreQueue(ExploreOrder(this))
 {
 	calculateCellCenters();
+	calculateHomeInfo();
+}
+
+// Least recently visited first. Break ties by distance from home, farthest first,
+// then by cell index so that the order is total.
+bool MapGrid::ExploreOrder::operator()(int a, int b) const
+{
+	const int visitedA = grid->cells[a].timeLastVisited;
+	const int visitedB = grid->cells[b].timeLastVisited;
+	if (visitedA != visitedB)
+	{
+		return visitedA < visitedB;
+	}
+	if (grid->distanceToHome[a] != grid->distanceToHome[b])
+	{
+		return grid->distanceToHome[a] > grid->distanceToHome[b];
+	}
+	return a < b;
 }
 
 //  The least-recently explored cell accessible by land.
 BWAPI::Position MapGrid::getLeastExplored() 
 {
-	int minSeen = 1000000;
-	double minSeenDist = 0;
-	int leastRow(0), leastCol(0);
+	if (exploreQueue.empty())
+	{
+		return getCellCenter(0, 0);
+	}
 
-	for (int r=0; r<rows; ++r)
+	const int best = *exploreQueue.begin();
+	return getCellCenter(best / cols, best % cols);
+}
+
+// Connectivity to our start location and distance from it never change.
+// Figure them out once, and put the connected cells into the explore queue.
+// Prerequisite: Call calculateCellCenters() first.
+void MapGrid::calculateHomeInfo()
+{
+	const BWAPI::TilePosition homeTile = BWAPI::Broodwar->self()->getStartLocation();
+	const BWAPI::Position home(homeTile);
+
+	connectedToHome.assign(rows * cols, false);
+	distanceToHome.assign(rows * cols, 0.0);
+
+	for (int r = 0; r < rows; ++r)
 	{
-		for (int c=0; c<cols; ++c)
+		for (int c = 0; c < cols; ++c)
 		{
-			// get the center of this cell
-			BWAPI::Position cellCenter = getCellCenter(r,c);
+			const int i = r*cols + c;
+			const BWAPI::Position cellCenter = getCellCenter(r, c);
 
-			// don't worry about places that aren't connected to our start location
-			if (!BWTA::isConnected(BWAPI::TilePosition(cellCenter), BWAPI::Broodwar->self()->getStartLocation()))
-			{
-				continue;
-			}
+			connectedToHome[i] = BWTA::isConnected(BWAPI::TilePosition(cellCenter), homeTile);
+			distanceToHome[i] = home.getDistance(cellCenter);
 
-			BWAPI::Position home(BWAPI::Broodwar->self()->getStartLocation());
-			double dist = home.getDistance(getCellByIndex(r, c).center);
-            int lastVisited = getCellByIndex(r, c).timeLastVisited;
-			if (lastVisited < minSeen || ((lastVisited == minSeen) && (dist > minSeenDist)))
+			if (connectedToHome[i])
 			{
-				leastRow = r;
-				leastCol = c;
-				minSeen = getCellByIndex(r, c).timeLastVisited;
-				minSeenDist = dist;
+				exploreQueue.insert(i);
 			}
 		}
 	}
+}
 
-	return getCellCenter(leastRow, leastCol);
+// The cell was visited. Keep the explore queue in order.
+void MapGrid::setTimeLastVisited(int r, int c, int frame)
+{
+	const int i = r*cols + c;
+	GridCell & cell = cells[i];
+
+	if (cell.timeLastVisited == frame)
+	{
+		return;
+	}
+
+	if (connectedToHome[i])
+	{
+		exploreQueue.erase(i);
+		cell.timeLastVisited = frame;
+		exploreQueue.insert(i);
+	}
+	else
+	{
+		cell.timeLastVisited = frame;
+	}
 }
 
 void MapGrid::calculateCellCenters()
@@ -162,12 +209,18 @@ void MapGrid::update()
 		if (unit->isCompleted() || unit->getType().isBuilding())
 		{
 			getCell(unit).ourUnits.insert(unit);
-			getCell(unit).timeLastVisited = BWAPI::Broodwar->getFrameCount();
+			setTimeLastVisited(unit->getPosition().y / cellSize, unit->getPosition().x / cellSize, BWAPI::Broodwar->getFrameCount());
 		}
 	}
 
+	enemiesByRegion.clear();
 	for (const auto unit : BWAPI::Broodwar->enemy()->getUnits()) 
 	{
+		if (unit->getPosition().isValid())
+		{
+			enemiesByRegion[BWTA::getRegion(BWAPI::TilePosition(unit->getPosition()))].insert(unit);
+		}
+
 		if (unit->exists() &&
 			(unit->isCompleted() || unit->getType().isBuilding()) &&
 			unit->getHitPoints() > 0 &&
@@ -226,6 +279,15 @@ void MapGrid::GetUnits(BWAPI::Unitset & units, BWAPI::Position center, int radiu
 	}
 }
 
+// All visible enemy units in the region, as of this frame's update().
+const BWAPI::Unitset & MapGrid::getEnemiesInRegion(BWTA::Region * region) const
+{
+	static const BWAPI::Unitset none;
+
+	auto it = enemiesByRegion.find(region);
+	return it == enemiesByRegion.end() ? none : it->second;
+}
+
 // The bot scanned the given position. Record it so we don't scan the same position
 // again before it wears off.
 void MapGrid::scanAtPosition(const BWAPI::Position & pos)
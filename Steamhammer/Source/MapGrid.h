@@ -41,7 +41,27 @@ class MapGrid
 
 	std::vector< GridCell >		cells;
 
+	// Facts that do not change during the game, indexed like cells.
+	std::vector<bool>			connectedToHome;
+	std::vector<double>			distanceToHome;
+
+	// Cells connected to our start location, least recently visited first,
+	// then farthest from home first. The key includes timeLastVisited, so a cell
+	// must be taken out and put back whenever that changes.
+	struct ExploreOrder
+	{
+		const MapGrid * grid;
+		ExploreOrder(const MapGrid * g = nullptr) : grid(g) {}
+		bool operator()(int a, int b) const;
+	};
+	std::set<int, ExploreOrder>	exploreQueue;
+
+	// Visible enemy units by the BWTA region they are in. Filled in the same pass as the grid.
+	std::map<BWTA::Region *, BWAPI::Unitset>	enemiesByRegion;
+
 	void						calculateCellCenters();
+	void						calculateHomeInfo();
+	void						setTimeLastVisited(int r, int c, int frame);
 
 	void						clearGrid();
 	BWAPI::Position				getCellCenter(int x, int y);
@@ -53,6 +73,7 @@ public:
 
 	void				update();
 	void				GetUnits(BWAPI::Unitset & units, BWAPI::Position center, int radius, bool ourUnits, bool oppUnits);
+	const BWAPI::Unitset & getEnemiesInRegion(BWTA::Region * region) const;
 	BWAPI::Position		getLeastExplored();
 
 	GridCell & getCellByIndex(int r, int c)		{ return cells[r*cols + c]; }
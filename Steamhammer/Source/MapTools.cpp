@@ -1,4 +1,5 @@
 #include "MapTools.h"
+#include "MapAnalysis.h"
 #include "BuildingPlacer.h"
 #include "InformationManager.h"
 
@@ -37,52 +38,19 @@ bool MapTools::unexplored(DistanceMap & dmap,const int index) const
 		_map[index];                 // the map says it's walkable
 }
 
-// Read the map data from BWAPI and remember which 32x32 build tiles are walkable.
+// Copy the walkable build tiles from the map analysis, which has already read them from BWAPI.
 // NOTE The game map is walkable at the resolution of 8x8 walk tiles, so this is an approximation.
 //      We're asking "Can big units walk here?" Small units may be able to squeeze into more places.
+//      Immobile static neutral units (like mineral walls) block the tiles they stand on.
 void MapTools::setBWAPIMapData()
 {
-	// 1. Check terrain: Is it walkable?
     for (int r(0); r < _rows; ++r)
     {
         for (int c(0); c < _cols; ++c)
         {
-            bool walkable = true;
-
-            // check each walk tile within this TilePosition
-            for (int i=0; i<4 && walkable; ++i)
-            {
-                for (int j=0; j<4 && walkable; ++j)
-                {
-                    if (!BWAPI::Broodwar->isWalkable(c*4 + i,r*4 + j))
-                    {
-                        walkable = false;
-                    }
-                }
-			}
-
-            _map[getIndex(r,c)] = walkable;
+            _map[getIndex(r,c)] = MapAnalysis::Instance().isWalkable(BWAPI::TilePosition(c, r));
         }
     }
-
-	// 2. Check static units: Do they block tiles?
-	// TODO in progress
-	for (const auto unit : BWAPI::Broodwar->getStaticNeutralUnits())
-	{
-		// The neutral units may include moving critters which do not permanently block tiles.
-		// Someting immobile blocks tiles it occupies until it is destroyed (exceptions may be possible).
-		if (!unit->getType().canMove() && !unit->isFlying())
-		{
-			BWAPI::TilePosition pos = unit->getTilePosition();
-			for (int r = pos.y; r < pos.y + unit->getType().tileHeight(); ++r)
-			{
-				for (int c = pos.x; c < pos.x + unit->getType().tileWidth(); ++c)
-				{
-					_map[getIndex(r, c)] = false;
-				}
-			}
-		}
-	}
 }
 
 void MapTools::resetFringe()
@@ -231,6 +199,24 @@ const std::vector<BWAPI::TilePosition> & MapTools::getClosestTilesTo(BWAPI::Posi
     return _allMaps[pos].getSortedTiles();
 }
 
+// Can big ground units walk on the build tile? Off-map tiles are not walkable.
+bool MapTools::isWalkable(const BWAPI::TilePosition & tile) const
+{
+	return tile.x >= 0 && tile.x < _cols && tile.y >= 0 && tile.y < _rows &&
+		_map[tile.y * _cols + tile.x];
+}
+
+// The distance maps that are already computed, with the tile each one measures from.
+// Nothing is computed. The pointers are good until the next call to getGroundTileDistance().
+void MapTools::getCachedDistanceMaps(std::vector< std::pair<BWAPI::TilePosition, const DistanceMap *> > & maps) const
+{
+	maps.clear();
+	for (const auto & kv : _allMaps)
+	{
+		maps.push_back(std::pair<BWAPI::TilePosition, const DistanceMap *>(BWAPI::TilePosition(kv.first), &kv.second));
+	}
+}
+
 BWAPI::TilePosition MapTools::getTilePosition(int index)
 {
     return BWAPI::TilePosition(index % _cols,index / _cols);
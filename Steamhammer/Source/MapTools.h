@@ -26,7 +26,7 @@ class MapTools
 
     int                     getIndex(int row,int col);		// return the index of the 1D array from (row,col)
     bool                    unexplored(DistanceMap & dmap,const int index) const;
-    void                    setBWAPIMapData();				// reads in the map data from bwapi and stores it in our map format
+    void                    setBWAPIMapData();				// copies the walkable tiles from MapAnalysis
 	void                    resetFringe();
     void                    computeDistance(DistanceMap & dmap,const BWAPI::Position p); // computes walk distance from Position P to all other points on the map
     BWAPI::TilePosition     getTilePosition(int index);
@@ -46,6 +46,9 @@ public:
 
     const std::vector<BWAPI::TilePosition> & getClosestTilesTo(BWAPI::Position pos);
 
+	bool                    isWalkable(const BWAPI::TilePosition & tile) const;
+	void                    getCachedDistanceMaps(std::vector< std::pair<BWAPI::TilePosition, const DistanceMap *> > & maps) const;
+
 };
 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Micro.h"
 #include "MapGrid.h"
+#include "ThreatGrid.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
@@ -437,8 +438,8 @@ void Micro::SmartKiteTarget(BWAPI::Unit rangedUnit, BWAPI::Unit target)
 
 	if (kite)
 	{
-		// Run away.
-		BWAPI::Position fleePosition(rangedUnit->getPosition() - target->getPosition() + rangedUnit->getPosition());
+		// Run away, steering clear of other enemies too.
+		BWAPI::Position fleePosition(rangedUnit->getPosition() + AvoidThreats(rangedUnit, rangedUnit->getPosition() - target->getPosition()));
 		if (Config::Debug::DrawUnitTargetInfo)
 		{
 			BWAPI::Broodwar->drawLineMap(rangedUnit->getPosition(), fleePosition, BWAPI::Colors::Cyan);
@@ -483,7 +484,7 @@ void Micro::MutaDanceTarget(BWAPI::Unit muta, BWAPI::Unit target)
 	}
 	else // Otherwise we cannot attack and should temporarily back off
 	{
-		BWAPI::Position fleeVector = GetKiteVector(target, muta);
+		BWAPI::Position fleeVector = AvoidThreats(muta, GetKiteVector(target, muta));
 		BWAPI::Position moveToPosition(muta->getPosition() + fleeVector);
 		if (moveToPosition.isValid())
 		{
@@ -499,3 +500,30 @@ BWAPI::Position Micro::GetKiteVector(BWAPI::Unit unit, BWAPI::Unit target)
     fleeVec = BWAPI::Position(static_cast<int>(64 * cos(fleeAngle)), static_cast<int>(64 * sin(fleeAngle)));
     return fleeVec;
 }
+
+// Bend a flee vector away from enemy threats, keeping its length.
+// The threat gradient says where danger increases, so we add a vector pointing the
+// other way with the same length as the flee vector. If the threat is flat, nothing changes.
+BWAPI::Position Micro::AvoidThreats(BWAPI::Unit unit, const BWAPI::Position & fleeVector)
+{
+	const BWAPI::Position gradient = ThreatGrid::Instance().getThreatGradient(unit->getPosition(), unit->isFlying());
+	const double fleeLength = fleeVector.getLength();
+	const double gradientLength = gradient.getLength();
+
+	if (gradientLength < 0.5 || fleeLength < 0.5)
+	{
+		return fleeVector;
+	}
+
+	const double x = fleeVector.x - fleeLength * gradient.x / gradientLength;
+	const double y = fleeVector.y - fleeLength * gradient.y / gradientLength;
+	const double length = sqrt(x * x + y * y);
+
+	if (length < 0.5)
+	{
+		// The threat is exactly opposite the flee direction. Keep going.
+		return fleeVector;
+	}
+
+	return BWAPI::Position(int(x * fleeLength / length), int(y * fleeLength / length));
+}
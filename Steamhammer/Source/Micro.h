@@ -21,6 +21,7 @@ namespace Micro
 	void SmartKiteTarget(BWAPI::Unit rangedUnit, BWAPI::Unit target);
     void MutaDanceTarget(BWAPI::Unit muta, BWAPI::Unit target);
     BWAPI::Position GetKiteVector(BWAPI::Unit unit, BWAPI::Unit target);
+	BWAPI::Position AvoidThreats(BWAPI::Unit unit, const BWAPI::Position & fleeVector);
 
     void Rotate(double &x, double &y, double angle);
     void Normalize(double &x, double &y);
@@ -4,6 +4,15 @@
 
 using namespace UAlbertaBot;
 
+// Target scores, made so that range comes first, then priority, then distance.
+const int PriorityStep = 1 << 14;		// more than any distance in pixels
+const int InRangeBonus = 1 << 20;		// more than any priority
+
+// Lurker spines hit everything in a line, so overkill matters less than for other units.
+// Burrowed lurkers can still spread out over the targets in range. A target that is already
+// taken care of is worth one priority step less, which never moves a lurker out of range.
+const int OverkillPenalty = PriorityStep;
+
 MicroLurkers::MicroLurkers()
 {
 }
@@ -13,16 +22,23 @@ void MicroLurkers::executeMicro(const BWAPI::Unitset & targets)
 	const BWAPI::Unitset & lurkers = getUnits();
 
 	// Potential targets.
-	BWAPI::Unitset LurkerTargets;
-	std::copy_if(targets.begin(), targets.end(), std::inserter(LurkerTargets, LurkerTargets.end()),
+	std::vector<BWAPI::Unit> LurkerTargets;
+	std::copy_if(targets.begin(), targets.end(), std::back_inserter(LurkerTargets),
 		[](BWAPI::Unit u){ return u->isVisible() && !u->isFlying() && u->getPosition().isValid(); });
 
 	const int lurkerRange = BWAPI::UnitTypes::Zerg_Lurker.groundWeapon().maxRange();
 
-	for (const auto lurker : lurkers)
+	// Choose the lurkers' targets all together.
+	const std::vector<BWAPI::Unit> lurkerList(lurkers.begin(), lurkers.end());
+	_targetAssigner.setUnits(lurkerList, LurkerTargets);
+	scoreTargets();
+	_targetAssigner.assign(OverkillPenalty, 0);
+
+	for (size_t i = 0; i < lurkerList.size(); ++i)
 	{
+		const BWAPI::Unit lurker = lurkerList[i];
 		const bool inOrderRange = lurker->getDistance(order.getPosition()) <= 3 * 32;
-		BWAPI::Unit target = getTarget(lurker, LurkerTargets);
+		BWAPI::Unit target = _targetAssigner.getTarget(i);
 
 		if (target)
 		{
@@ -134,47 +150,28 @@ void MicroLurkers::executeMicro(const BWAPI::Unitset & targets)
 	}
 }
 
-// Return a target in range if any exists.
-// Only ground targets are passed in.
-BWAPI::Unit MicroLurkers::getTarget(BWAPI::Unit lurker, const BWAPI::Unitset & targets)
+// Score each lurker-target pair for the target assigner.
+// A target in range always beats one out of range. Then higher priority is better, then closer.
+void MicroLurkers::scoreTargets()
 {
-	if (targets.empty())
-	{
-		return nullptr;
-	}
-
 	const int lurkerRange = BWAPI::UnitTypes::Zerg_Lurker.groundWeapon().maxRange();
+	const size_t nTargets = _targetAssigner.getTargetCount();
 
-	BWAPI::Unitset targetsInRange;
-	for (const auto target : targets)
+	std::vector<int> priority(nTargets);
+	for (size_t t = 0; t < nTargets; ++t)
 	{
-		if (lurker->getDistance(target) <= lurkerRange)
-		{
-			targetsInRange.insert(target);
-		}
+		priority[t] = getAttackPriority(_targetAssigner.getTargetUnit(t));
 	}
 
-	// If any targets are in lurker range, then always return one of the targets in range.
-	const BWAPI::Unitset & newTargets = targetsInRange.empty() ? targets : targetsInRange;
-
-	int highPriority = 0;
-	int closestDist = 99999;
-	BWAPI::Unit bestTarget = nullptr;
-
-	for (const auto target : newTargets)
+	for (size_t a = 0; a < _targetAssigner.getAttackerCount(); ++a)
 	{
-		int distance = lurker->getDistance(target);
-		int priority = getAttackPriority(target);
-
-		if ((priority > highPriority) || (priority == highPriority && distance < closestDist))
+		for (size_t t = 0; t < nTargets; ++t)
 		{
-			closestDist = distance;
-			highPriority = priority;
-			bestTarget = target;
+			const int distance = std::min(_targetAssigner.getDistance(a, t), PriorityStep - 1);
+			const int inRange = distance <= lurkerRange ? InRangeBonus : 0;
+			_targetAssigner.setScore(a, t, inRange + PriorityStep * priority[t] - distance);
 		}
 	}
-
-	return bestTarget;
 }
 
 //  Only ground units are passed in as potential targets.
@@ -2,17 +2,21 @@
 
 #include <Common.h>
 #include "MicroManager.h"
+#include "TargetAssigner.h"
 
 namespace UAlbertaBot
 {
 	class MicroLurkers : public MicroManager
 	{
+		TargetAssigner _targetAssigner;
+
+		void scoreTargets();
+
 	public:
 
 		MicroLurkers();
 
 		void executeMicro(const BWAPI::Unitset & targets);
-		BWAPI::Unit getTarget(BWAPI::Unit lurker, const BWAPI::Unitset & targets);
 		int getAttackPriority(BWAPI::Unit target) const;
 	};
 }
\ No newline at end of file
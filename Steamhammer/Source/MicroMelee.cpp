@@ -5,6 +5,12 @@ using namespace UAlbertaBot;
 
 // Note: Melee units are ground units only. Scourge is a "ranged" unit.
 
+// A target that the units already on it will kill is worth one priority step less to the others,
+// so that melee units spread out around the enemy. Units count toward the kill when they are
+// within range plus the slack.
+const int OverkillPenalty = 2 * 32;
+const int OverkillSlack = 16;
+
 MicroMelee::MicroMelee() 
 { 
 }
@@ -18,7 +24,7 @@ void MicroMelee::assignTargets(const BWAPI::Unitset & targets)
 {
     const BWAPI::Unitset & meleeUnits = getUnits();
 
-	BWAPI::Unitset meleeUnitTargets;
+	std::vector<BWAPI::Unit> meleeUnitTargets;
 	for (const auto target : targets) 
 	{
 		if (target->isVisible() &&
@@ -30,10 +36,12 @@ void MicroMelee::assignTargets(const BWAPI::Unitset & targets)
 			!target->isStasised() &&
 			!target->isUnderDisruptionWeb())             // melee unit can't attack under dweb
 		{
-			meleeUnitTargets.insert(target);
+			meleeUnitTargets.push_back(target);
 		}
 	}
 
+	// First the units that have something else to do. The rest fight.
+	std::vector<BWAPI::Unit> fighters;
 	for (const auto meleeUnit : meleeUnits)
 	{
 		if (order.isCombatOrder()) 
@@ -61,15 +69,26 @@ void MicroMelee::assignTargets(const BWAPI::Unitset & targets)
 			}
 			else
 			{
-				// There are targets. Pick the best one and attack it.
-				// NOTE We *always* choose a target. We can't decide none are worth it and bypass them.
-				//      This causes a lot of needless distraction.
-				BWAPI::Unit target = getTarget(meleeUnit, meleeUnitTargets);
-				Micro::SmartAttackUnit(meleeUnit, target);
+				fighters.push_back(meleeUnit);
 			}
 		}
+	}
 
-		if (Config::Debug::DrawUnitTargetInfo)
+	// There are targets. Pick the best ones, all together, and attack them.
+	// NOTE We *always* choose a target. We can't decide none are worth it and bypass them.
+	//      This causes a lot of needless distraction.
+	_targetAssigner.setUnits(fighters, meleeUnitTargets);
+	scoreTargets();
+	_targetAssigner.assign(OverkillPenalty, OverkillSlack);
+
+	for (size_t i = 0; i < fighters.size(); ++i)
+	{
+		Micro::SmartAttackUnit(fighters[i], _targetAssigner.getTarget(i));
+	}
+
+	if (Config::Debug::DrawUnitTargetInfo)
+	{
+		for (const auto meleeUnit : meleeUnits)
 		{
 			BWAPI::Broodwar->drawLineMap(meleeUnit->getPosition(), meleeUnit->getTargetPosition(),
 				Config::Debug::ColorLineTarget);
@@ -77,80 +96,97 @@ void MicroMelee::assignTargets(const BWAPI::Unitset & targets)
 	}
 }
 
-// Choose a target from the set. Never return null!
-BWAPI::Unit MicroMelee::getTarget(BWAPI::Unit meleeUnit, const BWAPI::Unitset & targets)
+// Score each fighter-target pair for the target assigner.
+// The parts of the score that depend only on the target are worked out once per target.
+void MicroMelee::scoreTargets()
 {
-	int bestScore = -999999;
-	BWAPI::Unit bestTarget = nullptr;
+	const size_t nTargets = _targetAssigner.getTargetCount();
 
-	for (const auto target : targets)
+	std::vector<int> targetScore(nTargets);
+	std::vector<int> notMovingBonus(nTargets);		// -1 if the target is moving freely
+	for (size_t t = 0; t < nTargets; ++t)
 	{
-		int priority = getAttackPriority(meleeUnit, target);    // 0..12
-		int range = meleeUnit->getDistance(target);             // 0..map size in pixels
-		int toGoal = target->getDistance(order.getPosition());  // 0..map size in pixels
+		const BWAPI::Unit target = _targetAssigner.getTargetUnit(t);
 
-		// Let's say that 1 priority step is worth 64 pixels (2 tiles).
-		// We care about unit-target range and target-order position distance.
-		int score = 2 * 32 * priority - range - toGoal/2;
+		// We care about the target-order position distance.
+		int score = -target->getDistance(order.getPosition()) / 2;
 
-		// Adjust for special features.
-		// This could adjust for relative speed and direction, so that we don't chase what we can't catch.
-		if (meleeUnit->isInWeaponRange(target))
+		if (target->isUnderStorm())
 		{
-			if (meleeUnit->getType() == BWAPI::UnitTypes::Zerg_Ultralisk)
-			{
-				score += 12 * 32;   // because they're big and awkward
-			}
-			else
-			{
-				score += 2 * 32;
-			}
+			score -= 128;
+		}
+
+		// Prefer targets that are already hurt.
+		if (target->getType().getRace() == BWAPI::Races::Protoss && target->getShields() == 0)
+		{
+			score += 32;
+		}
+		else if (target->getHitPoints() < target->getType().maxHitPoints())
+		{
+			score += 24;
 		}
-		else if (!target->isMoving())
+		targetScore[t] = score;
+
+		if (!target->isMoving())
 		{
 			if (target->isSieged() ||
 				target->getOrder() == BWAPI::Orders::Sieging ||
 				target->getOrder() == BWAPI::Orders::Unsieging)
 			{
-				score += 48;
+				notMovingBonus[t] = 48;
 			}
 			else
 			{
-				score += 24;
+				notMovingBonus[t] = 24;
 			}
 		}
 		else if (target->isBraking())
 		{
-			score += 16;
+			notMovingBonus[t] = 16;
 		}
-		else if (target->getType().topSpeed() >= meleeUnit->getType().topSpeed())
+		else
 		{
-			score -= 2 * 32;
+			notMovingBonus[t] = -1;
 		}
+	}
 
-		if (target->isUnderStorm())
-		{
-			score -= 128;
-		}
+	for (size_t a = 0; a < _targetAssigner.getAttackerCount(); ++a)
+	{
+		const BWAPI::Unit meleeUnit = _targetAssigner.getAttacker(a);
+		const double speed = meleeUnit->getType().topSpeed();
+		const int inRangeBonus = meleeUnit->getType() == BWAPI::UnitTypes::Zerg_Ultralisk
+			? 12 * 32		// because they're big and awkward
+			: 2 * 32;
 
-		// Prefer targets that are already hurt.
-		if (target->getType().getRace() == BWAPI::Races::Protoss && target->getShields() == 0)
-		{
-			score += 32;
-		}
-		else if (target->getHitPoints() < target->getType().maxHitPoints())
+		for (size_t t = 0; t < nTargets; ++t)
 		{
-			score += 24;
-		}
+			const BWAPI::Unit target = _targetAssigner.getTargetUnit(t);
 
-		if (score > bestScore)
-		{
-			bestScore = score;
-			bestTarget = target;
+			int priority = getAttackPriority(meleeUnit, target);	// 0..12
+			int range = _targetAssigner.getDistance(a, t);			// 0..map size in pixels
+
+			// Let's say that 1 priority step is worth 64 pixels (2 tiles).
+			// We care about unit-target range and target-order position distance.
+			int score = 2 * 32 * priority - range + targetScore[t];
+
+			// Adjust for special features.
+			// This could adjust for relative speed and direction, so that we don't chase what we can't catch.
+			if (_targetAssigner.isInWeaponRange(a, t))
+			{
+				score += inRangeBonus;
+			}
+			else if (notMovingBonus[t] >= 0)
+			{
+				score += notMovingBonus[t];
+			}
+			else if (target->getType().topSpeed() >= speed)
+			{
+				score -= 2 * 32;
+			}
+
+			_targetAssigner.setScore(a, t, score);
 		}
 	}
-
-	return bestTarget;
 }
 
 // get the attack priority of a type
@@ -2,6 +2,7 @@
 
 #include <Common.h>
 #include "MicroManager.h"
+#include "TargetAssigner.h"
 
 namespace UAlbertaBot
 {
@@ -9,6 +10,9 @@ class MicroManager;
 
 class MicroMelee : public MicroManager
 {
+	TargetAssigner _targetAssigner;
+
+	void scoreTargets();
 
 public:
 
@@ -18,7 +22,6 @@ public:
 	void assignTargets(const BWAPI::Unitset & targets);
 
 	int getAttackPriority(BWAPI::Unit attacker, BWAPI::Unit unit) const;
-	BWAPI::Unit getTarget(BWAPI::Unit meleeUnit, const BWAPI::Unitset & targets);
 	bool meleeUnitShouldRetreat(BWAPI::Unit meleeUnit, const BWAPI::Unitset & targets);
 };
 }
\ No newline at end of file
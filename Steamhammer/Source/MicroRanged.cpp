@@ -3,6 +3,11 @@
 
 using namespace UAlbertaBot;
 
+// A target that the units already on it will kill is worth one priority step less to the others.
+// Units count toward the kill when they are within range plus the slack.
+const int OverkillPenalty = 5 * 32;
+const int OverkillSlack = 32;
+
 MicroRanged::MicroRanged()
 { 
 }
@@ -17,8 +22,8 @@ void MicroRanged::assignTargets(const BWAPI::Unitset & targets)
     const BWAPI::Unitset & rangedUnits = getUnits();
 
 	// The set of potential targets.
-	BWAPI::Unitset rangedUnitTargets;
-    std::copy_if(targets.begin(), targets.end(), std::inserter(rangedUnitTargets, rangedUnitTargets.end()),
+	std::vector<BWAPI::Unit> rangedUnitTargets;
+    std::copy_if(targets.begin(), targets.end(), std::back_inserter(rangedUnitTargets),
 		[](BWAPI::Unit u) {
 		return
 			u->isVisible() &&
@@ -28,6 +33,8 @@ void MicroRanged::assignTargets(const BWAPI::Unitset & targets)
 			!u->isStasised();
 	});
 
+	// First the units that have something else to do. The rest fight.
+	std::vector<BWAPI::Unit> fighters;
     for (const auto rangedUnit : rangedUnits)
 	{
 		if (buildScarabOrInterceptor(rangedUnit))
@@ -77,122 +84,154 @@ void MicroRanged::assignTargets(const BWAPI::Unitset & targets)
 				continue;
 			}
 
-			// If a target can be found.
-			BWAPI::Unit target = getTarget(rangedUnit, rangedUnitTargets);
-			if (target)
+			fighters.push_back(rangedUnit);
+		}
+	}
+
+	// Choose the fighters' targets all together.
+	_targetAssigner.setUnits(fighters, rangedUnitTargets);
+	scoreTargets();
+	_targetAssigner.assign(OverkillPenalty, OverkillSlack);
+
+	for (size_t i = 0; i < fighters.size(); ++i)
+	{
+		const BWAPI::Unit rangedUnit = fighters[i];
+
+		BWAPI::Unit target = _targetAssigner.getTarget(i);
+		if (target)
+		{
+			if (Config::Debug::DrawUnitTargetInfo)
 			{
-				if (Config::Debug::DrawUnitTargetInfo)
-				{
-					BWAPI::Broodwar->drawLineMap(rangedUnit->getPosition(), rangedUnit->getTargetPosition(), BWAPI::Colors::Purple);
-				}
+				BWAPI::Broodwar->drawLineMap(rangedUnit->getPosition(), rangedUnit->getTargetPosition(), BWAPI::Colors::Purple);
+			}
 
-				// attack it
-				if (Config::Micro::KiteWithRangedUnits)
+			// attack it
+			if (Config::Micro::KiteWithRangedUnits)
+			{
+				if (rangedUnit->getType() == BWAPI::UnitTypes::Zerg_Mutalisk || rangedUnit->getType() == BWAPI::UnitTypes::Terran_Vulture)
 				{
-					if (rangedUnit->getType() == BWAPI::UnitTypes::Zerg_Mutalisk || rangedUnit->getType() == BWAPI::UnitTypes::Terran_Vulture)
-					{
-						Micro::MutaDanceTarget(rangedUnit, target);
-					}
-					else
-					{
-						Micro::SmartKiteTarget(rangedUnit, target);
-					}
+					Micro::MutaDanceTarget(rangedUnit, target);
 				}
 				else
 				{
-					Micro::SmartAttackUnit(rangedUnit, target);
+					Micro::SmartKiteTarget(rangedUnit, target);
 				}
 			}
 			else
 			{
-				// No target found. If we're not near the order position, go there.
-				if (rangedUnit->getDistance(order.getPosition()) > 100)
-				{
-					Micro::SmartAttackMove(rangedUnit, order.getPosition());
-				}
+				Micro::SmartAttackUnit(rangedUnit, target);
+			}
+		}
+		else
+		{
+			// No target found. If we're not near the order position, go there.
+			if (rangedUnit->getDistance(order.getPosition()) > 100)
+			{
+				Micro::SmartAttackMove(rangedUnit, order.getPosition());
 			}
 		}
 	}
 }
 
-// This could return null if no target is worth attacking, but doesn't happen to.
-BWAPI::Unit MicroRanged::getTarget(BWAPI::Unit rangedUnit, const BWAPI::Unitset & targets)
+// Score each fighter-target pair for the target assigner.
+// The parts of the score that depend only on the target are worked out once per target.
+void MicroRanged::scoreTargets()
 {
-	int bestScore = -999999;
-	BWAPI::Unit bestTarget = nullptr;
+	const size_t nTargets = _targetAssigner.getTargetCount();
 
-	for (const auto target : targets)
+	std::vector<int> targetScore(nTargets);
+	std::vector<int> notMovingBonus(nTargets);		// -1 if the target is moving freely
+	for (size_t t = 0; t < nTargets; ++t)
 	{
-		int priority = getAttackPriority(rangedUnit, target);     // 0..12
-		int range    = rangedUnit->getDistance(target);           // 0..map size in pixels
-		int toGoal   = target->getDistance(order.getPosition());  // 0..map size in pixels
+		const BWAPI::Unit target = _targetAssigner.getTargetUnit(t);
 
-		// Let's say that 1 priority step is worth 160 pixels (5 tiles).
-		// We care about unit-target range and target-order position distance.
-		int score = 5 * 32 * priority - range - toGoal/2;
+		// We care about the target-order position distance.
+		int score = -target->getDistance(order.getPosition()) / 2;
 
-		// Adjust for special features.
-		// This could adjust for relative speed and direction, so that we don't chase what we can't catch.
-		if (rangedUnit->isInWeaponRange(target))
+		// Prefer targets that are already hurt.
+		if (target->getType().getRace() == BWAPI::Races::Protoss && target->getShields() == 0)
 		{
-			score += 4 * 32;
+			score += 32;
 		}
-		else if (!target->isMoving())
+		if (target->getHitPoints() < target->getType().maxHitPoints())
+		{
+			score += 24;
+		}
+		targetScore[t] = score;
+
+		if (!target->isMoving())
 		{
 			if (target->isSieged() ||
 				target->getOrder() == BWAPI::Orders::Sieging ||
 				target->getOrder() == BWAPI::Orders::Unsieging)
 			{
-				score += 48;
+				notMovingBonus[t] = 48;
 			}
 			else
 			{
-				score += 24;
+				notMovingBonus[t] = 24;
 			}
 		}
 		else if (target->isBraking())
 		{
-			score += 16;
+			notMovingBonus[t] = 16;
 		}
-		else if (target->getType().topSpeed() >= rangedUnit->getType().topSpeed())
+		else
 		{
-			score -= 5 * 32;
-		}
-		
-		// Prefer targets that are already hurt.
-		if (target->getType().getRace() == BWAPI::Races::Protoss && target->getShields() == 0)
-		{
-			score += 32;
-		}
-		if (target->getHitPoints() < target->getType().maxHitPoints())
-		{
-			score += 24;
+			notMovingBonus[t] = -1;
 		}
+	}
 
-		BWAPI::DamageType damage = UnitUtil::GetWeapon(rangedUnit, target).damageType();
-		if (damage == BWAPI::DamageTypes::Explosive)
+	for (size_t a = 0; a < _targetAssigner.getAttackerCount(); ++a)
+	{
+		const BWAPI::Unit rangedUnit = _targetAssigner.getAttacker(a);
+		const double speed = rangedUnit->getType().topSpeed();
+
+		for (size_t t = 0; t < nTargets; ++t)
 		{
-			if (target->getType().size() == BWAPI::UnitSizeTypes::Large)
+			const BWAPI::Unit target = _targetAssigner.getTargetUnit(t);
+
+			int priority = getAttackPriority(rangedUnit, target);	// 0..12
+			int range = _targetAssigner.getDistance(a, t);			// 0..map size in pixels
+
+			// Let's say that 1 priority step is worth 160 pixels (5 tiles).
+			// We care about unit-target range and target-order position distance.
+			int score = 5 * 32 * priority - range + targetScore[t];
+
+			// Adjust for special features.
+			// This could adjust for relative speed and direction, so that we don't chase what we can't catch.
+			if (_targetAssigner.isInWeaponRange(a, t))
 			{
-				score += 32;
+				score += 4 * 32;
 			}
-		}
-		else if (damage == BWAPI::DamageTypes::Concussive)
-		{
-			if (target->getType().size() == BWAPI::UnitSizeTypes::Small)
+			else if (notMovingBonus[t] >= 0)
 			{
-				score += 32;
+				score += notMovingBonus[t];
+			}
+			else if (target->getType().topSpeed() >= speed)
+			{
+				score -= 5 * 32;
 			}
-		}
 
-		if (score > bestScore)
-		{
-			bestScore = score;
-			bestTarget = target;
+			BWAPI::DamageType damage = UnitUtil::GetWeapon(rangedUnit, target).damageType();
+			if (damage == BWAPI::DamageTypes::Explosive)
+			{
+				if (target->getType().size() == BWAPI::UnitSizeTypes::Large)
+				{
+					score += 32;
+				}
+			}
+			else if (damage == BWAPI::DamageTypes::Concussive)
+			{
+				if (target->getType().size() == BWAPI::UnitSizeTypes::Small)
+				{
+					score += 32;
+				}
+			}
+
+			_targetAssigner.setScore(a, t, score);
 		}
 	}
-	
-	return bestTarget;
 }
 
 // get the attack priority of a target unit
@@ -2,11 +2,16 @@
 
 #include <Common.h>
 #include "MicroManager.h"
+#include "TargetAssigner.h"
 
 namespace UAlbertaBot
 {
 class MicroRanged : public MicroManager
 {
+	TargetAssigner _targetAssigner;
+
+	void scoreTargets();
+
 public:
 
 	MicroRanged();
@@ -15,7 +20,6 @@ public:
 	BWAPI::Unit chooseTarget(BWAPI::Unit rangedUnit, const BWAPI::Unitset & targets, std::map<BWAPI::Unit, int> & numTargeting);
 
 	int getAttackPriority(BWAPI::Unit rangedUnit, BWAPI::Unit target);
-	BWAPI::Unit getTarget(BWAPI::Unit rangedUnit, const BWAPI::Unitset & targets);
 
     void assignTargets(const BWAPI::Unitset & targets);
 
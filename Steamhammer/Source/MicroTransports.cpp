@@ -1,5 +1,7 @@
 #include "MicroTransports.h"
 #include "MapTools.h"
+#include "PathPlanner.h"
+#include "ThreatGrid.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
@@ -171,13 +173,15 @@ void MicroTransports::loadTroops()
 // Only called when the transport exists and is loaded.
 void MicroTransports::unloadTroops()
 {
-	// Unload if we're close to the destination, or if we're scary low on hit points.
+	// Unload if we're close to the destination, or if we're scary low on hit points,
+	// or if enemy anti-air here could shoot us down within about 2 seconds.
 	// It's possible that we'll land on a cliff and the units will be stuck there.
 	const int transportHP = _transportShip->getHitPoints() + _transportShip->getShields();
+	const bool deadlyAntiAir = 2 * ThreatGrid::Instance().getAirThreat(_transportShip->getPosition()) >= transportHP;
 	
 	const BWTA::BaseLocation * enemyBaseLocation = InformationManager::Instance().getEnemyMainBaseLocation();
 
-	if ((transportHP < 50 || (enemyBaseLocation && _transportShip->getDistance(enemyBaseLocation->getPosition()) < 300)) &&
+	if ((transportHP < 50 || deadlyAntiAir || (enemyBaseLocation && _transportShip->getDistance(enemyBaseLocation->getPosition()) < 300)) &&
 		_transportShip->canUnloadAtPosition(_transportShip->getPosition()))
 	{
 		// get the unit's current command
@@ -204,6 +208,18 @@ void MicroTransports::moveTransport()
 		return;
 	}
 
+	// While loaded, take a route to the drop target that stays out of known enemy anti-air.
+	// If no route can be planned (yet), fall back on sneaking along the map edge.
+	const BWAPI::Position target = order.getPosition();
+	if (_transportShip->getLoadedUnits().size() > 0 &&
+		target.isValid() &&
+		PathPlanner::Instance().getRoute(_transportShip->getPosition(), target, true, true))
+	{
+		PathPlanner::Instance().drawRoute(_transportShip->getPosition(), target, true, true);
+		Micro::SmartMove(_transportShip, PathPlanner::Instance().getNextWaypoint(_transportShip->getPosition(), target, true, true));
+		return;
+	}
+
 	if (_to.isValid() && _from.isValid())
 	{
 		followPerimeter(_to, _from);
@@ -393,9 +409,13 @@ BWAPI::Position MicroTransports::getFleePosition(int clockwise)
 		double distanceFromCurrentVertex = _mapEdgeVertices[_currentRegionVertexIndex].getDistance(_transportShip->getPosition());
 
 		// keep going to the next vertex in the perimeter until we get to one we're far enough from to issue another move command
-		while (distanceFromCurrentVertex < 128*2)
+		// and that is out of reach of enemy anti-air (unless every vertex is in reach)
+		size_t skipped = 0;
+		while (distanceFromCurrentVertex < 128*2 ||
+			(skipped < _mapEdgeVertices.size() && ThreatGrid::Instance().getAirThreat(_mapEdgeVertices[_currentRegionVertexIndex]) > 0))
 		{
 			_currentRegionVertexIndex = (_currentRegionVertexIndex + clockwise*1) % _mapEdgeVertices.size();
+			++skipped;
 
 			distanceFromCurrentVertex = _mapEdgeVertices[_currentRegionVertexIndex].getDistance(_transportShip->getPosition());
 		}
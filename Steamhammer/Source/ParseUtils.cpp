@@ -1,9 +1,11 @@
 #include "ParseUtils.h"
 #include "JSONTools.h"
 #include "BuildOrder.h"
+#include "FAP.h"
 #include "Random.h"
 #include "StrategyManager.h"
 
+#include <fstream>
 #include <regex>
 
 using namespace UAlbertaBot;
@@ -78,6 +80,12 @@ void ParseUtils::ParseConfigFile(const std::string & filename)
 		Config::Micro::CombatRegroupRadius = GetIntByRace("RegroupRadius", micro);
 		Config::Micro::UnitNearEnemyRadius = GetIntByRace("UnitNearEnemyRadius", micro);
 		Config::Micro::ScoutDefenseRadius = GetIntByRace("ScoutDefenseRadius", micro);
+		JSONTools::ReadBool("CombatSimFixedPoint", micro, Config::Micro::CombatSimFixedPoint);
+		JSONTools::ReadBool("CombatSimAdaptive", micro, Config::Micro::CombatSimAdaptive);
+		JSONTools::ReadInt("CombatSimMaxFrames", micro, Config::Micro::CombatSimMaxFrames);
+		JSONTools::ReadInt("CombatSimDecisivePercent", micro, Config::Micro::CombatSimDecisivePercent);
+		JSONTools::ReadInt("SquadUpdateInterval", micro, Config::Micro::SquadUpdateInterval);
+		JSONTools::ReadInt("SquadUpdateBudgetMs", micro, Config::Micro::SquadUpdateBudgetMs);
 
         if (micro.HasMember("KiteLongerRangedUnits") && micro["KiteLongerRangedUnits"].IsArray())
         {
@@ -143,6 +151,10 @@ void ParseUtils::ParseConfigFile(const std::string & filename)
 		JSONTools::ReadBool("DrawUnitOrders", debug, Config::Debug::DrawUnitOrders);
 		JSONTools::ReadBool("DrawReservedBuildingTiles", debug, Config::Debug::DrawReservedBuildingTiles);
         JSONTools::ReadBool("DrawBOSSStateInfo", debug, Config::Debug::DrawBOSSStateInfo); 
+		JSONTools::ReadBool("DrawThreatGrid", debug, Config::Debug::DrawThreatGrid);
+		JSONTools::ReadBool("DrawMapAnalysis", debug, Config::Debug::DrawMapAnalysis);
+		JSONTools::ReadBool("DrawBaseLayout", debug, Config::Debug::DrawBaseLayout);
+		JSONTools::ReadBool("TraceCombatSim", debug, Config::Debug::TraceCombatSim);
     }
 
     // Parse the Tool Options
@@ -318,6 +330,12 @@ void ParseUtils::ParseTextCommand(const std::string & commandString)
         else if (variableName == "workersdefendrush") { Config::Micro::WorkersDefendRush = GetBoolFromString(val); }
         else if (variableName == "regroupradius") { Config::Micro::CombatRegroupRadius = GetIntFromString(val); }
         else if (variableName == "unitnearenemyradius") { Config::Micro::UnitNearEnemyRadius = GetIntFromString(val); }
+		else if (variableName == "combatsimfixedpoint") { Config::Micro::CombatSimFixedPoint = GetBoolFromString(val); }
+		else if (variableName == "combatsimadaptive") { Config::Micro::CombatSimAdaptive = GetBoolFromString(val); }
+		else if (variableName == "combatsimmaxframes") { Config::Micro::CombatSimMaxFrames = GetIntFromString(val); }
+		else if (variableName == "combatsimdecisivepercent") { Config::Micro::CombatSimDecisivePercent = GetIntFromString(val); }
+		else if (variableName == "squadupdateinterval") { Config::Micro::SquadUpdateInterval = GetIntFromString(val); }
+		else if (variableName == "squadupdatebudgetms") { Config::Micro::SquadUpdateBudgetMs = GetIntFromString(val); }
 
         // Macro Options
         else if (variableName == "buildingspacing") { Config::Macro::BuildingSpacing = GetIntFromString(val); }
@@ -332,6 +350,7 @@ void ParseUtils::ParseTextCommand(const std::string & commandString)
         else if (variableName == "drawmoduletimers") { Config::Debug::DrawModuleTimers = GetBoolFromString(val); }
         else if (variableName == "drawresourceinfo") { Config::Debug::DrawResourceInfo = GetBoolFromString(val); }
         else if (variableName == "drawcombatsiminfo") { Config::Debug::DrawCombatSimulationInfo = GetBoolFromString(val); }
+		else if (variableName == "tracecombatsim") { Config::Debug::TraceCombatSim = GetBoolFromString(val); }
         else if (variableName == "drawunittargetinfo") { Config::Debug::DrawUnitTargetInfo = GetBoolFromString(val); }
         else if (variableName == "drawbwtainfo") { Config::Debug::DrawBWTAInfo = GetBoolFromString(val); }
         else if (variableName == "drawmapgrid") { Config::Debug::DrawMapGrid = GetBoolFromString(val); }
@@ -344,6 +363,18 @@ void ParseUtils::ParseTextCommand(const std::string & commandString)
 
         else { UAB_ASSERT_WARNING(false, "Unknown variable name for /set: %s", variableName.c_str()); }
     }
+    else if (command == "/benchmark")
+    {
+        // Combat simulation target search: where the target index starts to pay off.
+        if (variableName == "fap")
+        {
+            BWAPI::Player enemy = BWAPI::Broodwar->enemy() ? BWAPI::Broodwar->enemy() : BWAPI::Broodwar->self();
+            std::ofstream outFile(Config::IO::WriteDir + "FAPBenchmark.txt");
+            const int crossover = FastAPproximation::benchmarkTargetSearch(BWAPI::Broodwar->self(), enemy, outFile);
+            BWAPI::Broodwar->printf("FAP target index pays from %d units", crossover);
+        }
+        else { UAB_ASSERT_WARNING(false, "Unknown benchmark: %s", variableName.c_str()); }
+    }
     else
     {
         UAB_ASSERT_WARNING(false, "Unknown command: %s", command.c_str());
@@ -0,0 +1,442 @@
+#include <climits>
+
+#include "PathPlanner.h"
+
+#include "MapAnalysis.h"
+#include "MapTools.h"
+#include "ThreatGrid.h"
+
+using namespace UAlbertaBot;
+
+// Step costs, in tenths of a tile.
+const int StraightCost = 10;
+const int DiagonalCost = 14;
+
+// When a route is to be safe, each step costs extra in proportion to the threat on the tile.
+// A threat of ThreatScale damage per second doubles the cost of the step.
+const int ThreatScale = 10;
+
+const int MaxNodesPerFrame = 30000;		// A* expansions allowed per frame, for all searches together
+const size_t MaxLandmarks = 3;			// distance maps used for the heuristic
+const size_t MaxRoutes = 100;			// clear the route cache when it grows past this
+const int SafeRouteLifetime = 4 * 24;	// safe routes go stale as the threats move
+const int AbandonSearchFrames = 24;		// drop a suspended search if its route is not asked for this long
+const int BlockSize = 8;				// tiles outside regions are grouped in blocks this many tiles across
+const int MaxWaypointSpacing = 8;		// tiles between waypoints on straight stretches
+const int WaypointReach = 3 * 32;		// pixels; closer than this, head for the next waypoint
+
+PathPlanner & PathPlanner::Instance()
+{
+	static PathPlanner instance;
+	return instance;
+}
+
+PathPlanner::PathPlanner()
+	: _rows(BWAPI::Broodwar->mapHeight())
+	, _cols(BWAPI::Broodwar->mapWidth())
+	, _g(_rows * _cols, 0)
+	, _parent(_rows * _cols, -1)
+	, _stamp(_rows * _cols, 0)
+	, _closed(_rows * _cols, false)
+	, _searchStamp(0)
+	, _budgetFrame(-1)
+	, _nodesLeft(MaxNodesPerFrame)
+{
+	_search.active = false;
+	_search.lastAsked = -1;
+}
+
+PathPlanner::RouteKey PathPlanner::makeKey(const BWAPI::TilePosition & from, const BWAPI::TilePosition & to, bool air, bool safe) const
+{
+	const int blockCols = (_cols + BlockSize - 1) / BlockSize;
+
+	RouteKey key;
+	key.fromRegion = MapAnalysis::Instance().getRegionID(from);
+	key.toRegion = MapAnalysis::Instance().getRegionID(to);
+	key.fromBlock = key.fromRegion >= 0 ? -1 : (from.y / BlockSize) * blockCols + from.x / BlockSize;
+	key.toBlock = key.toRegion >= 0 ? -1 : (to.y / BlockSize) * blockCols + to.x / BlockSize;
+	key.air = air;
+	key.safe = safe;
+	return key;
+}
+
+bool PathPlanner::passable(int x, int y, bool air) const
+{
+	if (x < 0 || x >= _cols || y < 0 || y >= _rows)
+	{
+		return false;
+	}
+	return air || MapTools::Instance().isWalkable(BWAPI::TilePosition(x, y));
+}
+
+int PathPlanner::stepCost(int x, int y, int length, bool air, bool safe) const
+{
+	if (!safe)
+	{
+		return length;
+	}
+	const int threat = ThreatGrid::Instance().getThreat(BWAPI::Position(x * 32 + 16, y * 32 + 16), air);
+	return length + length * threat / ThreatScale;
+}
+
+// Pick cached distance maps to serve as landmarks for the heuristic.
+// A map measured from the goal tile itself is the best, so it goes first.
+void PathPlanner::chooseLandmarks(const BWAPI::TilePosition & goal)
+{
+	_search.landmarks.clear();
+	MapTools::Instance().getCachedDistanceMaps(_distanceMaps);
+
+	const int goalIndex = getIndex(goal.y, goal.x);
+
+	for (const auto & map : _distanceMaps)
+	{
+		if (map.first == goal)
+		{
+			_search.landmarks.push_back(std::pair<const DistanceMap *, int>(map.second, 0));
+			break;
+		}
+	}
+
+	for (const auto & map : _distanceMaps)
+	{
+		if (_search.landmarks.size() >= MaxLandmarks)
+		{
+			break;
+		}
+		const int goalDistance = map.second->getDistance(goalIndex);
+		if (map.first != goal && goalDistance >= 0)
+		{
+			_search.landmarks.push_back(std::pair<const DistanceMap *, int>(map.second, goalDistance));
+		}
+	}
+}
+
+// Octile distance, improved by the landmarks if any.
+// A landmark map gives 4-connected step counts d, and by the triangle inequality
+// |d(landmark, goal) - d(landmark, tile)| steps is a lower bound on the trip.
+// One 8-connected move covers at most 2 of those steps for a cost of 14, so 7 per step is admissible.
+int PathPlanner::heuristic(int x, int y, const BWAPI::TilePosition & goal) const
+{
+	const int dx = std::abs(x - goal.x);
+	const int dy = std::abs(y - goal.y);
+	int h = StraightCost * std::max(dx, dy) + (DiagonalCost - StraightCost) * std::min(dx, dy);
+
+	const int index = getIndex(y, x);
+	for (const auto & landmark : _search.landmarks)
+	{
+		const int d = landmark.first->getDistance(index);
+		if (d >= 0)
+		{
+			h = std::max(h, (DiagonalCost / 2) * std::abs(landmark.second - d));
+		}
+	}
+
+	return h;
+}
+
+// Begin a new A* search from start to goal, taking over the search state.
+void PathPlanner::startSearch(const RouteKey & key, const BWAPI::TilePosition & start, const BWAPI::TilePosition & goal, int now)
+{
+	++_searchStamp;
+	const int startIndex = getIndex(start.y, start.x);
+
+	_search.active = true;
+	_search.key = key;
+	_search.start = start;
+	_search.goal = goal;
+	_search.lastAsked = now;
+	_search.open = std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>>();
+	_search.landmarkCopies.clear();
+	if (key.air)
+	{
+		_search.landmarks.clear();		// the distance maps are for ground units
+	}
+	else
+	{
+		chooseLandmarks(goal);
+	}
+
+	_stamp[startIndex] = _searchStamp;
+	_closed[startIndex] = false;
+	_g[startIndex] = 0;
+	_parent[startIndex] = -1;
+	_search.open.push(OpenEntry(0, startIndex));
+}
+
+// The search is being suspended. Copy its landmark maps, unless that's done already.
+void PathPlanner::keepLandmarks()
+{
+	if (!_search.landmarkCopies.empty() || _search.landmarks.empty())
+	{
+		return;
+	}
+
+	// Reserve first, so that the pointers into the copies stay good.
+	_search.landmarkCopies.reserve(_search.landmarks.size());
+	for (auto & landmark : _search.landmarks)
+	{
+		_search.landmarkCopies.push_back(*landmark.first);
+		landmark.first = &_search.landmarkCopies.back();
+	}
+}
+
+// Run the search in progress. Return false if the frame's budget ran out before it finished;
+// the open list and the tile state stay as they are, so the search can go on later.
+// If the search finished and there is no path, the waypoints are empty.
+// The start and goal tiles are always allowed, so that units standing at the edge of
+// unwalkable terrain still get a route.
+bool PathPlanner::search(std::vector<BWAPI::Position> & waypoints)
+{
+	static const int dxs[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+	static const int dys[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+	const BWAPI::TilePosition & goal = _search.goal;
+	const bool air = _search.key.air;
+	const bool safe = _search.key.safe;
+	auto & open = _search.open;
+
+	waypoints.clear();
+
+	const int goalIndex = getIndex(goal.y, goal.x);
+
+	while (!open.empty())
+	{
+		if (_nodesLeft <= 0)
+		{
+			keepLandmarks();
+			return false;
+		}
+
+		const int current = open.top().second;
+		open.pop();
+		if (_closed[current])
+		{
+			continue;
+		}
+		_closed[current] = true;
+		--_nodesLeft;
+
+		if (current == goalIndex)
+		{
+			makeWaypoints(goalIndex, waypoints);
+			return true;
+		}
+
+		const int x = current % _cols;
+		const int y = current / _cols;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			const int nx = x + dxs[i];
+			const int ny = y + dys[i];
+			if (nx < 0 || nx >= _cols || ny < 0 || ny >= _rows)
+			{
+				continue;
+			}
+
+			const int next = getIndex(ny, nx);
+			if (next != goalIndex && !passable(nx, ny, air))
+			{
+				continue;
+			}
+
+			// Don't cut corners of unwalkable terrain.
+			const bool diagonal = dxs[i] != 0 && dys[i] != 0;
+			if (diagonal && (!passable(nx, y, air) || !passable(x, ny, air)))
+			{
+				continue;
+			}
+
+			const int g = _g[current] + stepCost(nx, ny, diagonal ? DiagonalCost : StraightCost, air, safe);
+
+			if (_stamp[next] != _searchStamp)
+			{
+				_stamp[next] = _searchStamp;
+				_closed[next] = false;
+			}
+			else if (_closed[next] || g >= _g[next])
+			{
+				continue;
+			}
+
+			_g[next] = g;
+			_parent[next] = current;
+			open.push(OpenEntry(g + heuristic(nx, ny, goal), next));
+		}
+	}
+
+	// No path.
+	return true;
+}
+
+// Turn the tile path that ends at the goal into waypoints. Keep the tiles where the path
+// changes direction, plus enough tiles on long straight stretches.
+void PathPlanner::makeWaypoints(int goalIndex, std::vector<BWAPI::Position> & waypoints) const
+{
+	std::vector<int> tiles;
+	for (int index = goalIndex; index != -1; index = _parent[index])
+	{
+		tiles.push_back(index);
+	}
+	std::reverse(tiles.begin(), tiles.end());
+
+	int sinceLast = 0;
+	for (size_t i = 1; i < tiles.size(); ++i)
+	{
+		++sinceLast;
+		bool keep = i + 1 == tiles.size() || sinceLast >= MaxWaypointSpacing;
+		if (!keep)
+		{
+			const int step = tiles[i] - tiles[i - 1];
+			const int nextStep = tiles[i + 1] - tiles[i];
+			keep = step != nextStep;
+		}
+		if (keep)
+		{
+			waypoints.push_back(BWAPI::Position(32 * (tiles[i] % _cols) + 16, 32 * (tiles[i] / _cols) + 16));
+			sinceLast = 0;
+		}
+	}
+}
+
+bool PathPlanner::isFresh(const RouteKey & key, int now) const
+{
+	auto it = _routes.find(key);
+	return it != _routes.end() && (!key.safe || now - it->second.frame < SafeRouteLifetime);
+}
+
+// Spend what is left of this frame's budget on the search in progress, if any.
+// When it finishes, cache its route.
+void PathPlanner::continueSearch(int now)
+{
+	if (!_search.active)
+	{
+		return;
+	}
+
+	std::vector<BWAPI::Position> waypoints;
+	if (search(waypoints))
+	{
+		_search.active = false;
+		_search.open = std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>>();
+		_search.landmarks.clear();
+		_search.landmarkCopies.clear();
+
+		if (_routes.size() >= MaxRoutes)
+		{
+			_routes.clear();
+		}
+		Route & route = _routes[_search.key];
+		route.waypoints = waypoints;
+		route.frame = now;
+	}
+}
+
+// The route between the two positions, or null if there is none (or none yet, because the
+// search budget for this frame is spent). The route may have been planned for a different
+// trip between the same regions; getNextWaypoint() copes with that.
+const std::vector<BWAPI::Position> * PathPlanner::getRoute(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe)
+{
+	if (!from.isValid() || !to.isValid())
+	{
+		return nullptr;
+	}
+
+	const int now = BWAPI::Broodwar->getFrameCount();
+	if (_budgetFrame != now)
+	{
+		_budgetFrame = now;
+		_nodesLeft = MaxNodesPerFrame;
+	}
+
+	const BWAPI::TilePosition fromTile(from);
+	const BWAPI::TilePosition toTile(to);
+	const RouteKey key = makeKey(fromTile, toTile, air, safe);
+
+	if (!isFresh(key, now))
+	{
+		const bool ours = _search.active && !(_search.key < key) && !(key < _search.key);
+		if (ours)
+		{
+			_search.lastAsked = now;
+		}
+		else if (_search.active && now - _search.lastAsked > AbandonSearchFrames)
+		{
+			_search.active = false;		// nobody wants that route any more
+		}
+
+		// The search in progress finishes first, whoever is asking, so that it is never starved.
+		continueSearch(now);
+
+		if (!_search.active && !isFresh(key, now))
+		{
+			startSearch(key, fromTile, toTile, now);
+			continueSearch(now);
+		}
+		// If the search is not done, it is out of budget. A stale route, if any, is better than nothing.
+	}
+
+	auto it = _routes.find(key);
+	if (it == _routes.end() || it->second.waypoints.empty())
+	{
+		return nullptr;
+	}
+	return &it->second.waypoints;
+}
+
+// Where a unit at from should move next to follow the route to to.
+// If there is no route, that's to itself, which leaves the pathing to the game engine.
+BWAPI::Position PathPlanner::getNextWaypoint(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe)
+{
+	const std::vector<BWAPI::Position> * route = getRoute(from, to, air, safe);
+	if (!route)
+	{
+		return to;
+	}
+
+	// Pick up the route at the closest waypoint. Move on if it is already reached.
+	size_t closest = 0;
+	int closestDistance = INT_MAX;
+	for (size_t i = 0; i < route->size(); ++i)
+	{
+		const int dist = from.getApproxDistance((*route)[i]);
+		if (dist < closestDistance)
+		{
+			closest = i;
+			closestDistance = dist;
+		}
+	}
+
+	for (size_t i = closest; i + 1 < route->size(); ++i)
+	{
+		if (from.getApproxDistance((*route)[i]) >= WaypointReach)
+		{
+			return (*route)[i];
+		}
+	}
+
+	// The last waypoint is in the goal region, but the route may have been planned for another goal there.
+	return to;
+}
+
+void PathPlanner::drawRoute(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe)
+{
+	if (!Config::Debug::DrawUnitTargetInfo)
+	{
+		return;
+	}
+
+	const std::vector<BWAPI::Position> * route = getRoute(from, to, air, safe);
+	if (!route)
+	{
+		return;
+	}
+
+	BWAPI::Position previous = from;
+	for (const BWAPI::Position & waypoint : *route)
+	{
+		BWAPI::Broodwar->drawLineMap(previous, waypoint, BWAPI::Colors::Yellow);
+		BWAPI::Broodwar->drawCircleMap(waypoint, 3, BWAPI::Colors::Yellow, true);
+		previous = waypoint;
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Common.h"
+#include <queue>
+#include <tuple>
+#include "DistanceMap.hpp"
+
+namespace UAlbertaBot
+{
+
+// A* routes over the build tile grid of MapTools, for ground or air units,
+// optionally steering around enemy fire as recorded in the ThreatGrid.
+// Each step costs its length, plus a penalty for the threat on the tile when asked to be safe.
+// Ground searches use cached MapTools distance maps as admissible heuristics, so that
+// routes to common destinations (like bases) expand few nodes.
+// Finished routes are cached per (from-region, to-region), so many units making the same
+// trip share one search. Searches are limited per frame; when the budget runs out, the
+// search is suspended and the query fails for this frame, so the caller should move directly
+// as before. The suspended search goes on from where it stopped with the next frame's budget,
+// ahead of any new search, so that long searches finish instead of starting over every frame.
+class PathPlanner
+{
+	// Identifies the trip. Tiles outside any region (cliffs, space) fall into coarse blocks.
+	struct RouteKey
+	{
+		int						fromRegion;		// MapAnalysis region ID, -1 if none
+		int						toRegion;
+		int						fromBlock;		// -1 if the tile is in a region
+		int						toBlock;
+		bool					air;
+		bool					safe;
+
+		bool operator<(const RouteKey & other) const
+		{
+			return std::tie(fromRegion, toRegion, fromBlock, toBlock, air, safe) <
+				std::tie(other.fromRegion, other.toRegion, other.fromBlock, other.toBlock, other.air, other.safe);
+		}
+	};
+
+	struct Route
+	{
+		std::vector<BWAPI::Position>	waypoints;		// from start to goal
+		int								frame;			// when it was planned
+	};
+
+	typedef std::pair<int, int> OpenEntry;				// f value, tile index
+
+	// The search in progress. It owns the search state below until it finishes or is abandoned.
+	struct Search
+	{
+		bool					active;
+		RouteKey				key;
+		BWAPI::TilePosition		start;
+		BWAPI::TilePosition		goal;
+		int						lastAsked;		// last frame its route was asked for
+		std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+
+		// Landmarks for the heuristic: distance maps and the distance from each to the goal.
+		// They stay the same for the whole search, so that the f values on the open list agree.
+		// If the search is suspended, the maps are copied, because MapTools may drop its cache.
+		std::vector< std::pair<const DistanceMap *, int> >	landmarks;
+		std::vector<DistanceMap>							landmarkCopies;
+	};
+
+	int							_rows;
+	int							_cols;
+
+	// Search state, reused between searches. A tile belongs to the current search only
+	// if its stamp matches _searchStamp, so nothing has to be cleared between searches.
+	std::vector<int>			_g;
+	std::vector<int>			_parent;
+	std::vector<int>			_stamp;
+	std::vector<bool>			_closed;
+	int							_searchStamp;
+
+	// The MapTools distance maps, candidates for landmarks.
+	std::vector< std::pair<BWAPI::TilePosition, const DistanceMap *> >	_distanceMaps;
+
+	std::map<RouteKey, Route>	_routes;
+	Search						_search;
+
+	int							_budgetFrame;	// frame the budget was last reset
+	int							_nodesLeft;		// expansions left in this frame's budget
+
+	PathPlanner();
+
+	int			getIndex(int row, int col) const { return row * _cols + col; }
+	RouteKey	makeKey(const BWAPI::TilePosition & from, const BWAPI::TilePosition & to, bool air, bool safe) const;
+	bool		passable(int x, int y, bool air) const;
+	int			stepCost(int x, int y, int length, bool air, bool safe) const;
+	void		chooseLandmarks(const BWAPI::TilePosition & goal);
+	int			heuristic(int x, int y, const BWAPI::TilePosition & goal) const;
+	void		startSearch(const RouteKey & key, const BWAPI::TilePosition & start, const BWAPI::TilePosition & goal, int now);
+	bool		search(std::vector<BWAPI::Position> & waypoints);
+	void		keepLandmarks();
+	void		continueSearch(int now);
+	bool		isFresh(const RouteKey & key, int now) const;
+	void		makeWaypoints(int goalIndex, std::vector<BWAPI::Position> & waypoints) const;
+
+public:
+
+	static PathPlanner &	Instance();
+
+	const std::vector<BWAPI::Position> *	getRoute(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe);
+	BWAPI::Position							getNextWaypoint(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe);
+
+	void									drawRoute(const BWAPI::Position & from, const BWAPI::Position & to, bool air, bool safe);
+};
+
+}
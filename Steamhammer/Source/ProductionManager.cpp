@@ -14,6 +14,9 @@ ProductionManager::ProductionManager()
 	, _extractorTrickState			     (ExtractorTrick::None)
 	, _extractorTrickUnitType			 (BWAPI::UnitTypes::None)
 	, _extractorTrickBuilding			 (nullptr)
+	, _spentMinerals					 (0)
+	, _spentGas							 (0)
+	, _spentSupply						 (0)
 {
     setBuildOrder(StrategyManager::Instance().getOpeningBookBuildOrder());
 }
@@ -116,8 +119,12 @@ void ProductionManager::onUnitDestroy(BWAPI::Unit unit)
 	}
 }
 
+// Dispatch as many items from the front of the queue as we can afford this frame.
+// Stop at the first item that can't be made yet, so that the queue order is kept.
 void ProductionManager::manageBuildOrderQueue() 
 {
+	clearLedger();
+
 	// If the extractor trick is in progress, do that.
 	if (_extractorTrickState != ExtractorTrick::None)
 	{
@@ -183,11 +190,11 @@ void ProductionManager::manageBuildOrderQueue()
 			break;
 		}
 
-		// if we can make the current item
-		if (canMake) 
+		// if we can make the current item and the order goes through
+		if (canMake && create(producer, currentItem)) 
 		{
-			// create it
-			create(producer, currentItem);
+			// charge it to this frame's ledger
+			debitLedger(producer, currentItem.macroAct);
 			_assignedWorkerForThisBuilding = nullptr;
 			_haveLocationForThisBuilding = false;
 			_delayBuildingPredictionUntilFrame = 0;
@@ -196,11 +203,8 @@ void ProductionManager::manageBuildOrderQueue()
 			_queue.doneWithHighestPriorityItem();
 			_lastProductionFrame = BWAPI::Broodwar->getFrameCount();
 
-			// don't actually loop around in here
-			// TODO because we don't keep track of resources used,
-			//      we wait until the next frame to build the next thing.
-			//      Can cause delays in late game!
-			break;
+			// The ledger accounts for what we just spent. Go on to the next item.
+			continue;
 		}
 
 		// We didn't make anything. Check for a possible production jam.
@@ -212,8 +216,6 @@ void ProductionManager::manageBuildOrderQueue()
 			goOutOfBook();
 		}
 
-		// TODO not much of a loop, eh? breaks on all branches
-		//      only commands and bug workarounds continue to the next item
 		break;
 	}
 }
@@ -235,6 +237,9 @@ BWAPI::Unit ProductionManager::getProducer(MacroAct t, BWAPI::Position closestTo
 
 		if (producerType != unit->getType()) { continue; }
 
+		// Already given an order this frame, which does not show until next frame.
+		if (_busyProducers.contains(unit)) { continue; }
+
 		// TODO Due to a BWAPI 4.1.2 bug, lair research can't be done in a hive.
 		//      Also spire upgrades can't be done in a greater spire.
 		//      The bug is fixed in the next version, 4.2.0.
@@ -399,19 +404,21 @@ BWAPI::Unit ProductionManager::getClosestLarvaToPosition(BWAPI::Position closest
 }
 
 // Create a unit or start research.
-void ProductionManager::create(BWAPI::Unit producer, const BuildOrderItem & item) 
+// Return whether the order was accepted. If not, nothing was spent.
+bool ProductionManager::create(BWAPI::Unit producer, const BuildOrderItem & item) 
 {
     if (!producer)
     {
-        return;
+        return false;
     }
 
     MacroAct act = item.macroAct;
+	bool ordered = true;
 
 	// If it's a terran add-on.
 	if (act.isUnit() && act.getUnitType().isAddon())
 	{
-		producer->buildAddon(act.getUnitType());
+		ordered = producer->buildAddon(act.getUnitType());
 	}
 	// If it's a building other than an add-on.
 	else if (act.isBuilding()                                    // implies act.isUnit()
@@ -438,6 +445,7 @@ void ProductionManager::create(BWAPI::Unit producer, const BuildOrderItem & item
 		}
 		
 		BuildingManager::Instance().addBuildingTask(act, desiredLocation, item.isGasSteal);
+		return true;
 	}
 	// if we're dealing with a non-building unit, or a morphed zerg building
 	else if (act.isUnit())
@@ -445,27 +453,34 @@ void ProductionManager::create(BWAPI::Unit producer, const BuildOrderItem & item
 		if (act.getUnitType().getRace() == BWAPI::Races::Zerg)
 		{
 			// if the race is zerg, morph the unit
-			producer->morph(act.getUnitType());
+			ordered = producer->morph(act.getUnitType());
 		}
 		else
 		{
 			// if not, train the unit
-			producer->train(act.getUnitType());
+			ordered = producer->train(act.getUnitType());
 		}
 	}
 	// if we're dealing with a tech research
 	else if (act.isTech())
 	{
-		producer->research(act.getTechType());
+		ordered = producer->research(act.getTechType());
 	}
 	else if (act.isUpgrade())
 	{
-		producer->upgrade(act.getUpgradeType());
+		ordered = producer->upgrade(act.getUpgradeType());
 	}
 	else
 	{
 		UAB_ASSERT(false, "Unknown type");
+		return false;
+	}
+
+	if (ordered)
+	{
+		BOSSManager::Instance().onProduce(producer, act);
 	}
+	return ordered;
 }
 
 bool ProductionManager::canMakeNow(BWAPI::Unit producer, MacroAct t)
@@ -477,7 +492,9 @@ bool ProductionManager::canMakeNow(BWAPI::Unit producer, MacroAct t)
 	{
 		if (t.isUnit())
 		{
-			canMake = BWAPI::Broodwar->canMake(t.getUnitType(), producer);
+			canMake =
+				supplyNeeded(producer, t) <= getFreeSupply() &&
+				BWAPI::Broodwar->canMake(t.getUnitType(), producer);
 		}
 		else if (t.isTech())
 		{
@@ -569,14 +586,57 @@ void ProductionManager::predictWorkerMovement(const Building & b)
 	}
 }
 
+void ProductionManager::clearLedger()
+{
+	_spentMinerals = 0;
+	_spentGas = 0;
+	_spentSupply = 0;
+	_busyProducers.clear();
+}
+
+// Record an order given this frame.
+void ProductionManager::debitLedger(BWAPI::Unit producer, const MacroAct & act)
+{
+	// BuildingManager has already reserved the resources for a building it constructs,
+	// and it chooses its own builder.
+	if (act.isBuilding() && !act.getUnitType().isAddon() && !UnitUtil::IsMorphedBuildingType(act.getUnitType()))
+	{
+		return;
+	}
+
+	_busyProducers.insert(producer);
+	_spentMinerals += act.mineralPrice();
+	_spentGas += act.gasPrice();
+	_spentSupply += supplyNeeded(producer, act);
+}
+
+// Supply taken by making the item. A zerg unit morphed from another unit,
+// like a lurker from a hydralisk, only takes the difference.
+// An egg that hatches two units, like zerglings, takes the supply of both.
+int ProductionManager::supplyNeeded(BWAPI::Unit producer, const MacroAct & act) const
+{
+	if (!act.isUnit())
+	{
+		return 0;
+	}
+	const BWAPI::UnitType type = act.getUnitType();
+	const int supply = type.isTwoUnitsInOneEgg() ? 2 * type.supplyRequired() : type.supplyRequired();
+	return std::max(0, supply - producer->getType().supplyRequired());
+}
+
 int ProductionManager::getFreeMinerals() const
 {
-	return BWAPI::Broodwar->self()->minerals() - BuildingManager::Instance().getReservedMinerals();
+	return BWAPI::Broodwar->self()->minerals() - BuildingManager::Instance().getReservedMinerals() - _spentMinerals;
 }
 
 int ProductionManager::getFreeGas() const
 {
-	return BWAPI::Broodwar->self()->gas() - BuildingManager::Instance().getReservedGas();
+	return BWAPI::Broodwar->self()->gas() - BuildingManager::Instance().getReservedGas() - _spentGas;
+}
+
+int ProductionManager::getFreeSupply() const
+{
+	return BWAPI::Broodwar->self()->supplyTotal() - BWAPI::Broodwar->self()->supplyUsed() - _spentSupply;
 }
 
 void ProductionManager::executeCommand(MacroCommand command)
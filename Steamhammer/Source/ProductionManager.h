@@ -27,6 +27,14 @@ class ProductionManager
 	ExtractorTrick		_extractorTrickState;
 	BWAPI::UnitType		_extractorTrickUnitType;         // drone or zergling
 	Building *			_extractorTrickBuilding;         // set depending on the extractor trick state
+
+	// The ledger of this frame's production orders. BWAPI does not show the effect of
+	// an order until the next frame, so we keep track in order to issue more than one.
+	// Buildings are not in the ledger; BuildingManager reserves their resources.
+	int					_spentMinerals;
+	int					_spentGas;
+	int					_spentSupply;
+	BWAPI::Unitset		_busyProducers;                  // given a production order this frame
     
     BWAPI::Unit         getClosestUnitToPosition(const BWAPI::Unitset & units,BWAPI::Position closestTo);
 	BWAPI::Unit         getFarthestUnitFromPosition(const BWAPI::Unitset & units, BWAPI::Position farthest);
@@ -34,13 +42,17 @@ class ProductionManager
 	
 	void				executeCommand(MacroCommand command);
     bool                meetsReservedResources(MacroAct type);
-    void                create(BWAPI::Unit producer,const BuildOrderItem & item);
+    bool                create(BWAPI::Unit producer,const BuildOrderItem & item);
     void                manageBuildOrderQueue();
     bool                canMakeNow(BWAPI::Unit producer,MacroAct t);
+	void				clearLedger();
+	void				debitLedger(BWAPI::Unit producer, const MacroAct & act);
+	int					supplyNeeded(BWAPI::Unit producer, const MacroAct & act) const;
     void                predictWorkerMovement(const Building & b);
 
     int                 getFreeMinerals() const;
     int                 getFreeGas() const;
+	int					getFreeSupply() const;
 
 	void				doExtractorTrick();
 
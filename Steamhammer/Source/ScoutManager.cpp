@@ -1,5 +1,8 @@
 #include "ScoutManager.h"
+#include "MapGrid.h"
+#include "PathPlanner.h"
 #include "ProductionManager.h"
+#include "ThreatGrid.h"
 
 using namespace UAlbertaBot;
 
@@ -185,6 +188,12 @@ void ScoutManager::moveScout()
 	        _scoutUnderAttack = false;
         }
 
+		// If enemy combat units or static defense can shoot here, don't stay to harass.
+		if (ThreatGrid::Instance().getGroundThreat(_workerScout->getPosition()) > 0)
+		{
+			_scoutUnderAttack = true;
+		}
+
 		// if the scout is in the enemy region
 		if (scoutInRangeOfenemy)
 		{
@@ -239,8 +248,9 @@ void ScoutManager::moveScout()
 			// if we haven't explored it yet
 			if (!BWAPI::Broodwar->isExplored(startLocation->getTilePosition())) 
 			{
-				// assign a unit to go scout it
-				Micro::SmartMove(_workerScout, BWAPI::Position(startLocation->getTilePosition()));			
+				// assign a unit to go scout it, by a route that avoids known enemy fire
+				const BWAPI::Position target(startLocation->getTilePosition());
+				Micro::SmartMove(_workerScout, PathPlanner::Instance().getNextWaypoint(_workerScout->getPosition(), target, false, true));			
 				return;
 			}
 		}
@@ -317,10 +327,15 @@ void ScoutManager::gasSteal()
 }
 
 // Choose an enemy worker to harass, or none.
+// Only enemies within reach are looked at, using the map grid rather than scanning all enemy units.
 BWAPI::Unit ScoutManager::enemyWorkerToHarass() const
 {
-	// First look for any enemy worker that is building.
-	for (const auto unit : BWAPI::Broodwar->enemy()->getUnits())
+	int maxDist = 600;    // ignore any beyond this range
+
+	// First look for an enemy worker nearby that is building.
+	BWAPI::Unitset nearby;
+	MapGrid::Instance().GetUnits(nearby, _workerScout->getPosition(), maxDist, false, true);
+	for (const auto unit : nearby)
 	{
 		if (unit->getType().isWorker() && unit->isConstructing())
 		{
@@ -329,12 +344,17 @@ BWAPI::Unit ScoutManager::enemyWorkerToHarass() const
 	}
 
 	BWAPI::Unit enemyWorker = nullptr;
-	int maxDist = 600;    // ignore any beyond this range
 
 	BWAPI::Unit geyser = getEnemyGeyser();
+	if (!geyser)
+	{
+		return nullptr;
+	}
 
 	// Failing that, find the enemy worker closest to the gas.
-	for (const auto unit : BWAPI::Broodwar->enemy()->getUnits())
+	BWAPI::Unitset nearGas;
+	MapGrid::Instance().GetUnits(nearGas, geyser->getInitialPosition(), maxDist, false, true);
+	for (const auto unit : nearGas)
 	{
 		if (unit->getType().isWorker())
 		{
@@ -368,9 +388,11 @@ BWAPI::Unit ScoutManager::getEnemyGeyser() const
 
 bool ScoutManager::enemyWorkerInRadius()
 {
-	for (const auto unit : BWAPI::Broodwar->enemy()->getUnits())
+	BWAPI::Unitset nearby;
+	MapGrid::Instance().GetUnits(nearby, _workerScout->getPosition(), 300, false, true);
+	for (const auto unit : nearby)
 	{
-		if (unit->getType().isWorker() && (unit->getDistance(_workerScout) < 300))
+		if (unit->getType().isWorker())
 		{
 			return true;
 		}
@@ -425,9 +447,13 @@ BWAPI::Position ScoutManager::getFleePosition()
     double distanceFromCurrentVertex = _enemyRegionVertices[_currentRegionVertexIndex].getDistance(_workerScout->getPosition());
 
     // keep going to the next vertex in the perimeter until we get to one we're far enough from to issue another move command
-    while (distanceFromCurrentVertex < 128)
+	// and that is out of reach of enemy defenses (unless every vertex is in reach)
+	size_t skipped = 0;
+    while (distanceFromCurrentVertex < 128 ||
+		(skipped < _enemyRegionVertices.size() && ThreatGrid::Instance().getGroundThreat(_enemyRegionVertices[_currentRegionVertexIndex]) > 0))
     {
         _currentRegionVertexIndex = (_currentRegionVertexIndex + 1) % _enemyRegionVertices.size();
+		++skipped;
 
         distanceFromCurrentVertex = _enemyRegionVertices[_currentRegionVertexIndex].getDistance(_workerScout->getPosition());
     }
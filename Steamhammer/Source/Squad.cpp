@@ -1,5 +1,6 @@
 #include "Squad.h"
 #include "UnitUtil.h"
+#include "../../BOSS/source/Timer.hpp"
 
 using namespace UAlbertaBot;
 
@@ -13,7 +14,14 @@ Squad::Squad()
 	, _attackAtMax(false)
     , _lastRetreatSwitch(0)
     , _lastRetreatSwitchVal(false)
+	, _combatSim(-1)
+	, _regroupNoSim(false)
     , _priority(0)
+	, _lastUpdateFrame(-1)
+	, _lastFrontUpdate(-1)
+	, _updateMs(0.0)
+	, _changed(true)
+	, _inCombat(false)
 {
     int a = 10;   // only you can prevent linker errors
 }
@@ -32,7 +40,14 @@ Squad::Squad(const std::string & name, SquadOrder order, size_t priority)
 	, _attackAtMax(false)
 	, _lastRetreatSwitch(0)
     , _lastRetreatSwitchVal(false)
+	, _combatSim(-1)
+	, _regroupNoSim(false)
     , _priority(priority)
+	, _lastUpdateFrame(-1)
+	, _lastFrontUpdate(-1)
+	, _updateMs(0.0)
+	, _changed(true)
+	, _inCombat(false)
 	, _order(order)
 {
 }
@@ -42,17 +57,75 @@ Squad::~Squad()
     clear();
 }
 
-// TODO make a proper dispatch system for different orders
-void Squad::update()
+// The first half of the squad's update, done for all squads before any does the second half.
+// Update the unit information, and if the squad needs a combat sim to decide whether to
+// regroup, set it up so that it can run with the others.
+void Squad::prepareUpdate(CombatSimulationBatch & sims)
 {
+	BOSS::Timer timer;
+	timer.start();
+
+	_lastUpdateFrame = BWAPI::Broodwar->getFrameCount();
+	_changed = false;
+
 	// update all necessary unit information within this squad
 	updateUnits();
 
+	startRegroupCheck(sims);
+
+	_updateMs = timer.getElapsedTimeInMilliSec();
+}
+
+// On frames when the squad does not update, still drop dead units so that
+// other code sees an accurate unit set.
+// Also notice at once if the enemy has come near, so that the squad goes over to
+// updating every frame without waiting for its next scheduled update.
+void Squad::refreshUnits()
+{
+	setAllUnits();
+
+	if (!_inCombat)
+	{
+		for (const auto unit : _units)
+		{
+			if (unit->getPosition().isValid() && unitNearEnemy(unit))
+			{
+				_inCombat = true;
+				break;
+			}
+		}
+	}
+}
+
+// A squad that is fighting, or has just been given new units or a new order,
+// or is carrying out a timing-sensitive order, must update every frame.
+// Others can update less often.
+bool Squad::needsUpdateNow() const
+{
+	return
+		_changed ||
+		_inCombat ||
+		_order.getType() == SquadOrderTypes::Load ||
+		_order.getType() == SquadOrderTypes::Drop ||
+		_order.getType() == SquadOrderTypes::Survey;
+}
+
+int Squad::framesSinceUpdate() const
+{
+	return BWAPI::Broodwar->getFrameCount() - _lastUpdateFrame;
+}
+
+// TODO make a proper dispatch system for different orders
+void Squad::update(const CombatSimulationBatch & sims)
+{
 	if (_units.empty())
 	{
 		return;
 	}
 
+	BOSS::Timer timer;
+	timer.start();
+
 	_microHighTemplar.update();
 
 	// TODO This is a crude stand-in for a real survey squad controller.
@@ -78,7 +151,7 @@ void Squad::update()
 		// And fall through to let the rest of the drop squad attack.
 	}
 
-	bool needToRegroup = needsToRegroup();
+	bool needToRegroup = needsToRegroup(sims);
     
 	if (Config::Debug::DrawSquadInfo && _order.isRegroupableOrder()) 
 	{
@@ -121,8 +194,11 @@ void Squad::update()
 	stimIfNeeded();
 
 	// The remaining non-combat micro managers try to keep units near the front line.
-	if (BWAPI::Broodwar->getFrameCount() % 8 == 3)    // deliberately lag a little behind reality
+	// Squads out of combat may skip frames, so go by the time since the last time.
+	if (BWAPI::Broodwar->getFrameCount() - _lastFrontUpdate >= 8)    // deliberately lag a little behind reality
 	{
+		_lastFrontUpdate = BWAPI::Broodwar->getFrameCount();
+
 		BWAPI::Unit vanguard = unitClosestToEnemy();
 
 		// Medics.
@@ -133,6 +209,8 @@ void Squad::update()
 		_microDetectors.setUnitClosestToEnemy(vanguard);
 		_microDetectors.execute(_order);
 	}
+
+	_updateMs += timer.getElapsedTimeInMilliSec();
 }
 
 bool Squad::isEmpty() const
@@ -199,6 +277,7 @@ void Squad::setAllUnits()
 void Squad::setNearEnemyUnits()
 {
 	_nearEnemy.clear();
+	_inCombat = false;
 
 	for (const auto unit : _units)
 	{
@@ -208,6 +287,7 @@ void Squad::setNearEnemyUnits()
 		}
 
 		_nearEnemy[unit] = unitNearEnemy(unit);
+		_inCombat = _inCombat || _nearEnemy[unit];
 
 		if (Config::Debug::DrawSquadInfo) {
 			int left = unit->getType().dimensionLeft();
@@ -300,13 +380,17 @@ void Squad::addUnitsToMicroManagers()
 	_microTransports.setUnits(transportUnits);
 }
 
-// Calculates whether to regroup, aka retreat. Does combat sim if necessary.
-bool Squad::needsToRegroup()
+// Calculates whether to regroup, aka retreat. Sets up a combat sim if necessary;
+// needsToRegroup() reads its result after the batch has run.
+void Squad::startRegroupCheck(CombatSimulationBatch & sims)
 {
+	_combatSim = -1;
+	_regroupNoSim = false;
+
 	if (_units.empty())
 	{
 		_regroupStatus = std::string("No attackers available");
-		return false;
+		return;
 	}
 
 	// If we are not attacking, never regroup.
@@ -314,7 +398,7 @@ bool Squad::needsToRegroup()
 	if (!_order.isRegroupableOrder())
 	{
 		_regroupStatus = std::string("No attack order");
-		return false;
+		return;
 	}
 
 	// If we're nearly maxed and have good income or cash, don't retreat.
@@ -333,7 +417,7 @@ bool Squad::needsToRegroup()
 		else
 		{
 			_regroupStatus = std::string("Maxed. Banzai!");
-			return false;
+			return;
 		}
 	}
 
@@ -342,7 +426,7 @@ bool Squad::needsToRegroup()
 	if (!unitClosest)
 	{
 		_regroupStatus = std::string("No closest unit");
-		return false;
+		return;
 	}
 
 	/* - simplification and supposed improvement suggested by bftjoe - remove this section
@@ -402,20 +486,32 @@ bool Squad::needsToRegroup()
 	const int retreatDuration = 2 * 24;
 	bool retreat = _lastRetreatSwitchVal && (BWAPI::Broodwar->getFrameCount() - _lastRetreatSwitch < retreatDuration);
 
-	if (!retreat)
+	if (retreat)
+	{
+		_regroupStatus = std::string("Retreat");
+		_regroupNoSim = true;
+	}
+	else
 	{
 		// All other checks are done. Finally do the expensive combat simulation.
-		CombatSimulation sim;
+		_combatSim = sims.add(unitClosest->getPosition(), Config::Micro::CombatRegroupRadius);
+	}
+}
+
+// The regroup decision, from the combat sim if startRegroupCheck() set one up.
+bool Squad::needsToRegroup(const CombatSimulationBatch & sims)
+{
+	if (_combatSim < 0)
+	{
+		return _regroupNoSim;
+	}
 
-		sim.setCombatUnits(unitClosest->getPosition(), Config::Micro::CombatRegroupRadius);
-		double score = sim.simulateCombat();
+	double score = sims.getScore(_combatSim);
 
-		retreat = score < 0;
-		_lastRetreatSwitch = BWAPI::Broodwar->getFrameCount();
-		_lastRetreatSwitchVal = retreat;
+	bool retreat = score < 0;
+	_lastRetreatSwitch = BWAPI::Broodwar->getFrameCount();
+	_lastRetreatSwitchVal = retreat;
 
-	}
-	
 	if (retreat)
 	{
 		_regroupStatus = std::string("Retreat");
@@ -430,6 +526,13 @@ bool Squad::needsToRegroup()
 
 void Squad::setSquadOrder(const SquadOrder & so)
 {
+	// Orders are reissued every frame. Only a different order counts as a change.
+	if (so.getType() != _order.getType() ||
+		so.getPosition() != _order.getPosition() ||
+		so.getRadius() != _order.getRadius())
+	{
+		_changed = true;
+	}
 	_order = so;
 }
 
@@ -599,7 +702,11 @@ const SquadOrder & Squad::getSquadOrder() const
 
 void Squad::addUnit(BWAPI::Unit u)
 {
-	_units.insert(u);
+	if (!_units.contains(u))
+	{
+		_units.insert(u);
+		_changed = true;
+	}
 }
 
 void Squad::removeUnit(BWAPI::Unit u)
@@ -32,7 +32,14 @@ class Squad
 	bool				_attackAtMax;
     int                 _lastRetreatSwitch;
     bool                _lastRetreatSwitchVal;
+	int					_combatSim;			// index in this frame's combat sim batch, or -1 if none
+	bool				_regroupNoSim;		// regroup decision when there is no combat sim
     size_t              _priority;
+	int					_lastUpdateFrame;	// last frame the squad ran its micro
+	int					_lastFrontUpdate;	// last frame medics and detectors moved up
+	double				_updateMs;			// time the last update took, excluding the combat sim
+	bool				_changed;			// new units or a new order since the last update
+	bool				_inCombat;			// some unit was near the enemy at the last update
 	
 	SquadOrder          _order;
 	MicroMelee			_microMelee;
@@ -55,7 +62,8 @@ class Squad
 	void			setAllUnits();
 	
 	bool			unitNearEnemy(BWAPI::Unit unit);
-	bool			needsToRegroup();
+	void			startRegroupCheck(CombatSimulationBatch & sims);
+	bool			needsToRegroup(const CombatSimulationBatch & sims);
 
 	void			loadTransport();
 	void			stimIfNeeded();
@@ -66,7 +74,12 @@ public:
 	Squad();
     ~Squad();
 
-	void                update();
+	void                prepareUpdate(CombatSimulationBatch & sims);
+	void                update(const CombatSimulationBatch & sims);
+	void				refreshUnits();
+	bool				needsUpdateNow() const;
+	int					framesSinceUpdate() const;
+	double				getUpdateMs() const { return _updateMs; };
 	void                setSquadOrder(const SquadOrder & so);
 	void                addUnit(BWAPI::Unit u);
 	void                removeUnit(BWAPI::Unit u);
@@ -69,11 +69,79 @@ void SquadData::addSquad(const Squad & squad)
 	_squads[squad.getName()] = squad;
 }
 
-void SquadData::updateAllSquads()
+// Decide which squads update this frame.
+// Squads in combat, and a few others (see Squad::needsUpdateNow()), update every frame.
+// The rest update about every SquadUpdateInterval frames. They are spread out so that
+// only a share of them update on any one frame, and only as many as fit in the time
+// budget, going by how long each took last time. A squad that has waited twice the
+// interval updates regardless, so none is starved. A calm squad that the enemy has
+// just come near is in combat from this frame on (see Squad::refreshUnits()).
+void SquadData::scheduleSquads(std::vector<Squad *> & toUpdate)
 {
+	const int interval = std::max(1, Config::Micro::SquadUpdateInterval);
+
+	std::vector<Squad *> waiting;
+	double ms = 0.0;
+	size_t nCalm = 0;
+	size_t nCalmScheduled = 0;
 	for (auto & kv : _squads)
 	{
-		kv.second.update();
+		Squad & squad = kv.second;
+		bool urgent = squad.needsUpdateNow();
+		if (!urgent && squad.framesSinceUpdate() < 2 * interval)
+		{
+			squad.refreshUnits();
+			urgent = squad.needsUpdateNow();
+		}
+		nCalm += urgent ? 0 : 1;
+		if (urgent || squad.framesSinceUpdate() >= 2 * interval)
+		{
+			toUpdate.push_back(&squad);
+			ms += squad.getUpdateMs();
+			nCalmScheduled += urgent ? 0 : 1;
+		}
+		else if (squad.framesSinceUpdate() >= interval)
+		{
+			waiting.push_back(&squad);
+		}
+	}
+
+	// The longest waiting go first.
+	std::stable_sort(waiting.begin(), waiting.end(), [](const Squad * a, const Squad * b)
+	{
+		return a->framesSinceUpdate() > b->framesSinceUpdate();
+	});
+
+	const size_t calmPerFrame = (nCalm + interval - 1) / interval;
+	for (Squad * squad : waiting)
+	{
+		if (nCalmScheduled < calmPerFrame && ms + squad->getUpdateMs() <= double(Config::Micro::SquadUpdateBudgetMs))
+		{
+			toUpdate.push_back(squad);
+			ms += squad->getUpdateMs();
+			++nCalmScheduled;
+		}
+	}
+}
+
+// Squads that need a combat sim to decide whether to regroup set it up first,
+// then all the sims run at once, then the squads act on the results.
+void SquadData::updateAllSquads()
+{
+	std::vector<Squad *> toUpdate;
+	scheduleSquads(toUpdate);
+
+	_combatSims.clear();
+	for (Squad * squad : toUpdate)
+	{
+		squad->prepareUpdate(_combatSims);
+	}
+
+	_combatSims.run();
+
+	for (Squad * squad : toUpdate)
+	{
+		squad->update(_combatSims);
 	}
 }
 
@@ -7,7 +7,9 @@ namespace UAlbertaBot
 class SquadData
 {
 	std::map<std::string, Squad> _squads;
+	CombatSimulationBatch        _combatSims;
 
+    void    scheduleSquads(std::vector<Squad *> & toUpdate);
     void    updateAllSquads();
     void    verifySquadUniqueMembership();
 
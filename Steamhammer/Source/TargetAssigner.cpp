@@ -0,0 +1,157 @@
+#include "TargetAssigner.h"
+
+using namespace UAlbertaBot;
+
+// Same as BWAPI's Position::getApproxDistance() from the origin.
+int TargetAssigner::approxDistance(int dx, int dy)
+{
+	unsigned int min = std::abs(dx);
+	unsigned int max = std::abs(dy);
+	if (max < min)
+	{
+		std::swap(min, max);
+	}
+	if (min < (max >> 2))
+	{
+		return max;
+	}
+	const unsigned int minCalc = (3 * min) >> 3;
+	return (minCalc >> 5) + minCalc + max - (max >> 4) - (max >> 6);
+}
+
+// Edge to edge distances between the units' bounding boxes, the way Unit::getDistance() measures.
+// The bounds are read once per unit, and the pair loop is plain integer arithmetic.
+void TargetAssigner::measureDistances()
+{
+	const size_t nAttackers = _attackers.size();
+
+	std::vector<int> left(_nTargets), top(_nTargets), right(_nTargets), bottom(_nTargets);
+	for (size_t t = 0; t < _nTargets; ++t)
+	{
+		left[t] = _targets[t]->getLeft();
+		top[t] = _targets[t]->getTop();
+		right[t] = _targets[t]->getRight();
+		bottom[t] = _targets[t]->getBottom();
+	}
+
+	_distances.resize(nAttackers * _nTargets);
+	for (size_t a = 0; a < nAttackers; ++a)
+	{
+		const int aLeft = _attackers[a]->getLeft();
+		const int aTop = _attackers[a]->getTop();
+		const int aRight = _attackers[a]->getRight();
+		const int aBottom = _attackers[a]->getBottom();
+		int * row = _distances.data() + a * _nTargets;
+
+		for (size_t t = 0; t < _nTargets; ++t)
+		{
+			const int dx = std::max(0, std::max(aLeft - (right[t] + 1), left[t] - (aRight + 1)));
+			const int dy = std::max(0, std::max(aTop - (bottom[t] + 1), top[t] - (aBottom + 1)));
+			row[t] = approxDistance(dx, dy);
+		}
+	}
+}
+
+void TargetAssigner::setUnits(const std::vector<BWAPI::Unit> & attackers, const std::vector<BWAPI::Unit> & targets)
+{
+	_attackers = attackers;
+	_targets = targets;
+	_nTargets = targets.size();
+
+	_groundMinRange.clear();
+	_groundMaxRange.clear();
+	_airMinRange.clear();
+	_airMaxRange.clear();
+	_groundDamage.clear();
+	_airDamage.clear();
+	for (const auto attacker : _attackers)
+	{
+		const BWAPI::UnitType type = attacker->getType();
+		const BWAPI::WeaponType ground = type.groundWeapon();
+		const BWAPI::WeaponType air = type.airWeapon();
+		const bool hasGround = ground != BWAPI::WeaponTypes::None && ground != BWAPI::WeaponTypes::Unknown;
+		const bool hasAir = air != BWAPI::WeaponTypes::None && air != BWAPI::WeaponTypes::Unknown;
+
+		_groundMinRange.push_back(ground.minRange());
+		_groundMaxRange.push_back(hasGround ? attacker->getPlayer()->weaponMaxRange(ground) : -1);
+		_airMinRange.push_back(air.minRange());
+		_airMaxRange.push_back(hasAir ? attacker->getPlayer()->weaponMaxRange(air) : -1);
+		_groundDamage.push_back(hasGround ? attacker->getPlayer()->damage(ground) * ground.damageFactor() * type.maxGroundHits() : 0);
+		_airDamage.push_back(hasAir ? attacker->getPlayer()->damage(air) * air.damageFactor() * type.maxAirHits() : 0);
+	}
+
+	_flying.clear();
+	_armor.clear();
+	_hpLeft.clear();
+	for (const auto target : _targets)
+	{
+		_flying.push_back(target->isFlying());
+		_armor.push_back(target->getPlayer()->armor(target->getType()));
+		_hpLeft.push_back(target->getHitPoints() + target->getShields());
+	}
+
+	measureDistances();
+	_scores.assign(_attackers.size() * _nTargets, 0);
+	_assigned.assign(_attackers.size(), -1);
+}
+
+bool TargetAssigner::isInWeaponRange(size_t a, size_t t) const
+{
+	const int minRange = _flying[t] ? _airMinRange[a] : _groundMinRange[a];
+	const int maxRange = _flying[t] ? _airMaxRange[a] : _groundMaxRange[a];
+	const int distance = getDistance(a, t);
+
+	return maxRange >= 0 && (minRange ? minRange < distance : true) && distance <= maxRange;
+}
+
+void TargetAssigner::assign(int overkillPenalty, int slack)
+{
+	const size_t nAttackers = _attackers.size();
+	if (_nTargets == 0)
+	{
+		return;
+	}
+
+	// Attackers whose first choice is best go first.
+	std::vector<int> bestScore(nAttackers);
+	std::vector<int> order(nAttackers);
+	for (size_t a = 0; a < nAttackers; ++a)
+	{
+		const int * row = _scores.data() + a * _nTargets;
+		bestScore[a] = *std::max_element(row, row + _nTargets);
+		order[a] = int(a);
+	}
+	std::stable_sort(order.begin(), order.end(), [&bestScore](int x, int y) { return bestScore[x] > bestScore[y]; });
+
+	for (const int a : order)
+	{
+		const int * row = _scores.data() + a * _nTargets;
+		int best = -1;
+		int bestValue = 0;
+		for (size_t t = 0; t < _nTargets; ++t)
+		{
+			const int value = _hpLeft[t] > 0 ? row[t] : row[t] - overkillPenalty;
+			if (best < 0 || value > bestValue)
+			{
+				best = int(t);
+				bestValue = value;
+			}
+		}
+
+		_assigned[a] = best;
+
+		// Count the attacker's damage against the target if it will be shooting soon.
+		const int maxRange = _flying[best] ? _airMaxRange[a] : _groundMaxRange[a];
+		if (maxRange >= 0 && getDistance(a, best) <= maxRange + slack)
+		{
+			const int damage = _flying[best] ? _airDamage[a] : _groundDamage[a];
+			_hpLeft[best] -= std::max(damage > 0 ? 1 : 0, damage - _armor[best]);
+		}
+	}
+}
+
+// Null if the attacker was not in the list, or there were no targets.
+BWAPI::Unit TargetAssigner::getTarget(size_t a) const
+{
+	return a < _assigned.size() && _assigned[a] >= 0 ? _targets[_assigned[a]] : nullptr;
+}
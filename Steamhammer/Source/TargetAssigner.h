@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Common.h"
+
+namespace UAlbertaBot
+{
+
+// Choose targets for a group of units all at once, rather than letting each unit pick alone.
+// The micro manager fills in a score for every unit-target pair (higher is better), using the
+// distances measured here in one pass. Then the units take their targets greedily, units with
+// the best choices first. Once the units on a target are enough to kill it, the target is worth
+// less to the rest, so that they spread their fire instead of all shooting at one dying unit.
+class TargetAssigner
+{
+	std::vector<BWAPI::Unit>	_attackers;
+	std::vector<BWAPI::Unit>	_targets;
+	size_t						_nTargets;
+
+	// Unit-target pairs, attacker-major: pair (a, t) is element a * _nTargets + t.
+	std::vector<int>			_distances;		// same as Unit::getDistance()
+	std::vector<int>			_scores;
+
+	// Attackers.
+	std::vector<int>			_groundMinRange;
+	std::vector<int>			_groundMaxRange;	// -1 if no weapon
+	std::vector<int>			_airMinRange;
+	std::vector<int>			_airMaxRange;
+	std::vector<int>			_groundDamage;		// per attack, all hits
+	std::vector<int>			_airDamage;
+
+	// Targets.
+	std::vector<char>			_flying;
+	std::vector<int>			_armor;
+	std::vector<int>			_hpLeft;			// hit points plus shields, less the damage assigned
+
+	std::vector<int>			_assigned;			// target index per attacker, -1 if none
+
+	static int	approxDistance(int dx, int dy);
+	void		measureDistances();
+
+public:
+
+	void			setUnits(const std::vector<BWAPI::Unit> & attackers, const std::vector<BWAPI::Unit> & targets);
+
+	size_t			getAttackerCount() const	{ return _attackers.size(); };
+	size_t			getTargetCount() const		{ return _nTargets; };
+	BWAPI::Unit		getAttacker(size_t a) const	{ return _attackers[a]; };
+	BWAPI::Unit		getTargetUnit(size_t t) const	{ return _targets[t]; };
+
+	int				getDistance(size_t a, size_t t) const { return _distances[a * _nTargets + t]; };
+	bool			isInWeaponRange(size_t a, size_t t) const;		// same as Unit::isInWeaponRange()
+	void			setScore(size_t a, size_t t, int score) { _scores[a * _nTargets + t] = score; };
+
+	// Damage counts against a target only from attackers within range plus slack of it,
+	// the ones that will hit it soon. Past that, further attackers lose overkillPenalty.
+	void			assign(int overkillPenalty, int slack);
+
+	BWAPI::Unit		getTarget(size_t a) const;
+};
+
+}
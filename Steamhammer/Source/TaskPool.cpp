@@ -0,0 +1,122 @@
+#include "TaskPool.h"
+
+#include <algorithm>
+
+using namespace UAlbertaBot;
+
+// Threads beyond the main thread. A frame has little enough work that more would sit idle.
+const unsigned MaxWorkerThreads = 3;
+
+TaskPool & TaskPool::Instance()
+{
+	static TaskPool instance;
+	return instance;
+}
+
+TaskPool::TaskPool()
+	: _tasks(nullptr)
+	, _next(0)
+	, _unfinished(0)
+	, _started(false)
+	, _stopping(false)
+{
+}
+
+TaskPool::~TaskPool()
+{
+	shutdown();
+}
+
+// One worker per spare core, up to the limit. With one core, the main thread does everything.
+void TaskPool::start()
+{
+	if (_started)
+	{
+		return;
+	}
+	_started = true;
+
+	const unsigned cores = std::thread::hardware_concurrency();
+	const unsigned workers = cores > 1 ? std::min(cores - 1, MaxWorkerThreads) : 0;
+	for (unsigned i = 0; i < workers; ++i)
+	{
+		_threads.push_back(std::thread(&TaskPool::workerLoop, this));
+	}
+}
+
+void TaskPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [this] { return _stopping || (_tasks && _next < _tasks->size()); });
+		if (_stopping)
+		{
+			return;
+		}
+		runTasks(lock);
+	}
+}
+
+// Called with the lock held. Take tasks one at a time until none are left to start.
+void TaskPool::runTasks(std::unique_lock<std::mutex> & lock)
+{
+	while (_tasks && _next < _tasks->size())
+	{
+		const std::function<void()> & task = (*_tasks)[_next++];
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		if (--_unfinished == 0)
+		{
+			_done.notify_all();
+		}
+	}
+}
+
+void TaskPool::run(const std::vector<std::function<void()>> & tasks)
+{
+	if (tasks.empty())
+	{
+		return;
+	}
+
+	start();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_tasks = &tasks;
+	_next = 0;
+	_unfinished = tasks.size();
+	if (tasks.size() > 1)
+	{
+		_wake.notify_all();
+	}
+
+	runTasks(lock);
+	_done.wait(lock, [this] { return _unfinished == 0; });
+
+	_tasks = nullptr;
+}
+
+// Join the threads. Call it before the DLL is unloaded; joining from a static destructor
+// during unloading can hang on Windows. start() makes new threads for the next game.
+void TaskPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread & thread : _threads)
+	{
+		thread.join();
+	}
+	_threads.clear();
+
+	_stopping = false;
+	_started = false;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace UAlbertaBot
+{
+
+// A few worker threads to run independent pieces of work side by side within a frame.
+// run() hands out the tasks, works on them itself too, and returns when all are done.
+// The tasks must not call BWAPI: read the game on the main thread beforehand, and
+// act on the results on the main thread afterward.
+// The threads are started by start() at the start of each game (or on first use) and stopped by
+// shutdown() at the end of the game. The pool lives on between games in the same process.
+class TaskPool
+{
+	std::vector<std::thread>					_threads;
+	std::mutex									_mutex;
+	std::condition_variable						_wake;			// a batch of tasks is ready, or stop
+	std::condition_variable						_done;			// the last task of the batch is finished
+	const std::vector<std::function<void()>> *	_tasks;			// the current batch, or null
+	size_t										_next;			// next task to hand out
+	size_t										_unfinished;
+	bool										_started;
+	bool										_stopping;
+
+	TaskPool();
+
+	void	workerLoop();
+	void	runTasks(std::unique_lock<std::mutex> & lock);
+
+public:
+
+	static TaskPool &	Instance();
+	~TaskPool();
+
+	void	start();
+	void	run(const std::vector<std::function<void()>> & tasks);
+	void	shutdown();
+
+	size_t	getThreadCount() const { return _threads.size() + 1; };	// including the main thread
+};
+
+}
@@ -0,0 +1,261 @@
+#include "ThreatGrid.h"
+
+#include "InformationManager.h"
+#include "UnitUtil.h"
+
+using namespace UAlbertaBot;
+
+// How far outside its weapon range an enemy is still counted as a threat.
+// It covers the size of the units and the tile granularity of the grid.
+const int ThreatMargin = 32;
+
+// Damage per game second of 24 frames, counting all hits of one attack.
+static int WeaponDPS(BWAPI::WeaponType weapon)
+{
+	if (weapon == BWAPI::WeaponTypes::None || weapon.damageCooldown() <= 0)
+	{
+		return 0;
+	}
+
+	return weapon.damageAmount() * std::max(1, weapon.damageFactor()) * 24 / weapon.damageCooldown();
+}
+
+// Range and damage per second of the enemy unit type against our air or ground units.
+// Make pessimistic assumptions: Range upgrades are researched, bunkers hold 4 marines,
+// carriers have 8 interceptors.
+static void ThreatOf(BWAPI::UnitType type, bool air, int & range, int & dps)
+{
+	range = 0;
+	dps = 0;
+
+	if (air ? !UnitUtil::TypeCanAttackAir(type) : !UnitUtil::TypeCanAttackGround(type))
+	{
+		return;
+	}
+
+	if (type == BWAPI::UnitTypes::Terran_Bunker)
+	{
+		range = 6 * 32;
+		dps = 4 * WeaponDPS(BWAPI::UnitTypes::Terran_Marine.groundWeapon());
+		return;
+	}
+	if (type == BWAPI::UnitTypes::Protoss_Carrier)
+	{
+		range = 8 * 32;
+		dps = 8 * WeaponDPS(air ? BWAPI::UnitTypes::Protoss_Interceptor.airWeapon() : BWAPI::UnitTypes::Protoss_Interceptor.groundWeapon());
+		return;
+	}
+	if (type == BWAPI::UnitTypes::Protoss_Reaver)
+	{
+		range = 8 * 32;
+		dps = WeaponDPS(BWAPI::UnitTypes::Protoss_Scarab.groundWeapon());
+		return;
+	}
+
+	const BWAPI::WeaponType weapon = air ? type.airWeapon() : type.groundWeapon();
+	range = weapon.maxRange();
+	dps = WeaponDPS(weapon);
+
+	if (type == BWAPI::UnitTypes::Protoss_Dragoon)
+	{
+		range = 6 * 32;
+	}
+	else if (type == BWAPI::UnitTypes::Terran_Marine || type == BWAPI::UnitTypes::Zerg_Hydralisk)
+	{
+		range = 5 * 32;
+	}
+	else if (type == BWAPI::UnitTypes::Terran_Goliath && air)
+	{
+		range = 8 * 32;
+	}
+}
+
+ThreatGrid & ThreatGrid::Instance()
+{
+	static ThreatGrid instance;
+	return instance;
+}
+
+ThreatGrid::ThreatGrid()
+	: _rows(BWAPI::Broodwar->mapHeight())
+	, _cols(BWAPI::Broodwar->mapWidth())
+	, _ground(_rows * _cols, 0)
+	, _air(_rows * _cols, 0)
+{
+}
+
+// Fill in the stamp for an enemy unit. Return false if the unit is no threat.
+// Workers and unfinished units are not counted.
+bool ThreatGrid::makeStamp(const UnitInfo & ui, Stamp & stamp) const
+{
+	if (!ui.completed ||
+		ui.type.isWorker() ||
+		ui.type == BWAPI::UnitTypes::Protoss_Interceptor ||     // counted with its carrier
+		!ui.lastPosition.isValid())
+	{
+		return false;
+	}
+
+	ThreatOf(ui.type, false, stamp.groundRange, stamp.groundDPS);
+	ThreatOf(ui.type, true, stamp.airRange, stamp.airDPS);
+
+	if (stamp.groundDPS == 0 && stamp.airDPS == 0)
+	{
+		return false;
+	}
+
+	stamp.tile = BWAPI::TilePosition(ui.lastPosition);
+	stamp.type = ui.type;
+	stamp.lastSeenFrame = 0;
+	return true;
+}
+
+// Add the stamp to the grids (sign = 1) or take it back out (sign = -1).
+void ThreatGrid::applyStamp(const Stamp & stamp, int sign)
+{
+	if (stamp.groundDPS > 0)
+	{
+		addCircle(_ground, stamp.tile, stamp.groundRange, sign * stamp.groundDPS);
+	}
+	if (stamp.airDPS > 0)
+	{
+		addCircle(_air, stamp.tile, stamp.airRange, sign * stamp.airDPS);
+	}
+}
+
+void ThreatGrid::addCircle(std::vector<int> & grid, const BWAPI::TilePosition & center, int range, int value)
+{
+	const int radius = (range + ThreatMargin + 16) / 32;      // in tiles, rounded
+	const int radiusSq = radius * radius;
+
+	const int r0 = std::max(0, center.y - radius);
+	const int r1 = std::min(_rows - 1, center.y + radius);
+	const int c0 = std::max(0, center.x - radius);
+	const int c1 = std::min(_cols - 1, center.x + radius);
+
+	for (int r = r0; r <= r1; ++r)
+	{
+		const int dy = r - center.y;
+		for (int c = c0; c <= c1; ++c)
+		{
+			const int dx = c - center.x;
+			if (dx * dx + dy * dy <= radiusSq)
+			{
+				grid[getIndex(r, c)] += value;
+			}
+		}
+	}
+}
+
+// Off-map coordinates are clamped to the map edge.
+int ThreatGrid::valueAt(const std::vector<int> & grid, int x, int y) const
+{
+	x = std::max(0, std::min(x, _cols - 1));
+	y = std::max(0, std::min(y, _rows - 1));
+	return grid[getIndex(y, x)];
+}
+
+// Restamp enemy units whose threat changed, and take out units that are gone.
+void ThreatGrid::update()
+{
+	const int now = BWAPI::Broodwar->getFrameCount();
+
+	for (const auto & kv : InformationManager::Instance().getUnitInfo(BWAPI::Broodwar->enemy()))
+	{
+		Stamp stamp;
+		const bool isThreat = makeStamp(kv.second, stamp);
+
+		auto it = _stamps.find(kv.first);
+		if (it != _stamps.end())
+		{
+			if (isThreat && it->second.sameAs(stamp))
+			{
+				it->second.lastSeenFrame = now;
+				continue;
+			}
+			applyStamp(it->second, -1);
+			_stamps.erase(it);
+		}
+
+		if (isThreat)
+		{
+			stamp.lastSeenFrame = now;
+			applyStamp(stamp, 1);
+			_stamps[kv.first] = stamp;
+		}
+	}
+
+	// Units that InformationManager has forgotten (destroyed, or buildings that are gone).
+	for (auto it = _stamps.begin(); it != _stamps.end(); )
+	{
+		if (it->second.lastSeenFrame != now)
+		{
+			applyStamp(it->second, -1);
+			it = _stamps.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	drawThreats();
+}
+
+void ThreatGrid::drawThreats() const
+{
+	if (!Config::Debug::DrawThreatGrid)
+	{
+		return;
+	}
+
+	for (int r = 0; r < _rows; ++r)
+	{
+		for (int c = 0; c < _cols; ++c)
+		{
+			const int ground = _ground[getIndex(r, c)];
+			const int air = _air[getIndex(r, c)];
+			if (ground > 0 || air > 0)
+			{
+				BWAPI::Broodwar->drawTextMap(c * 32 + 2, r * 32 + 2, "%c%d", orange, ground);
+				BWAPI::Broodwar->drawTextMap(c * 32 + 2, r * 32 + 14, "%c%d", cyan, air);
+			}
+		}
+	}
+}
+
+// Threat to our ground units at the position.
+int ThreatGrid::getGroundThreat(const BWAPI::Position & pos) const
+{
+	return valueAt(_ground, pos.x / 32, pos.y / 32);
+}
+
+// Threat to our air units at the position.
+int ThreatGrid::getAirThreat(const BWAPI::Position & pos) const
+{
+	return valueAt(_air, pos.x / 32, pos.y / 32);
+}
+
+int ThreatGrid::getThreat(const BWAPI::Position & pos, bool air) const
+{
+	return air ? getAirThreat(pos) : getGroundThreat(pos);
+}
+
+// Threat to the given unit of ours where it stands.
+int ThreatGrid::getThreat(BWAPI::Unit unit) const
+{
+	return getThreat(unit->getPosition(), unit->isFlying());
+}
+
+// The direction in which threat increases fastest, unnormalized.
+// Fleeing units want to go the opposite way. (0,0) if the threat is flat.
+BWAPI::Position ThreatGrid::getThreatGradient(const BWAPI::Position & pos, bool air) const
+{
+	const std::vector<int> & grid = air ? _air : _ground;
+	const int x = pos.x / 32;
+	const int y = pos.y / 32;
+
+	return BWAPI::Position(
+		valueAt(grid, x + 1, y) - valueAt(grid, x - 1, y),
+		valueAt(grid, x, y + 1) - valueAt(grid, x, y - 1));
+}
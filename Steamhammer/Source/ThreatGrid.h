@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Common.h"
+#include "UnitData.h"
+
+namespace UAlbertaBot
+{
+
+// Enemy threat at each build tile, separately for our ground and air units.
+// The value at a tile is the summed damage per second (in game seconds of 24 frames)
+// of all known enemy units that could shoot at a unit on that tile.
+// Remembered enemy units that are out of sight are included, at their last known positions.
+// The grids are updated incrementally: Each frame, an enemy unit is restamped only if
+// its tile, type, or completion status changed since the last stamp.
+class ThreatGrid
+{
+	// What one enemy unit has contributed to the grids, so that it can be taken back out.
+	struct Stamp
+	{
+		BWAPI::TilePosition	tile;
+		BWAPI::UnitType		type;
+		int					groundRange;	// pixels, 0 if none
+		int					groundDPS;
+		int					airRange;		// pixels, 0 if none
+		int					airDPS;
+		int					lastSeenFrame;	// last frame that InformationManager still knew the unit
+
+		bool sameAs(const Stamp & other) const
+		{
+			return tile == other.tile && type == other.type &&
+				groundRange == other.groundRange && groundDPS == other.groundDPS &&
+				airRange == other.airRange && airDPS == other.airDPS;
+		}
+	};
+
+	int									_rows;
+	int									_cols;
+	std::vector<int>					_ground;	// indexed by tile
+	std::vector<int>					_air;
+
+	std::map<BWAPI::Unit, Stamp>		_stamps;
+
+	ThreatGrid();
+
+	int			getIndex(int row, int col) const { return row * _cols + col; }
+	bool		makeStamp(const UnitInfo & ui, Stamp & stamp) const;
+	void		applyStamp(const Stamp & stamp, int sign);
+	void		addCircle(std::vector<int> & grid, const BWAPI::TilePosition & center, int range, int value);
+	int			valueAt(const std::vector<int> & grid, int x, int y) const;
+
+public:
+
+	static ThreatGrid &	Instance();
+
+	void				update();
+	void				drawThreats() const;
+
+	int					getGroundThreat(const BWAPI::Position & pos) const;
+	int					getAirThreat(const BWAPI::Position & pos) const;
+	int					getThreat(const BWAPI::Position & pos, bool air) const;
+	int					getThreat(BWAPI::Unit unit) const;
+
+	BWAPI::Position		getThreatGradient(const BWAPI::Position & pos, bool air) const;
+};
+
+}
@@ -0,0 +1,105 @@
+#include "TileLayer.h"
+
+#include <algorithm>
+
+using namespace UAlbertaBot;
+
+TileLayer::TileLayer()
+	: _width(0)
+	, _height(0)
+	, _rowWords(0)
+{
+}
+
+void TileLayer::init(int width, int height)
+{
+	_width = width;
+	_height = height;
+	_rowWords = (width + 63) / 64;
+	_bits.assign(_rowWords * height, 0);
+	_sums.assign((width + 1) * (height + 1), 0);
+}
+
+bool TileLayer::get(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= _width || y >= _height)
+	{
+		return false;
+	}
+
+	return ((_bits[y * _rowWords + (x >> 6)] >> (x & 63)) & 1) != 0;
+}
+
+void TileLayer::set(int x, int y, bool value)
+{
+	if (x < 0 || y < 0 || x >= _width || y >= _height)
+	{
+		return;
+	}
+
+	const uint64_t mask = uint64_t(1) << (x & 63);
+	if (value)
+	{
+		_bits[y * _rowWords + (x >> 6)] |= mask;
+	}
+	else
+	{
+		_bits[y * _rowWords + (x >> 6)] &= ~mask;
+	}
+}
+
+// Only the sums below and to the right of a changed tile depend on it.
+void TileLayer::updateSums(int x, int y)
+{
+	const int stride = _width + 1;
+	const int left = std::max(0, x) + 1;
+	const int top = std::max(0, y) + 1;
+
+	for (int sy = top; sy <= _height; ++sy)
+	{
+		int * row = _sums.data() + sy * stride;
+		const int * above = row - stride;
+		for (int sx = left; sx <= _width; ++sx)
+		{
+			row[sx] = (get(sx - 1, sy - 1) ? 1 : 0) + row[sx - 1] + above[sx] - above[sx - 1];
+		}
+	}
+}
+
+void TileLayer::setRectangle(int x, int y, int width, int height, bool value)
+{
+	const int left = std::max(0, x);
+	const int top = std::max(0, y);
+	const int right = std::min(_width, x + width);
+	const int bottom = std::min(_height, y + height);
+
+	if (left >= right || top >= bottom)
+	{
+		return;
+	}
+
+	for (int ty = top; ty < bottom; ++ty)
+	{
+		for (int tx = left; tx < right; ++tx)
+		{
+			set(tx, ty, value);
+		}
+	}
+
+	updateSums(left, top);
+}
+
+int TileLayer::count(int x, int y, int width, int height) const
+{
+	const int left = std::max(0, x);
+	const int top = std::max(0, y);
+	const int right = std::min(_width, x + width);
+	const int bottom = std::min(_height, y + height);
+
+	if (left >= right || top >= bottom)
+	{
+		return 0;
+	}
+
+	return sum(right, bottom) - sum(left, bottom) - sum(right, top) + sum(left, top);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace UAlbertaBot
+{
+
+// One layer of yes-or-no flags over the build tiles of the map, bit-packed by row,
+// with a summed-area table so that counting the set tiles in any rectangle takes constant time.
+// After changing flags with set(), call updateSums() from the top left changed tile.
+class TileLayer
+{
+	int						_width;
+	int						_height;
+	int						_rowWords;
+
+	std::vector<uint64_t>	_bits;		// row-major, _rowWords words per row
+	std::vector<int>		_sums;		// (_width+1) x (_height+1): entry (x,y) counts the set tiles above and left of x,y
+
+	int		sum(int x, int y) const { return _sums[y * (_width + 1) + x]; };
+
+public:
+	TileLayer();
+
+	void	init(int width, int height);
+
+	bool	get(int x, int y) const;
+	void	set(int x, int y, bool value);
+	void	updateSums(int x, int y);
+
+	// Set a rectangle and update the sums. The rectangle is clipped to the map.
+	void	setRectangle(int x, int y, int width, int height, bool value);
+
+	// How many tiles in the rectangle are set. The rectangle is clipped to the map.
+	int		count(int x, int y, int width, int height) const;
+};
+
+}
@@ -9,8 +9,11 @@
 #include "UAlbertaBotModule.h"
 
 #include "Common.h"
+#include "LayoutPlanner.h"
+#include "MapAnalysis.h"
 #include "OpponentModel.h"
 #include "ParseUtils.h"
+#include "TaskPool.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
@@ -21,6 +24,9 @@ void UAlbertaBotModule::onStart()
     // Initialize BOSS, the Build Order Search System
     BOSS::init();
 
+	// Start the worker threads for the combat simulations. They were stopped at the end of any earlier game.
+	TaskPool::Instance().start();
+
 	// Call BWTA to read and analyze the current map.
 	// Very slow if the map has not been seen before, so that info is not cached.
 	BWTA::readMap();
@@ -32,6 +38,16 @@ void UAlbertaBotModule::onStart()
 	// The config depends on the map and must be read after the map is analyzed.
     ParseUtils::ParseConfigFile(Config::ConfigFile::ConfigFileLocation);
 
+	// Our own map analysis. It needs the read and write directories from the config.
+	// Fast if the map has been seen before: The analysis is read from a file.
+	// BWTA is still analyzed above, because its BaseLocation and Region pointers are used all
+	// through the bot. Until those users move over, startup pays for both.
+	MapAnalysis::Instance();
+
+	// Plan building slots for every base. Also read from a file if the map has been seen before.
+	// It depends on the config for building spacing.
+	LayoutPlanner::Instance();
+
     // Set our BWAPI options here    
 	BWAPI::Broodwar->setLocalSpeed(Config::BWAPIOptions::SetLocalSpeed);
 	BWAPI::Broodwar->setFrameSkip(Config::BWAPIOptions::SetFrameSkip);
@@ -59,6 +75,8 @@ void UAlbertaBotModule::onEnd(bool isWinner)
 {
 	OpponentModel::Instance().setWin(isWinner);
 	OpponentModel::Instance().write();
+
+	TaskPool::Instance().shutdown();
 }
 
 void UAlbertaBotModule::onFrame()
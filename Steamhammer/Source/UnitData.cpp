@@ -6,6 +6,9 @@ using namespace UAlbertaBot;
 UnitData::UnitData() 
 	: mineralsLost(0)
 	, gasLost(0)
+	, cellCols((BWAPI::Broodwar->mapWidth() * 32 + CellSize - 1) / CellSize)
+	, cellRows((BWAPI::Broodwar->mapHeight() * 32 + CellSize - 1) / CellSize)
+	, cells(cellCols * cellRows)
 {
 	int maxTypeID(0);
 	for (const BWAPI::UnitType & t : BWAPI::UnitTypes::allUnitTypes())
@@ -30,6 +33,7 @@ void UnitData::updateUnit(BWAPI::Unit unit)
     }
     
 	UnitInfo & ui   = unitMap[unit];
+	const int oldCell = firstSeen ? -1 : cellIndex(ui.lastPosition);
     ui.unit         = unit;
 	ui.updateFrame	= BWAPI::Broodwar->getFrameCount();
     ui.player       = unit->getPlayer();
@@ -43,7 +47,14 @@ void UnitData::updateUnit(BWAPI::Unit unit)
     if (firstSeen)
     {
         numUnits[unit->getType().getID()]++;
+		addToCell(&ui);
     }
+	else if (oldCell != cellIndex(ui.lastPosition))
+	{
+		// It moved to a different cell.
+		removeFromCell(oldCell, &ui);
+		addToCell(&ui);
+	}
 }
 
 void UnitData::removeUnit(BWAPI::Unit unit)
@@ -55,7 +66,12 @@ void UnitData::removeUnit(BWAPI::Unit unit)
 	--numUnits[unit->getType().getID()];
 	++numDeadUnits[unit->getType().getID()];
 	
-	unitMap.erase(unit);
+	auto it = unitMap.find(unit);
+	if (it != unitMap.end())
+	{
+		removeFromCell(cellIndex(it->second.lastPosition), &it->second);
+		unitMap.erase(it);
+	}
 
 	// NOTE This assert fails, so the unit counts cannot be trusted. :-(
 	// UAB_ASSERT(numUnits[unit->getType().getID()] >= 0, "negative units");
@@ -68,6 +84,7 @@ void UnitData::removeBadUnits()
 		if (badUnitInfo(iter->second))
 		{
 			numUnits[iter->second.type.getID()]--;
+			removeFromCell(cellIndex(iter->second.lastPosition), &iter->second);
 			iter = unitMap.erase(iter);
 		}
 		else
@@ -77,6 +94,30 @@ void UnitData::removeBadUnits()
 	}
 }
 
+// The cell that a position falls in. Positions off the map are clamped to the edge cells.
+int UnitData::cellIndex(const BWAPI::Position & pos) const
+{
+	const int col = std::max(0, std::min(pos.x / CellSize, cellCols - 1));
+	const int row = std::max(0, std::min(pos.y / CellSize, cellRows - 1));
+	return row * cellCols + col;
+}
+
+void UnitData::addToCell(UnitInfo * ui)
+{
+	cells[cellIndex(ui->lastPosition)].push_back(ui);
+}
+
+void UnitData::removeFromCell(int cellIx, UnitInfo * ui)
+{
+	std::vector<UnitInfo *> & cell = cells[cellIx];
+	auto it = std::find(cell.begin(), cell.end(), ui);
+	if (it != cell.end())
+	{
+		*it = cell.back();
+		cell.pop_back();
+	}
+}
+
 const bool UnitData::badUnitInfo(const UnitInfo & ui) const
 {
     if (!ui.unit)
@@ -123,4 +164,42 @@ int UnitData::getNumDeadUnits(BWAPI::UnitType t) const
 const std::map<BWAPI::Unit,UnitInfo> & UnitData::getUnits() const 
 { 
     return unitMap; 
-}
\ No newline at end of file
+}
+
+// Units whose last known position is within the radius of the center.
+void UnitData::getUnitsNear(std::vector<const UnitInfo *> & units, BWAPI::Position center, int radius) const
+{
+	getUnitsNear(units, center, radius, nullptr);
+}
+
+// Units whose last known position is within the radius of the center,
+// and whose type passes the filter (if any).
+void UnitData::getUnitsNear(std::vector<const UnitInfo *> & units, BWAPI::Position center, int radius,
+							bool (*typeFilter)(BWAPI::UnitType)) const
+{
+	const int x0(std::max((center.x - radius) / CellSize, 0));
+	const int x1(std::min((center.x + radius) / CellSize, cellCols - 1));
+	const int y0(std::max((center.y - radius) / CellSize, 0));
+	const int y1(std::min((center.y + radius) / CellSize, cellRows - 1));
+	const int radiusSq(radius * radius);
+
+	for (int y(y0); y <= y1; ++y)
+	{
+		for (int x(x0); x <= x1; ++x)
+		{
+			for (const UnitInfo * ui : cells[y * cellCols + x])
+			{
+				if (typeFilter && !typeFilter(ui->type))
+				{
+					continue;
+				}
+				const int dx = ui->lastPosition.x - center.x;
+				const int dy = ui->lastPosition.y - center.y;
+				if (dx * dx + dy * dy <= radiusSq)
+				{
+					units.push_back(ui);
+				}
+			}
+		}
+	}
+}
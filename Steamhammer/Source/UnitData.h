@@ -69,6 +69,19 @@ class UnitData
 {
     UIMap unitMap;
 
+	// Spatial index over UnitInfo::lastPosition, for radius queries.
+	// The map is divided into square cells. Each cell lists the units whose
+	// last known position is inside it. Pointers into unitMap stay valid until
+	// the unit is erased, and we take it out of its cell before that.
+	static const int						CellSize = 256;		// pixels
+
+	int										cellCols, cellRows;
+	std::vector< std::vector<UnitInfo *> >	cells;
+
+	int		cellIndex(const BWAPI::Position & pos) const;
+	void	addToCell(UnitInfo * ui);
+	void	removeFromCell(int cellIx, UnitInfo * ui);
+
     const bool badUnitInfo(const UnitInfo & ui) const;
 
     std::vector<int>						numUnits;       // how many now
@@ -80,6 +93,8 @@ class UnitData
 public:
 
     UnitData();
+	UnitData(const UnitData &) = delete;
+	UnitData & operator=(const UnitData &) = delete;
 
     void	updateUnit(BWAPI::Unit unit);
     void	removeUnit(BWAPI::Unit unit);
@@ -90,5 +105,9 @@ public:
     int		getNumUnits(BWAPI::UnitType t)              const;
     int		getNumDeadUnits(BWAPI::UnitType t)          const;
     const	std::map<BWAPI::Unit,UnitInfo> & getUnits() const;
+
+	void	getUnitsNear(std::vector<const UnitInfo *> & units, BWAPI::Position center, int radius) const;
+	void	getUnitsNear(std::vector<const UnitInfo *> & units, BWAPI::Position center, int radius,
+						 bool (*typeFilter)(BWAPI::UnitType)) const;
 };
 }
\ No newline at end of file
@@ -3,8 +3,56 @@
 
 using namespace UAlbertaBot;
 
+namespace
+{
+	// The minerals near a depot, and the farthest that still counts toward saturation.
+	const int MineralPatchRadius = 300;
+	const int SaturationRadius = 200;
+
+	// The mining model. Only one worker at a time can mine a patch, so a patch with
+	// n workers brings in n trips per round trip, up to one trip per MiningFrames.
+	const int MiningFrames = 80;			// time at the patch to mine one load
+	const int TurnaroundFrames = 30;		// speeding up, slowing down, turning, handing in
+	const int CargoMinerals = 8;
+
+	// Before there are measurements.
+	double estimatedRoundTrip(int distance)
+	{
+		const double speed = BWAPI::Broodwar->self()->getRace().getWorker().topSpeed();
+		return 2.0 * distance / speed + MiningFrames + TurnaroundFrames;
+	}
+
+	// Minerals per frame from a patch with the given number of workers.
+	double patchIncome(double roundTrip, int nWorkers)
+	{
+		return CargoMinerals * std::min(nWorkers / roundTrip, 1.0 / MiningFrames);
+	}
+
+	// Distance from the depot to a mineral patch, the same as Unit::getDistance().
+	// Uses the patch's initial position, so it works whether or not the patch is visible.
+	int depotToMineralDistance(BWAPI::Unit depot, BWAPI::Unit mineral)
+	{
+		const BWAPI::UnitType type = mineral->getInitialType();
+		const BWAPI::Position pos = mineral->getInitialPosition();
+		const int left = pos.x - type.dimensionLeft();
+		const int top = pos.y - type.dimensionUp();
+		const int right = pos.x + type.dimensionRight();
+		const int bottom = pos.y + type.dimensionDown();
+
+		const int dx = std::max(0, std::max(depot->getLeft() - (right + 1), left - (depot->getRight() + 1)));
+		const int dy = std::max(0, std::max(depot->getTop() - (bottom + 1), top - (depot->getBottom() + 1)));
+		return BWAPI::Position(0, 0).getApproxDistance(BWAPI::Position(dx, dy));
+	}
+}
+
 WorkerData::WorkerData() 
 {
+	for (int job = 0; job < NumJobs; ++job)
+	{
+		jobHead[job] = -1;
+		jobCount[job] = 0;
+	}
+
     for (const auto unit : BWAPI::Broodwar->getAllUnits())
 	{
 		if ((unit->getType() == BWAPI::UnitTypes::Resource_Mineral_Field))
@@ -14,11 +62,104 @@ WorkerData::WorkerData()
 	}
 }
 
+// The worker's slot, or -1 if it is not one of our workers.
+int WorkerData::getSlot(BWAPI::Unit unit) const
+{
+	const int id = unit->getID();
+	return id >= 0 && id < int(unitSlot.size()) ? unitSlot[id] : -1;
+}
+
+// A new worker gets a slot with the Default job.
+int WorkerData::addSlot(BWAPI::Unit unit)
+{
+	int slot = getSlot(unit);
+	if (slot >= 0)
+	{
+		return slot;
+	}
+
+	if (freeSlots.empty())
+	{
+		slot = int(records.size());
+		records.push_back(WorkerRecord());
+	}
+	else
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+
+	WorkerRecord & record = records[slot];
+	record.unit = unit;
+	record.depot = nullptr;
+	record.resource = nullptr;
+	record.repairUnit = nullptr;
+	record.buildingType = BWAPI::UnitTypes::None;
+	record.moveData = WorkerMoveData();
+	record.lastDelivery = -1;
+	record.carrying = false;
+	linkJob(slot, Default);
+
+	const int id = unit->getID();
+	if (id >= int(unitSlot.size()))
+	{
+		unitSlot.resize(id + 1, -1);
+	}
+	unitSlot[id] = slot;
+
+	return slot;
+}
+
+void WorkerData::removeSlot(int slot)
+{
+	unlinkJob(slot);
+	unitSlot[records[slot].unit->getID()] = -1;
+	records[slot].unit = nullptr;
+	freeSlots.push_back(slot);
+}
+
+void WorkerData::linkJob(int slot, WorkerJob job)
+{
+	WorkerRecord & record = records[slot];
+	record.job = job;
+	record.prev = -1;
+	record.next = jobHead[job];
+	if (record.next >= 0)
+	{
+		records[record.next].prev = slot;
+	}
+	jobHead[job] = slot;
+	++jobCount[job];
+}
+
+void WorkerData::unlinkJob(int slot)
+{
+	WorkerRecord & record = records[slot];
+	if (record.prev >= 0)
+	{
+		records[record.prev].next = record.next;
+	}
+	else
+	{
+		jobHead[record.job] = record.next;
+	}
+	if (record.next >= 0)
+	{
+		records[record.next].prev = record.prev;
+	}
+	--jobCount[record.job];
+}
+
 void WorkerData::workerDestroyed(BWAPI::Unit unit)
 {
 	if (!unit) { return; }
 
-	clearPreviousJob(unit);
+	const int slot = getSlot(unit);
+	if (slot >= 0)
+	{
+		clearPreviousJob(unit);
+		removeSlot(slot);
+	}
 	workers.erase(unit);
 }
 
@@ -27,7 +168,8 @@ void WorkerData::addWorker(BWAPI::Unit unit)
 	if (!unit || !unit->exists()) { return; }
 
 	workers.insert(unit);
-	workerJobMap[unit] = Default;
+	addSlot(unit);
+	clearPreviousJob(unit);
 }
 
 void WorkerData::addWorker(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUnit)
@@ -37,6 +179,7 @@ void WorkerData::addWorker(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUnit)
 	assert(workers.find(unit) == workers.end());
 
 	workers.insert(unit);
+	addSlot(unit);
 	setWorkerJob(unit, job, jobUnit);
 }
 
@@ -46,6 +189,7 @@ void WorkerData::addWorker(BWAPI::Unit unit, WorkerJob job, BWAPI::UnitType jobU
 
 	assert(workers.find(unit) == workers.end());
 	workers.insert(unit);
+	addSlot(unit);
 	setWorkerJob(unit, job, jobUnitType);
 }
 
@@ -56,6 +200,25 @@ void WorkerData::addDepot(BWAPI::Unit unit)
 	assert(depots.find(unit) == depots.end());
 	depots.insert(unit);
 	depotWorkerCount[unit] = 0;
+
+	std::vector<DepotMineral> & minerals = depotMinerals[unit];
+	minerals.clear();
+	for (const auto mineral : BWAPI::Broodwar->getStaticMinerals())
+	{
+		if (mineral->getInitialType() == BWAPI::UnitTypes::Resource_Mineral_Field && !minedOutPatches.contains(mineral))
+		{
+			const int distance = depotToMineralDistance(unit, mineral);
+			if (distance < MineralPatchRadius)
+			{
+				DepotMineral patch = { mineral, distance, estimatedRoundTrip(distance) };
+				minerals.push_back(patch);
+			}
+		}
+	}
+	std::stable_sort(minerals.begin(), minerals.end(), [](const DepotMineral & a, const DepotMineral & b)
+	{
+		return a.distance < b.distance;
+	});
 }
 
 void WorkerData::removeDepot(BWAPI::Unit unit)
@@ -64,18 +227,33 @@ void WorkerData::removeDepot(BWAPI::Unit unit)
 
 	depots.erase(unit);
 	depotWorkerCount.erase(unit);
+	depotMinerals.erase(unit);
 
 	// re-balance workers in here
-	for (auto & worker : workers)
+	for (const auto worker : getJobWorkers(Minerals))
 	{
 		// if a worker was working at this depot
-		if (workerDepotMap[worker] == unit)
+		if (getWorkerDepot(worker) == unit)
 		{
 			setWorkerJob(worker, Idle, nullptr);
 		}
 	}
 }
 
+// The mineral patch mined out.
+void WorkerData::removeMineralPatch(BWAPI::Unit mineral)
+{
+	for (auto & kv : depotMinerals)
+	{
+		std::vector<DepotMineral> & minerals = kv.second;
+		minerals.erase(
+			std::remove_if(minerals.begin(), minerals.end(), [mineral](const DepotMineral & patch) { return patch.mineral == mineral; }),
+			minerals.end());
+	}
+
+	minedOutPatches.insert(mineral);
+}
+
 void WorkerData::addToMineralPatch(BWAPI::Unit unit, int num)
 {
     if (workersOnMineralPatch.find(unit) == workersOnMineralPatch.end())
@@ -92,8 +270,13 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUn
 {
 	if (!unit || !unit->exists()) { return; }
 
+	const int slot = getSlot(unit);
+	if (slot < 0) { return; }
+
 	clearPreviousJob(unit);
-	workerJobMap[unit] = job;
+	unlinkJob(slot);
+	linkJob(slot, job);
+	WorkerRecord & record = records[slot];
 
 	if (job == Minerals)
 	{
@@ -101,10 +284,10 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUn
 		depotWorkerCount[jobUnit] += 1;
 
 		// set the mineral the worker is working on
-		workerDepotMap[unit] = jobUnit;
+		record.depot = jobUnit;
 
         BWAPI::Unit mineralToMine = getMineralToMine(unit);
-        workerMineralAssignment[unit] = mineralToMine;
+        record.resource = mineralToMine;
         addToMineralPatch(mineralToMine, 1);
 
 		// right click the mineral to start mining
@@ -116,7 +299,7 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUn
 		refineryWorkerCount[jobUnit] += 1;
 
 		// set the refinery the worker is working on
-		workerRefineryMap[unit] = jobUnit;
+		record.resource = jobUnit;
 
 		// right click the refinery to start harvesting
 		Micro::SmartRightClick(unit, jobUnit);
@@ -127,7 +310,7 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUn
         assert(unit->getType() == BWAPI::UnitTypes::Terran_SCV);
 
         // set the building the worker is to repair
-        workerRepairMap[unit] = jobUnit;
+        record.repairUnit = jobUnit;
 
         // start repairing 
         if (!unit->isRepairing())
@@ -149,17 +332,16 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, BWAPI::UnitType j
 {
 	if (!unit) { return; }
 
+	const int slot = getSlot(unit);
+	if (slot < 0) { return; }
+
 	clearPreviousJob(unit);
-	workerJobMap[unit] = job;
+	unlinkJob(slot);
+	linkJob(slot, job);
 
 	if (job == Build)
 	{
-		workerBuildingTypeMap[unit] = jobUnitType;
-	}
-
-	if (workerJobMap[unit] != Build)
-	{
-		//BWAPI::Broodwar->printf("Something went horribly wrong");
+		records[slot].buildingType = jobUnitType;
 	}
 }
 
@@ -167,57 +349,52 @@ void WorkerData::setWorkerJob(BWAPI::Unit unit, WorkerJob job, WorkerMoveData wm
 {
 	if (!unit) { return; }
 
+	const int slot = getSlot(unit);
+	if (slot < 0) { return; }
+
 	clearPreviousJob(unit);
-	workerJobMap[unit] = job;
+	unlinkJob(slot);
+	linkJob(slot, job);
 
 	if (job == Move)
 	{
-		workerMoveMap[unit] = wmd;
-	}
-
-	if (workerJobMap[unit] != Move)
-	{
-		//BWAPI::Broodwar->printf("Something went horribly wrong");
+		records[slot].moveData = wmd;
 	}
 }
 
+// Undo the worker's job assignment, leaving it with the Default job.
 void WorkerData::clearPreviousJob(BWAPI::Unit unit)
 {
 	if (!unit) { return; }
 
-	WorkerJob previousJob = getWorkerJob(unit);
+	const int slot = getSlot(unit);
+	if (slot < 0) { return; }
 
-	if (previousJob == Minerals)
-	{
-		depotWorkerCount[workerDepotMap[unit]] -= 1;
+	WorkerRecord & record = records[slot];
 
-		workerDepotMap.erase(unit);
+	if (record.job == Minerals)
+	{
+		depotWorkerCount[record.depot] -= 1;
 
         // remove a worker from this unit's assigned mineral patch
-        addToMineralPatch(workerMineralAssignment[unit], -1);
+        addToMineralPatch(record.resource, -1);
 
-        // erase the association from the map
-        workerMineralAssignment.erase(unit);
-	}
-	else if (previousJob == Gas)
-	{
-		refineryWorkerCount[workerRefineryMap[unit]] -= 1;
-		workerRefineryMap.erase(unit);
-	}
-	else if (previousJob == Build)
-	{
-		workerBuildingTypeMap.erase(unit);
-	}
-	else if (previousJob == Repair)
-	{
-		workerRepairMap.erase(unit);
+		// and start over measuring its trips
+		record.lastDelivery = -1;
+		record.carrying = false;
 	}
-	else if (previousJob == Move)
+	else if (record.job == Gas)
 	{
-		workerMoveMap.erase(unit);
+		refineryWorkerCount[record.resource] -= 1;
 	}
 
-	workerJobMap.erase(unit);
+	record.depot = nullptr;
+	record.resource = nullptr;
+	record.repairUnit = nullptr;
+	record.buildingType = BWAPI::UnitTypes::None;
+
+	unlinkJob(slot);
+	linkJob(slot, Default);
 }
 
 int WorkerData::getNumWorkers() const
@@ -227,81 +404,35 @@ int WorkerData::getNumWorkers() const
 
 int WorkerData::getNumMineralWorkers() const
 {
-	size_t num = 0;
-	for (auto & unit : workers)
-	{
-		if (workerJobMap.at(unit) == WorkerData::Minerals)
-		{
-			num++;
-		}
-	}
-	return num;
+	return jobCount[Minerals];
 }
 
 int WorkerData::getNumGasWorkers() const
 {
-	size_t num = 0;
-	for (auto & unit : workers)
-	{
-		if (workerJobMap.at(unit) == WorkerData::Gas)
-		{
-			num++;
-		}
-	}
-	return num;
+	return jobCount[Gas];
 }
 
 int WorkerData::getNumReturnCargoWorkers() const
 {
-	size_t num = 0;
-	for (auto & unit : workers)
-	{
-		if (workerJobMap.at(unit) == WorkerData::ReturnCargo)
-		{
-			num++;
-		}
-	}
-	return num;
+	return jobCount[ReturnCargo];
 }
 
 int WorkerData::getNumCombatWorkers() const
 {
-	size_t num = 0;
-	for (auto & unit : workers)
-	{
-		if (workerJobMap.at(unit) == WorkerData::Combat)
-		{
-			num++;
-		}
-	}
-	return num;
+	return jobCount[Combat];
 }
 
 int WorkerData::getNumIdleWorkers() const
 {
-	size_t num = 0;
-	for (auto & unit : workers)
-	{
-		if (workerJobMap.at(unit) == WorkerData::Idle)
-		{
-			num++;
-		}
-	}
-	return num;
+	return jobCount[Idle];
 }
 
 enum WorkerData::WorkerJob WorkerData::getWorkerJob(BWAPI::Unit unit)
 {
 	if (!unit) { return Default; }
 
-	std::map<BWAPI::Unit, enum WorkerJob>::iterator it = workerJobMap.find(unit);
-
-	if (it != workerJobMap.end())
-	{
-		return it->second;
-	}
-
-	return Default;
+	const int slot = getSlot(unit);
+	return slot >= 0 ? records[slot].job : Default;
 }
 
 bool WorkerData::depotIsFull(BWAPI::Unit depot)
@@ -319,13 +450,12 @@ BWAPI::Unitset WorkerData::getMineralPatchesNearDepot(BWAPI::Unit depot)
     // if there are minerals near the depot, add them to the set
     BWAPI::Unitset mineralsNearDepot;
 
-    int radius = 300;
-
-    for (auto & unit : BWAPI::Broodwar->getAllUnits())
+	auto it = depotMinerals.find(depot);
+	if (it != depotMinerals.end())
 	{
-		if ((unit->getType() == BWAPI::UnitTypes::Resource_Mineral_Field) && unit->getDistance(depot) < radius)
+		for (const DepotMineral & patch : it->second)
 		{
-            mineralsNearDepot.insert(unit);
+			mineralsNearDepot.insert(patch.mineral);
 		}
 	}
 
@@ -350,10 +480,16 @@ int WorkerData::getMineralsNearDepot(BWAPI::Unit depot)
 
 	int mineralsNearDepot = 0;
 
-	for (auto & unit : BWAPI::Broodwar->getAllUnits())
+	auto it = depotMinerals.find(depot);
+	if (it != depotMinerals.end())
 	{
-		if ((unit->getType() == BWAPI::UnitTypes::Resource_Mineral_Field) && unit->getDistance(depot) < 200)
+		// Closest first, so stop at the first one out of range.
+		for (const DepotMineral & patch : it->second)
 		{
+			if (patch.distance >= SaturationRadius)
+			{
+				break;
+			}
 			mineralsNearDepot++;
 		}
 	}
@@ -365,28 +501,9 @@ BWAPI::Unit WorkerData::getWorkerResource(BWAPI::Unit unit)
 {
 	if (!unit) { return nullptr; }
 
-	// create the iterator
-	std::map<BWAPI::Unit, BWAPI::Unit>::iterator it;
-	
-	// if the worker is mining, set the iterator to the mineral map
-	if (getWorkerJob(unit) == Minerals)
-	{
-		it = workerMineralAssignment.find(unit);
-		if (it != workerMineralAssignment.end())
-		{
-			return it->second;
-		}	
-	}
-	else if (getWorkerJob(unit) == Gas)
-	{
-		it = workerRefineryMap.find(unit);
-		if (it != workerRefineryMap.end())
-		{
-			return it->second;
-		}	
-	}
-
-	return nullptr;
+	// the mineral patch or refinery, if the worker is mining or gathering gas
+	const int slot = getSlot(unit);
+	return slot >= 0 ? records[slot].resource : nullptr;
 }
 
 BWAPI::Unit WorkerData::getMineralToMine(BWAPI::Unit worker)
@@ -396,80 +513,171 @@ BWAPI::Unit WorkerData::getMineralToMine(BWAPI::Unit worker)
 	// get the depot associated with this unit
 	BWAPI::Unit depot = getWorkerDepot(worker);
 	BWAPI::Unit bestMineral = nullptr;
-	int bestDist = 100000;
+	double bestGain = -1.0;
+	double bestRoundTrip = 1.0e9;
     int bestNumAssigned = 10000;
 
 	if (depot)
 	{
-        BWAPI::Unitset mineralPatches = getMineralPatchesNearDepot(depot);
+		// Usually a scan of the depot's own few patches.
+		// If it has none left, fall back to the whole map.
+		std::vector<DepotMineral> wholeMap;
+		auto it = depotMinerals.find(depot);
+		const bool haveNearby = it != depotMinerals.end() && !it->second.empty();
+		if (!haveNearby)
+		{
+			for (const auto mineral : getMineralPatchesNearDepot(depot))
+			{
+				const int distance = mineral->getDistance(depot);
+				DepotMineral patch = { mineral, distance, estimatedRoundTrip(distance) };
+				wholeMap.push_back(patch);
+			}
+		}
+		const std::vector<DepotMineral> & mineralPatches = haveNearby ? it->second : wholeMap;
 
-		for (const auto mineral : mineralPatches)
+		// Take the patch where one more worker adds the most income. Among equals
+		// (including when every patch is saturated), the least busy, then the closest.
+		for (const DepotMineral & patch : mineralPatches)
 		{
-				int dist = mineral->getDistance(depot);
-                int numAssigned = workersOnMineralPatch[mineral];
-
-                if (numAssigned < bestNumAssigned ||
-					numAssigned == bestNumAssigned && dist < bestDist)
-                {
-                    bestMineral = mineral;
-                    bestDist = dist;
-                    bestNumAssigned = numAssigned;
-                }
+			const int numAssigned = workersOnMineralPatch[patch.mineral];
+			const double gain = patchIncome(patch.roundTrip, numAssigned + 1) - patchIncome(patch.roundTrip, numAssigned);
+			const double epsilon = 1.0e-9;
+
+			if (gain > bestGain + epsilon ||
+				(gain > bestGain - epsilon &&
+				(numAssigned < bestNumAssigned || (numAssigned == bestNumAssigned && patch.roundTrip < bestRoundTrip))))
+			{
+				bestMineral = patch.mineral;
+				bestGain = gain;
+				bestRoundTrip = patch.roundTrip;
+				bestNumAssigned = numAssigned;
+			}
 		}
 	}
 
 	return bestMineral;
 }
 
-BWAPI::Unit WorkerData::getWorkerRepairUnit(BWAPI::Unit unit)
+WorkerData::DepotMineral * WorkerData::findDepotMineral(BWAPI::Unit depot, BWAPI::Unit mineral)
 {
-	if (!unit) { return nullptr; }
+	auto it = depotMinerals.find(depot);
+	if (it != depotMinerals.end())
+	{
+		for (DepotMineral & patch : it->second)
+		{
+			if (patch.mineral == mineral)
+			{
+				return &patch;
+			}
+		}
+	}
+	return nullptr;
+}
 
-	std::map<BWAPI::Unit, BWAPI::Unit>::iterator it = workerRepairMap.find(unit);
+// Measure the round trip times of mineral patches from the workers mining them.
+// A round trip is the time from one delivery to the next by the same worker on the same patch.
+// Only trips on patches with too few workers to make them wait in line count, and trips
+// that were much slower than expected (the worker stopped to fight, for example) don't count.
+void WorkerData::updateMiningTimes()
+{
+	const int now = BWAPI::Broodwar->getFrameCount();
 
-	if (it != workerRepairMap.end())
+	for (int slot = jobHead[Minerals]; slot >= 0; slot = records[slot].next)
 	{
-		return it->second;
-	}	
+		WorkerRecord & record = records[slot];
 
-	return nullptr;
+		const bool carrying = record.unit->isCarryingMinerals();
+		const bool delivered = !carrying && record.carrying;
+		record.carrying = carrying;
+		if (!delivered)
+		{
+			continue;
+		}
+
+		if (record.lastDelivery >= 0)
+		{
+			DepotMineral * patch = findDepotMineral(record.depot, record.resource);
+			const int sample = now - record.lastDelivery;
+			if (patch &&
+				workersOnMineralPatch[record.resource] * MiningFrames <= patch->roundTrip &&
+				sample < 3 * patch->roundTrip)
+			{
+				patch->roundTrip += (sample - patch->roundTrip) / 8.0;
+			}
+		}
+		record.lastDelivery = now;
+	}
 }
 
-BWAPI::Unit WorkerData::getWorkerDepot(BWAPI::Unit unit)
+// Minerals per frame that one more worker would add at the depot's best patch.
+double WorkerData::getMarginalIncome(BWAPI::Unit depot)
 {
-	if (!unit) { return nullptr; }
+	double best = 0.0;
+
+	auto it = depotMinerals.find(depot);
+	if (it != depotMinerals.end())
+	{
+		for (const DepotMineral & patch : it->second)
+		{
+			const int numAssigned = workersOnMineralPatch[patch.mineral];
+			best = std::max(best, patchIncome(patch.roundTrip, numAssigned + 1) - patchIncome(patch.roundTrip, numAssigned));
+		}
+	}
 
-	std::map<BWAPI::Unit, BWAPI::Unit>::iterator it = workerDepotMap.find(unit);
+	return best;
+}
 
-	if (it != workerDepotMap.end())
+// Minerals per frame that would be lost if the mineral worker left its patch.
+double WorkerData::getWorkerIncome(BWAPI::Unit worker)
+{
+	const int slot = getSlot(worker);
+	if (slot < 0 || records[slot].job != Minerals)
 	{
-		return it->second;
-	}	
+		return 0.0;
+	}
 
-	return nullptr;
+	const BWAPI::Unit mineral = records[slot].resource;
+	DepotMineral * patch = findDepotMineral(records[slot].depot, mineral);
+	if (!patch)
+	{
+		return 0.0;
+	}
+
+	const int numAssigned = workersOnMineralPatch[mineral];
+	return patchIncome(patch->roundTrip, numAssigned) - patchIncome(patch->roundTrip, numAssigned - 1);
 }
 
-BWAPI::UnitType	WorkerData::getWorkerBuildingType(BWAPI::Unit unit)
+BWAPI::Unit WorkerData::getWorkerRepairUnit(BWAPI::Unit unit)
 {
-	if (!unit) { return BWAPI::UnitTypes::None; }
+	if (!unit) { return nullptr; }
 
-	std::map<BWAPI::Unit, BWAPI::UnitType>::iterator it = workerBuildingTypeMap.find(unit);
+	const int slot = getSlot(unit);
+	return slot >= 0 ? records[slot].repairUnit : nullptr;
+}
 
-	if (it != workerBuildingTypeMap.end())
-	{
-		return it->second;
-	}	
+BWAPI::Unit WorkerData::getWorkerDepot(BWAPI::Unit unit)
+{
+	if (!unit) { return nullptr; }
+
+	const int slot = getSlot(unit);
+	return slot >= 0 ? records[slot].depot : nullptr;
+}
+
+BWAPI::UnitType	WorkerData::getWorkerBuildingType(BWAPI::Unit unit)
+{
+	if (!unit) { return BWAPI::UnitTypes::None; }
 
-	return BWAPI::UnitTypes::None;
+	const int slot = getSlot(unit);
+	return slot >= 0 ? records[slot].buildingType : BWAPI::UnitTypes::None;
 }
 
 WorkerMoveData WorkerData::getWorkerMoveData(BWAPI::Unit unit)
 {
-	std::map<BWAPI::Unit, WorkerMoveData>::iterator it = workerMoveMap.find(unit);
+	const int slot = getSlot(unit);
 
-	assert(it != workerMoveMap.end());
+	assert(slot >= 0 && records[slot].job == Move);
 	
-	return (it->second);
+	return records[slot].moveData;
 }
 
 int WorkerData::getNumAssignedWorkers(BWAPI::Unit unit)
@@ -531,12 +739,24 @@ char WorkerData::getJobCode(BWAPI::Unit unit)
 // Add all gas workers to the given set.
 void WorkerData::getGasWorkers(std::set<BWAPI::Unit> & mw)
 {
-	for (auto kv : workerRefineryMap)
+	for (int slot = jobHead[Gas]; slot >= 0; slot = records[slot].next)
 	{
-		mw.insert(kv.first);
+		mw.insert(records[slot].unit);
 	}
 }
 
+// The workers with the given job. It's a copy, so it is safe to change jobs while going through it.
+std::vector<BWAPI::Unit> WorkerData::getJobWorkers(WorkerJob job) const
+{
+	std::vector<BWAPI::Unit> jobWorkers;
+	jobWorkers.reserve(jobCount[job]);
+	for (int slot = jobHead[job]; slot >= 0; slot = records[slot].next)
+	{
+		jobWorkers.push_back(records[slot].unit);
+	}
+	return jobWorkers;
+}
+
 void WorkerData::drawDepotDebugInfo()
 {
 	for (const auto depot : depots)
@@ -547,18 +767,19 @@ void WorkerData::drawDepotDebugInfo()
 		if (Config::Debug::DrawWorkerInfo) BWAPI::Broodwar->drawBoxMap(x-2, y-1, x+75, y+14, BWAPI::Colors::Black, true);
 		if (Config::Debug::DrawWorkerInfo) BWAPI::Broodwar->drawTextMap(x, y, "\x04 Workers: %d", getNumAssignedWorkers(depot));
 
-        BWAPI::Unitset minerals = getMineralPatchesNearDepot(depot);
+		if (!Config::Debug::DrawWorkerInfo)
+		{
+			continue;
+		}
 
-        for (const auto mineral : minerals)
-        {
-            int x = mineral->getPosition().x;
-		    int y = mineral->getPosition().y;
-
-            if (workersOnMineralPatch.find(mineral) != workersOnMineralPatch.end())
-            {
-                 //if (Config::Debug::DRAW_UALBERTABOT_DEBUG) BWAPI::Broodwar->drawBoxMap(x-2, y-1, x+75, y+14, BWAPI::Colors::Black, true);
-                 //if (Config::Debug::DRAW_UALBERTABOT_DEBUG) BWAPI::Broodwar->drawTextMap(x, y, "\x04 Workers: %d", workersOnMineralPatch[mineral]);
-            }
-        }
+		// Workers and round trip time of each patch.
+		for (const DepotMineral & patch : depotMinerals[depot])
+		{
+			if (patch.mineral->isVisible())
+			{
+				BWAPI::Broodwar->drawTextMap(patch.mineral->getPosition() + BWAPI::Position(-12, -4), "%c%d %d",
+					white, workersOnMineralPatch[patch.mineral], int(patch.roundTrip + 0.5));
+			}
+		}
 	}
 }
\ No newline at end of file
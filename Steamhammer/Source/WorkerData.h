@@ -28,26 +28,59 @@ class WorkerData
 public:
 
 	enum WorkerJob {Minerals, Gas, Build, Combat, Idle, Repair, Move, Scout, ReturnCargo, Default};
+	static const int NumJobs = Default + 1;
 
 private:
 
 	BWAPI::Unitset workers;
 	BWAPI::Unitset depots;
 
-	std::map<BWAPI::Unit, enum WorkerJob>	workerJobMap;           // worker -> job
-	std::map<BWAPI::Unit, BWAPI::Unit>		workerDepotMap;         // worker -> resource depot (hatchery)
-	std::map<BWAPI::Unit, BWAPI::Unit>		workerRefineryMap;      // worker -> refinery
-	std::map<BWAPI::Unit, BWAPI::Unit>		workerRepairMap;        // worker -> unit to repair
-	std::map<BWAPI::Unit, WorkerMoveData>	workerMoveMap;          // worker -> location
-	std::map<BWAPI::Unit, BWAPI::UnitType>	workerBuildingTypeMap;  // worker -> building type
+	// Everything about one worker. Workers are kept in a dense table of slots,
+	// found by unit ID, and each slot is on a linked list of the workers with the same job.
+	struct WorkerRecord
+	{
+		BWAPI::Unit		unit;
+		WorkerJob		job;
+		BWAPI::Unit		depot;			// Minerals: resource depot (hatchery)
+		BWAPI::Unit		resource;		// Minerals: mineral patch; Gas: refinery
+		BWAPI::Unit		repairUnit;		// Repair: unit to repair
+		BWAPI::UnitType	buildingType;	// Build: building type
+		WorkerMoveData	moveData;		// Move: location
+		int				lastDelivery;	// Minerals: frame it last handed in minerals, or -1
+		bool			carrying;		// Minerals: carrying minerals last frame
+		int				prev;			// previous and next slot with the same job, or -1
+		int				next;
+	};
+	std::vector<WorkerRecord>				records;                // worker slot -> record
+	std::vector<int>						freeSlots;
+	std::vector<int>						unitSlot;               // unit ID -> worker slot, or -1
+	int										jobHead[NumJobs];       // first slot with each job, or -1
+	int										jobCount[NumJobs];
 
 	std::map<BWAPI::Unit, int>				depotWorkerCount;       // mineral workers per depot
 	std::map<BWAPI::Unit, int>				refineryWorkerCount;    // gas workers per refinery
 
     std::map<BWAPI::Unit, int>				workersOnMineralPatch;  // workers per mineral patch
-    std::map<BWAPI::Unit, BWAPI::Unit>		workerMineralAssignment;// worker -> mineral patch
+
+	// The mineral patches near each depot, closest first.
+	// Found once when the depot is added, and updated when a patch mines out.
+	struct DepotMineral
+	{
+		BWAPI::Unit mineral;
+		int distance;			// from the depot, the same as Unit::getDistance()
+		double roundTrip;		// frames for a trip, travel plus mining, with no waiting
+	};
+	std::map<BWAPI::Unit, std::vector<DepotMineral>>	depotMinerals;
+	BWAPI::Unitset							minedOutPatches;
+
+	int  getSlot(BWAPI::Unit unit) const;
+	int  addSlot(BWAPI::Unit unit);
+	void removeSlot(int slot);
+	void linkJob(int slot, WorkerJob job);
+	void unlinkJob(int slot);
 
 	void clearPreviousJob(BWAPI::Unit unit);
+	DepotMineral * findDepotMineral(BWAPI::Unit depot, BWAPI::Unit mineral);
 
 public:
 
@@ -56,6 +89,7 @@ public:
 	void					workerDestroyed(BWAPI::Unit unit);
 	void					addDepot(BWAPI::Unit unit);
 	void					removeDepot(BWAPI::Unit unit);
+	void					removeMineralPatch(BWAPI::Unit mineral);
 	void					addWorker(BWAPI::Unit unit);
 	void					addWorker(BWAPI::Unit unit, WorkerJob job, BWAPI::Unit jobUnit);
 	void					addWorker(BWAPI::Unit unit, WorkerJob job, BWAPI::UnitType jobUnitType);
@@ -71,10 +105,8 @@ public:
 	int						getNumIdleWorkers() const;
 	char					getJobCode(BWAPI::Unit unit);
 
-	void					getMineralWorkers(std::set<BWAPI::Unit> & mw);
 	void					getGasWorkers(std::set<BWAPI::Unit> & mw);
-	void					getBuildingWorkers(std::set<BWAPI::Unit> & mw);
-	void					getRepairWorkers(std::set<BWAPI::Unit> & mw);
+	std::vector<BWAPI::Unit> getJobWorkers(WorkerJob job) const;
 	
 	bool					depotIsFull(BWAPI::Unit depot);
 	int						getMineralsNearDepot(BWAPI::Unit depot);
@@ -82,6 +114,10 @@ public:
 	int						getNumAssignedWorkers(BWAPI::Unit unit);
 	BWAPI::Unit				getMineralToMine(BWAPI::Unit worker);
 
+	void					updateMiningTimes();
+	double					getMarginalIncome(BWAPI::Unit depot);
+	double					getWorkerIncome(BWAPI::Unit worker);
+
 	enum WorkerJob			getWorkerJob(BWAPI::Unit unit);
 	BWAPI::Unit				getWorkerResource(BWAPI::Unit unit);
 	BWAPI::Unit				getWorkerDepot(BWAPI::Unit unit);
@@ -94,6 +130,7 @@ public:
 	void					drawDepotDebugInfo();
 
 	const BWAPI::Unitset & getWorkers() const { return workers; }
+	const BWAPI::Unitset & getDepots() const { return depots; }
 
 };
 }
\ No newline at end of file
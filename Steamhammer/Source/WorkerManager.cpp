@@ -1,11 +1,21 @@
 #include "Common.h"
 #include "WorkerManager.h"
+#include "MapGrid.h"
 #include "Micro.h"
 #include "ProductionManager.h"
 #include "UnitUtil.h"
 
 using namespace UAlbertaBot;
 
+namespace
+{
+	// Moving a mineral worker to another base is worth it if the income it will earn there
+	// over this many frames, after it arrives, beats what it would earn by staying.
+	const int TransferHorizonFrames = 2 * 60 * 24;
+	const int TransferCheckFrames = 2 * 24;
+	const double TransferMinGain = 8.0;			// minerals; ignore smaller differences
+}
+
 WorkerManager::WorkerManager() 
 	: previousClosestWorker(nullptr)
 	, _collectGas(true)
@@ -23,6 +33,8 @@ void WorkerManager::update()
 	// NOTE Combat workers are placed in a combat squad and get their orders there.
 	//      We ignore them here.
 	updateWorkerStatus();
+	workerData.updateMiningTimes();
+	transferMineralWorkers();
 	handleGasWorkers();
 	handleIdleWorkers();
 	handleReturnCargoWorkers();
@@ -234,47 +246,41 @@ bool WorkerManager::refineryHasDepot(BWAPI::Unit refinery)
 
 void WorkerManager::handleIdleWorkers() 
 {
-	for (const auto worker : workerData.getWorkers())
+	for (const auto worker : workerData.getJobWorkers(WorkerData::Idle))
 	{
         UAB_ASSERT(worker != nullptr, "Worker was null");
 
-		if (workerData.getWorkerJob(worker) == WorkerData::Idle) 
+		if (worker->isCarryingMinerals() || worker->isCarryingGas())
 		{
-			if (worker->isCarryingMinerals() || worker->isCarryingGas())
-			{
-				// It's carrying something, set it to hand in its cargo.
-				setReturnCargoWorker(worker);         // only happens if there's a resource depot
-			}
-			else {
-				// Otherwise send it to mine minerals.
-				setMineralWorker(worker);             // only happens if there's a resource depot
-			}
+			// It's carrying something, set it to hand in its cargo.
+			setReturnCargoWorker(worker);         // only happens if there's a resource depot
+		}
+		else {
+			// Otherwise send it to mine minerals.
+			setMineralWorker(worker);             // only happens if there's a resource depot
 		}
 	}
 }
 
 void WorkerManager::handleReturnCargoWorkers()
 {
-	for (const auto worker : workerData.getWorkers())
+	for (const auto worker : workerData.getJobWorkers(WorkerData::ReturnCargo))
 	{
 		UAB_ASSERT(worker != nullptr, "Worker was null");
 
-		if (workerData.getWorkerJob(worker) == WorkerData::ReturnCargo)
+		// If it still needs to return cargo, return it; otherwise go idle.
+		// We have to make sure it has a resource depot to return cargo to.
+		BWAPI::Unit depot;
+		if ((worker->isCarryingMinerals() || worker->isCarryingGas()) &&
+			(depot = getClosestDepot(worker)) &&
+			worker->getDistance(depot) < 600)
 		{
-			// If it still needs to return cargo, return it; otherwise go idle.
-			// We have to make sure it has a resource depot to return cargo to.
-			BWAPI::Unit depot;
-			if ((worker->isCarryingMinerals() || worker->isCarryingGas()) &&
-				(depot = getClosestDepot(worker)) &&
-				worker->getDistance(depot) < 600)
-			{
-				Micro::SmartReturnCargo(worker);
-			}
-			else
-			{
-				// Can't return cargo. Let's be a mineral worker instead--if possible.
-				setMineralWorker(worker);
-			}
+			Micro::SmartReturnCargo(worker);
+		}
+		else
+		{
+			// Can't return cargo. Let's be a mineral worker instead--if possible.
+			setMineralWorker(worker);
 		}
 	}
 }
@@ -301,6 +307,7 @@ void WorkerManager::handleRepairWorkers()
 // Used for worker self-defense.
 // Only include enemy units within 64 pixels that can be targeted by workers
 // and are not moving or are stuck and moving randomly to dislodge themselves.
+// MapGrid finds the enemies near the worker, so we look only at the few grid cells around it.
 BWAPI::Unit WorkerManager::findEnemyTargetForWorker(BWAPI::Unit worker)
 {
     UAB_ASSERT(worker != nullptr, "Worker was null");
@@ -308,7 +315,12 @@ BWAPI::Unit WorkerManager::findEnemyTargetForWorker(BWAPI::Unit worker)
 	BWAPI::Unit closestUnit = nullptr;
 	int closestDist = 65;         // ignore anything farther away
 
-	for (const auto unit : BWAPI::Broodwar->enemy()->getUnits())
+	// MapGrid measures center to center. Allow for the size of the worker and of
+	// the largest enemy ground unit or building, which can be in range at the edge.
+	BWAPI::Unitset nearbyEnemies;
+	MapGrid::Instance().GetUnits(nearbyEnemies, worker->getPosition(), closestDist + 96, false, true);
+
+	for (const auto unit : nearbyEnemies)
 	{
 		int dist;
 
@@ -341,25 +353,34 @@ BWAPI::Unit WorkerManager::getClosestMineralWorkerTo(BWAPI::Unit enemyUnit)
 		return previousClosestWorker;
     }
 
-	for (const auto worker : workerData.getWorkers())
-	{
-        UAB_ASSERT(worker != nullptr, "Worker was null");
+	// Look first among our units nearby. If the closest free worker there is no farther
+	// than the search radius, no worker outside can be closer. Otherwise look at all workers.
+	const int searchRadius = 12 * 32;
+	BWAPI::Unitset nearbyUnits;
+	MapGrid::Instance().GetUnits(nearbyUnits, enemyUnit->getPosition(), searchRadius, true, false);
 
-        if (isFree(worker)) 
+	for (int pass = 0; pass < 2 && (!closestMineralWorker || closestDist > searchRadius); ++pass)
+	{
+		for (const auto worker : pass == 0 ? nearbyUnits : workerData.getWorkers())
 		{
-			int dist = worker->getDistance(enemyUnit);
-			if (worker->isCarryingMinerals() || worker->isCarryingGas())
+			UAB_ASSERT(worker != nullptr, "Worker was null");
+
+			if (worker->getType().isWorker() && isFree(worker))
 			{
-				// If it has cargo, pretend it is farther away.
-				// That way we prefer empty workers and lose less cargo.
-				dist += 64;
-			}
+				int dist = worker->getDistance(enemyUnit);
+				if (worker->isCarryingMinerals() || worker->isCarryingGas())
+				{
+					// If it has cargo, pretend it is farther away.
+					// That way we prefer empty workers and lose less cargo.
+					dist += 64;
+				}
 
-            if (dist < closestDist)
-            {
-                closestMineralWorker = worker;
-                dist = closestDist;
-            }
+				if (dist < closestDist)
+				{
+					closestMineralWorker = worker;
+					closestDist = dist;
+				}
+			}
 		}
 	}
 
@@ -369,51 +390,41 @@ BWAPI::Unit WorkerManager::getClosestMineralWorkerTo(BWAPI::Unit enemyUnit)
 
 BWAPI::Unit WorkerManager::getWorkerScout()
 {
-	for (const auto worker : workerData.getWorkers())
-	{
-        UAB_ASSERT(worker != nullptr, "Worker was null");
-        if (workerData.getWorkerJob(worker) == WorkerData::Scout) 
-		{
-			return worker;
-		}
-	}
+	const std::vector<BWAPI::Unit> scouts = workerData.getJobWorkers(WorkerData::Scout);
 
-    return nullptr;
+    return scouts.empty() ? nullptr : scouts.front();
 }
 
 void WorkerManager::handleMoveWorkers() 
 {
-	for (const auto worker : workerData.getWorkers())
+	for (const auto worker : workerData.getJobWorkers(WorkerData::Move))
 	{
         UAB_ASSERT(worker != nullptr, "Worker was null");
 
-		if (workerData.getWorkerJob(worker) == WorkerData::Move) 
+		BWAPI::Unit depot;
+		if ((worker->isCarryingMinerals() || worker->isCarryingGas()) &&
+			(depot = getClosestDepot(worker)) &&
+			worker->getDistance(depot) <= 256)
 		{
-			BWAPI::Unit depot;
-			if ((worker->isCarryingMinerals() || worker->isCarryingGas()) &&
-				(depot = getClosestDepot(worker)) &&
-				worker->getDistance(depot) <= 256)
-			{
-				// A move worker is being sent to build or something.
-				// Don't let it carry minerals or gas around wastefully.
-				Micro::SmartReturnCargo(worker);
-			}
-			else
-			{
-				// UAB_ASSERT(worker->exists(), "bad worker");  // TODO temporary debugging - see Micro::SmartMove
-				WorkerMoveData data = workerData.getWorkerMoveData(worker);
-				Micro::SmartMove(worker, data.position);
-			}
+			// A move worker is being sent to build or something.
+			// Don't let it carry minerals or gas around wastefully.
+			Micro::SmartReturnCargo(worker);
+		}
+		else
+		{
+			// UAB_ASSERT(worker->exists(), "bad worker");  // TODO temporary debugging - see Micro::SmartMove
+			WorkerMoveData data = workerData.getWorkerMoveData(worker);
+			Micro::SmartMove(worker, data.position);
 		}
 	}
 }
 
-// Send the worker to mine minerals at the closest resource depot, if any.
+// Send the worker to mine minerals at the resource depot where it adds the most income, if any.
 void WorkerManager::setMineralWorker(BWAPI::Unit unit)
 {
     UAB_ASSERT(unit != nullptr, "Unit was null");
 
-	BWAPI::Unit depot = getClosestDepot(unit);
+	BWAPI::Unit depot = getMineralDepot(unit);
 
 	if (depot)
 	{
@@ -453,9 +464,7 @@ BWAPI::Unit WorkerManager::getClosestDepot(BWAPI::Unit worker)
 	{
         UAB_ASSERT(unit != nullptr, "Unit was null");
 
-		if (unit->getType().isResourceDepot() &&
-			(unit->isCompleted() || unit->getType() == BWAPI::UnitTypes::Zerg_Lair || unit->getType() == BWAPI::UnitTypes::Zerg_Hive) &&
-			!workerData.depotIsFull(unit))
+		if (isMiningDepot(unit) && !workerData.depotIsFull(unit))
 		{
 			int distance = unit->getDistance(worker);
 			if (!closestDepot || distance < closestDistance)
@@ -469,6 +478,96 @@ BWAPI::Unit WorkerManager::getClosestDepot(BWAPI::Unit worker)
 	return closestDepot;
 }
 
+// A depot that workers can use: completed, or a hatchery morphing into a lair or hive.
+bool WorkerManager::isMiningDepot(BWAPI::Unit depot)
+{
+	return
+		depot->getType().isResourceDepot() &&
+		(depot->isCompleted() || depot->getType() == BWAPI::UnitTypes::Zerg_Lair || depot->getType() == BWAPI::UnitTypes::Zerg_Hive);
+}
+
+// The depot where the worker will add the most mineral income, counting the
+// time it takes to get there. If no depot gains anything, the closest.
+BWAPI::Unit WorkerManager::getMineralDepot(BWAPI::Unit worker)
+{
+	UAB_ASSERT(worker != nullptr, "Worker was null");
+
+	BWAPI::Unit bestDepot = nullptr;
+	double bestValue = 0.0;
+
+	for (const auto depot : workerData.getDepots())
+	{
+		if (isMiningDepot(depot) && !workerData.depotIsFull(depot))
+		{
+			const double travelFrames = worker->getDistance(depot) / worker->getType().topSpeed();
+			const double value = workerData.getMarginalIncome(depot) * std::max(0.0, TransferHorizonFrames - travelFrames);
+			if (value > bestValue)
+			{
+				bestDepot = depot;
+				bestValue = value;
+			}
+		}
+	}
+
+	return bestDepot ? bestDepot : getClosestDepot(worker);
+}
+
+// Move at most one mineral worker to another base, if it will earn more there
+// even after the time spent walking. Called every frame, acts occasionally.
+void WorkerManager::transferMineralWorkers()
+{
+	if (BWAPI::Broodwar->getFrameCount() % TransferCheckFrames != 0 || workerData.getDepots().size() < 2)
+	{
+		return;
+	}
+
+	std::map<BWAPI::Unit, double> marginalIncome;
+	for (const auto depot : workerData.getDepots())
+	{
+		if (isMiningDepot(depot) && !workerData.depotIsFull(depot))
+		{
+			marginalIncome[depot] = workerData.getMarginalIncome(depot);
+		}
+	}
+
+	BWAPI::Unit bestWorker = nullptr;
+	BWAPI::Unit bestDepot = nullptr;
+	double bestNet = TransferMinGain;
+
+	for (const auto worker : workerData.getJobWorkers(WorkerData::Minerals))
+	{
+		if (!worker->isCompleted())
+		{
+			continue;
+		}
+
+		const BWAPI::Unit fromDepot = workerData.getWorkerDepot(worker);
+		const double stay = workerData.getWorkerIncome(worker) * TransferHorizonFrames;
+
+		for (const auto & kv : marginalIncome)
+		{
+			if (kv.first == fromDepot)
+			{
+				continue;
+			}
+
+			const double travelFrames = worker->getDistance(kv.first) / worker->getType().topSpeed();
+			const double net = kv.second * std::max(0.0, TransferHorizonFrames - travelFrames) - stay;
+			if (net > bestNet)
+			{
+				bestWorker = worker;
+				bestDepot = kv.first;
+				bestNet = net;
+			}
+		}
+	}
+
+	if (bestWorker)
+	{
+		workerData.setWorkerJob(bestWorker, WorkerData::Minerals, bestDepot);
+	}
+}
+
 // other managers that need workers call this when they're done with a unit
 void WorkerManager::finishedWithWorker(BWAPI::Unit unit) 
 {
@@ -709,15 +808,10 @@ void WorkerManager::onUnitShow(BWAPI::Unit unit)
 
 void WorkerManager::rebalanceWorkers()
 {
-	for (const auto worker : workerData.getWorkers())
+	for (const auto worker : workerData.getJobWorkers(WorkerData::Minerals))
 	{
         UAB_ASSERT(worker != nullptr, "Worker was null");
 
-		if (!workerData.getWorkerJob(worker) == WorkerData::Minerals)
-		{
-			continue;
-		}
-
 		BWAPI::Unit depot = workerData.getWorkerDepot(worker);
 
 		if (depot && workerData.depotIsFull(depot))
@@ -747,6 +841,7 @@ void WorkerManager::onUnitDestroy(BWAPI::Unit unit)
 
 	if (unit->getType() == BWAPI::UnitTypes::Resource_Mineral_Field)
 	{
+		workerData.removeMineralPatch(unit);
 		rebalanceWorkers();
 	}
 }
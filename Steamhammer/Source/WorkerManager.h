@@ -15,6 +15,8 @@ class WorkerManager
 	bool		_collectGas;
 
 	void        setMineralWorker(BWAPI::Unit unit);
+	void        transferMineralWorkers();
+	bool        isMiningDepot(BWAPI::Unit depot);
 	void        setReturnCargoWorker(BWAPI::Unit unit);
 	bool		refineryHasDepot(BWAPI::Unit refinery);
 	bool        isGasStealRefinery(BWAPI::Unit unit);
@@ -64,6 +66,7 @@ public:
     BWAPI::Unit getBuilder(const Building & b,bool setJobAsBuilder = true);
     BWAPI::Unit getMoveWorker(BWAPI::Position p);
     BWAPI::Unit getClosestDepot(BWAPI::Unit worker);
+    BWAPI::Unit getMineralDepot(BWAPI::Unit worker);
     BWAPI::Unit getGasWorker(BWAPI::Unit refinery);
     BWAPI::Unit getClosestMineralWorkerTo(BWAPI::Unit enemyUnit);
     BWAPI::Unit getWorkerScout();
@@ -0,0 +1,142 @@
+// FAPReplay: Re-run the combat simulation traces that the bot records when the debug option
+// TraceCombatSim is on, and report how long the simulations take and whether they still
+// come out with the recorded scores. The traces are a benchmark corpus from real games
+// for working on the simulator, and a regression test for it.
+//
+// fapreplay [-fixed | -float] [-repeat n] [-v] trace...
+//   -fixed, -float	simulate in fixed or floating point, whatever the trace recorded
+//   -repeat n		simulate each record n times and keep the fastest, for steadier timings
+//   -v				print every record, not only the ones that differ
+
+#include "FAP.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace UAlbertaBot;
+
+namespace
+{
+	enum class Mode { AsRecorded, Fixed, Float };
+
+	struct Totals
+	{
+		int records = 0;
+		int differ = 0;
+		double ms = 0.0;
+		double maxMs = 0.0;
+	};
+
+	// Return false if the file could not be read to the end.
+	bool replay(const char * filename, Mode mode, int repeat, bool verbose, Totals & totals)
+	{
+		std::ifstream in(filename, std::ios::binary);
+		if (!in || !FastAPproximation::readTraceHeader(in))
+		{
+			fprintf(stderr, "%s: not a trace file\n", filename);
+			return false;
+		}
+
+		FastAPproximation recorded;
+		int frame, nFrames;
+		std::pair<int, int> scores;
+		int records = 0;
+		while (in.peek() != EOF)
+		{
+			if (!recorded.readTraceRecord(in, frame, nFrames, scores))
+			{
+				fprintf(stderr, "%s: truncated after %d records\n", filename, records);
+				return false;
+			}
+			++records;
+
+			if (mode != Mode::AsRecorded)
+			{
+				recorded.setFixedPoint(mode == Mode::Fixed);
+			}
+
+			FastAPproximation sim;
+			double best = 0.0;
+			for (int r = 0; r < repeat; ++r)
+			{
+				sim = recorded;
+				const auto start = std::chrono::steady_clock::now();
+				sim.simulate(nFrames);
+				const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (r == 0 || ms < best)
+				{
+					best = ms;
+				}
+			}
+
+			const std::pair<int, int> now = sim.playerScores();
+			const bool same = now == scores;
+
+			++totals.records;
+			totals.differ += same ? 0 : 1;
+			totals.ms += best;
+			totals.maxMs = std::max(totals.maxMs, best);
+
+			if (verbose || !same)
+			{
+				printf("%s frame %d: recorded %d %d, now %d %d%s, %.3f ms\n",
+					filename, frame, scores.first, scores.second, now.first, now.second, same ? "" : " DIFFERENT", best);
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	Mode mode = Mode::AsRecorded;
+	int repeat = 1;
+	bool verbose = false;
+	int nFiles = 0;
+	bool ok = true;
+	Totals totals;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-fixed"))
+		{
+			mode = Mode::Fixed;
+		}
+		else if (!strcmp(argv[i], "-float"))
+		{
+			mode = Mode::Float;
+		}
+		else if (!strcmp(argv[i], "-repeat") && i + 1 < argc)
+		{
+			repeat = std::max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-v"))
+		{
+			verbose = true;
+		}
+		else
+		{
+			ok = replay(argv[i], mode, repeat, verbose, totals) && ok;
+			++nFiles;
+		}
+	}
+
+	if (nFiles == 0)
+	{
+		fprintf(stderr, "usage: fapreplay [-fixed | -float] [-repeat n] [-v] trace...\n");
+		return 2;
+	}
+
+	printf("%d records, %d with different scores\n", totals.records, totals.differ);
+	if (totals.records > 0)
+	{
+		printf("simulation time %.1f ms total, %.3f ms mean, %.3f ms max\n",
+			totals.ms, totals.ms / totals.records, totals.maxMs);
+	}
+
+	return ok && totals.differ == 0 ? 0 : 1;
+}